@@ -0,0 +1,1198 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <pqxx/pqxx>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "dashboard_renderer.hpp"
+#include "db_pool.hpp"
+#include "env.hpp"
+#include "json_extract.hpp"
+#include "json_repair.hpp"
+#include "json_writer.hpp"
+#include "llm_cache.hpp"
+#include "llm_client.hpp"
+#include "pg_types.hpp"
+#include "query_cache.hpp"
+#include "schema_cache.hpp"
+#include "schema_search.hpp"
+#include "thread_pool.hpp"
+
+// Núcleo del agente sin dependencias de Python: configuración, pool de conexiones, esquema,
+// consultas, herramientas, cliente del LLM y los agentes. Lo comparten el módulo cpp_agent y
+// el servidor HTTP nativo (agent_server.cpp)
+namespace mcp::agent {
+
+using json = nlohmann::json;
+
+// Cargar configuración desde config.json
+inline json load_config() {
+    std::ifstream file("config.json");
+    if (!file.is_open()) {
+        throw std::runtime_error("No se pudo abrir config.json");
+    }
+    json config;
+    try {
+        file >> config;
+    } catch (const json::parse_error& e) {
+        throw std::runtime_error("Error al parsear config.json: " + std::string(e.what()));
+    }
+    return config;
+}
+
+inline const json CONFIG = load_config();
+inline const std::string INSTRUCTIONS = CONFIG["INSTRUCTIONS"].get<std::string>();
+inline const std::string VISUALIZATION_TYPES_JSON = CONFIG["VISUALIZATION_TYPES_JSON"].dump();
+inline const std::string INSTRUCTIONS_DB_ANALYSIS_AND_SQL = CONFIG["INSTRUCTIONS_DB_ANALYSIS_AND_SQL"].get<std::string>() + "\nTipos de visualización: " + VISUALIZATION_TYPES_JSON;
+inline const std::string INSTRUCTIONS_SQL_METRIC_DATA_JSON_ONLY = CONFIG["INSTRUCTIONS_SQL_METRIC_DATA_JSON_ONLY"].get<std::string>();
+inline const std::string INSTRUCTIONS_RENDER_DASHBOARD_FROM_DATA = CONFIG["INSTRUCTIONS_RENDER_DASHBOARD_FROM_DATA"].get<std::string>();
+
+// Cadena de conexión a la base de datos
+inline std::string get_conninfo() {
+    std::string host = std::getenv("DB_HOST") ? std::getenv("DB_HOST") : "";
+    std::string user = std::getenv("DB_USER") ? std::getenv("DB_USER") : "";
+    std::string pw = std::getenv("DB_PASSWORD") ? std::getenv("DB_PASSWORD") : "";
+    std::string dbname = std::getenv("DB_NAME") ? std::getenv("DB_NAME") : "";
+    if (host.empty() || user.empty() || pw.empty() || dbname.empty()) {
+        throw std::runtime_error("Faltan variables de entorno de la base de datos");
+    }
+    return "host=" + host + " user=" + user + " password=" + pw + " dbname=" + dbname;
+}
+
+// Pool de conexiones compartido por todas las herramientas
+inline mcp::ConnectionPool& db_pool() {
+    // Se crea una sola vez y no se destruye: otros hilos pueden seguir usándolo al salir
+    static mcp::ConnectionPool* pool = new mcp::ConnectionPool(get_conninfo(), mcp::PoolConfig::from_env());
+    return *pool;
+}
+
+// Arreglo JSON de nombres devuelto por json_agg (NULL si no hay ninguno)
+inline std::vector<std::string> schema_names(const json& value) {
+    std::vector<std::string> names;
+    if (value.is_array()) {
+        for (const auto& name : value) names.push_back(name.is_string() ? name.get<std::string>() : name.dump());
+    }
+    return names;
+}
+
+// Cargar el esquema con una sola consulta a pg_catalog (ver kSchemaQuery); ambas codificaciones
+// se serializan aquí una sola vez por versión del catálogo
+inline std::shared_ptr<mcp::SchemaSnapshot> load_schema(pqxx::transaction_base& txn) {
+    const int server_version = txn.conn().server_version();
+    if (server_version < mcp::kSchemaMinServerVersion) {
+        throw std::runtime_error("El esquema requiere PostgreSQL 12 o posterior (versión del servidor: " +
+                                 std::to_string(server_version) + ")");
+    }
+    pqxx::result res = txn.exec(mcp::kSchemaQuery);
+
+    std::vector<mcp::SchemaTable> tables;
+    tables.reserve(static_cast<std::size_t>(res.size()));
+    for (auto row : res) {
+        mcp::SchemaTable table;
+        table.name = row[0].c_str();
+        table.kind = row[1].c_str();
+        table.rows_estimate = row[2].is_null() ? -1 : std::stoll(row[2].c_str());
+        if (!row[3].is_null()) table.partition_key = row[3].c_str();
+        if (!row[8].is_null()) table.comment = row[8].c_str();
+        auto json_column = [&row](int i) { return row[i].is_null() ? json() : json::parse(row[i].view()); };
+        for (const auto& column : json_column(4)) {
+            table.columns.push_back({column["name"].get<std::string>(), column["type"].get<std::string>(),
+                                     column["short_type"].get<std::string>(), column["not_null"].get<bool>(),
+                                     column["comment"].is_string() ? column["comment"].get<std::string>() : ""});
+        }
+        for (const auto& constraint : json_column(5)) {
+            if (constraint["type"] == "p") {
+                table.primary_key = schema_names(constraint["columns"]);
+            } else {
+                table.foreign_keys.push_back({schema_names(constraint["columns"]),
+                                              constraint["ref_table"].get<std::string>(),
+                                              schema_names(constraint["ref_columns"])});
+            }
+        }
+        for (const auto& index : json_column(6)) {
+            table.indexes.push_back({index["name"].get<std::string>(), index["method"].get<std::string>(),
+                                     schema_names(index["columns"]), index["unique"].get<bool>(),
+                                     index["primary"].get<bool>(),
+                                     index["predicate"].is_string() ? index["predicate"].get<std::string>() : ""});
+        }
+        for (const auto& partition : json_column(7)) {
+            table.partitions.push_back({partition["name"].get<std::string>(),
+                                        partition["bound"].is_string() ? partition["bound"].get<std::string>() : ""});
+        }
+        tables.push_back(std::move(table));
+    }
+    return mcp::make_schema_snapshot(std::move(tables));
+}
+
+// Caché del esquema; la firma del catálogo se verifica como mucho cada SCHEMA_CACHE_CHECK_MS
+inline mcp::SchemaCache& schema_cache() {
+    static mcp::SchemaCache* cache = new mcp::SchemaCache(
+        db_pool(), std::chrono::milliseconds(mcp::env_long("SCHEMA_CACHE_CHECK_MS", 5000)), load_schema);
+    return *cache;
+}
+
+// Codificación de get_schema cuando la llamada no indica `format` (SCHEMA_FORMAT). Por defecto
+// json; la compacta se pide con format o SCHEMA_FORMAT
+inline mcp::SchemaFormat default_schema_format() {
+    static const mcp::SchemaFormat format = mcp::parse_schema_format(mcp::env_string("SCHEMA_FORMAT", "json"));
+    return format;
+}
+
+// Obtener el esquema de la base de datos en la codificación indicada (SCHEMA_FORMAT si no se indica)
+inline std::string get_db_schema(std::optional<mcp::SchemaFormat> format = std::nullopt) {
+    try {
+        return schema_cache().get()->text(format ? *format : default_schema_format());
+    } catch (const std::exception& e) {
+        json error = {{"error", std::string("Error al obtener el esquema: ") + e.what()}};
+        return error.dump();
+    }
+}
+
+// Página de list_tables: nombre, tipo y filas estimadas, sin columnas
+inline std::string list_db_tables(std::size_t offset, std::size_t limit, std::optional<mcp::SchemaFormat> format = std::nullopt) {
+    try {
+        return mcp::list_snapshot_tables(*schema_cache().get(), offset, limit, format ? *format : default_schema_format());
+    } catch (const std::exception& e) {
+        json error = {{"error", std::string("Error al obtener el esquema: ") + e.what()}};
+        return error.dump();
+    }
+}
+
+// Detalle de las tablas pedidas, tomado de las serializaciones por tabla de la instantánea
+inline std::string describe_db_tables(const std::vector<std::string>& names, std::optional<mcp::SchemaFormat> format = std::nullopt) {
+    try {
+        return mcp::describe_snapshot_tables(*schema_cache().get(), names, format ? *format : default_schema_format());
+    } catch (const std::exception& e) {
+        json error = {{"error", std::string("Error al obtener el esquema: ") + e.what()}};
+        return error.dump();
+    }
+}
+
+// Índice de relevancia (BM25) sobre la última instantánea del esquema; nunca se destruye
+inline mcp::SchemaSearchCache& schema_search() {
+    static mcp::SchemaSearchCache* search = new mcp::SchemaSearchCache();
+    return *search;
+}
+
+// Líneas compactas de las SCHEMA_TOP_K tablas más relevantes para el mensaje, para incluirlas en
+// el prompt antes de la primera llamada al LLM. Vacío si está desactivado, si ninguna tabla
+// coincide o si el esquema no está disponible (el LLM sigue teniendo las herramientas de esquema)
+inline std::string relevant_schema(const std::string& message) {
+    static const auto top_k = static_cast<std::size_t>(std::max(0L, mcp::env_long("SCHEMA_TOP_K", 8)));
+    if (top_k == 0) return "";
+    try {
+        auto snapshot = schema_cache().get();
+        auto hits = schema_search().get(snapshot)->search(message, top_k);
+        if (hits.empty()) return "";
+        std::string out = "Tablas del esquema más relevantes para la petición (una línea por tabla; usa describe_tables o list_tables si necesitas otras):\n";
+        for (const auto& hit : hits) out += snapshot->table_compact[hit.table];
+        return out;
+    } catch (const std::exception&) {
+        return "";
+    }
+}
+
+// Mensajes iniciales de un agente: instrucciones, esquema relevante si lo hay y petición
+inline json agent_messages(const std::string& instructions, const std::string& message) {
+    json messages = json::array();
+    messages.push_back({{"role", "system"}, {"content", instructions}});
+    std::string schema = relevant_schema(message);
+    if (!schema.empty()) messages.push_back({{"role", "system"}, {"content", std::move(schema)}});
+    messages.push_back({{"role", "user"}, {"content", message}});
+    return messages;
+}
+
+// Límites y formato para las consultas generadas por el LLM
+struct QueryOptions {
+    std::size_t max_rows;
+    std::size_t max_bytes;
+    std::size_t fetch_size;
+    bool binary_results;
+};
+
+inline const QueryOptions& query_options() {
+    static const QueryOptions options{
+        static_cast<std::size_t>(std::max(1L, mcp::env_long("DB_MAX_ROWS", 10000))),
+        static_cast<std::size_t>(std::max(1L, mcp::env_long("DB_MAX_BYTES", 4L * 1024 * 1024))),
+        static_cast<std::size_t>(std::max(1L, mcp::env_long("DB_FETCH_SIZE", 500))),
+        mcp::env_long("DB_BINARY_RESULTS", 1) != 0
+    };
+    return options;
+}
+
+// Resultado de scan_statement: dónde termina el último token de la consulta y cuántas
+// sentencias no vacías separadas por ';' contiene
+struct StatementScan {
+    std::size_t end = 0;
+    std::size_t statements = 0;
+};
+
+// Recorrer la consulta saltando cadenas ('...', E'...'), identificadores entre comillas,
+// cadenas con $etiqueta$ y comentarios (-- y /* */ anidados), para que su contenido no se tome
+// por un ';' o un comentario final
+inline StatementScan scan_statement(std::string_view sql) {
+    StatementScan scan;
+    bool in_statement = false;
+    auto is_word = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+    auto token = [&](std::size_t end) {
+        scan.end = end;
+        if (!in_statement) ++scan.statements;
+        in_statement = true;
+    };
+    std::size_t i = 0;
+    while (i < sql.size()) {
+        const char c = sql[i];
+        const char next = i + 1 < sql.size() ? sql[i + 1] : '\0';
+        if (c == '-' && next == '-') {
+            const std::size_t eol = sql.find('\n', i);
+            i = eol == std::string_view::npos ? sql.size() : eol + 1;
+        } else if (c == '/' && next == '*') {
+            int depth = 1;
+            for (i += 2; i < sql.size() && depth > 0; ++i) {
+                if (sql[i] == '/' && i + 1 < sql.size() && sql[i + 1] == '*') { ++depth; ++i; }
+                else if (sql[i] == '*' && i + 1 < sql.size() && sql[i + 1] == '/') { --depth; ++i; }
+            }
+        } else if (c == '\'' || c == '"') {
+            const bool escapes = c == '\'' && i > 0 && (sql[i - 1] == 'e' || sql[i - 1] == 'E') &&
+                                 (i < 2 || !is_word(sql[i - 2]));
+            for (++i; i < sql.size() && sql[i] != c; ++i) {
+                if (escapes && sql[i] == '\\') ++i;
+            }
+            i = std::min(i + 1, sql.size());
+            token(i);
+        } else if (c == '$' && (i == 0 || !is_word(sql[i - 1])) && (next == '$' || std::isalpha(static_cast<unsigned char>(next)) || next == '_')) {
+            std::size_t tag_end = i + 1;
+            while (tag_end < sql.size() && is_word(sql[tag_end])) ++tag_end;
+            if (tag_end < sql.size() && sql[tag_end] == '$') {
+                const std::string_view tag = sql.substr(i, tag_end - i + 1);
+                const std::size_t close = sql.find(tag, tag_end + 1);
+                i = close == std::string_view::npos ? sql.size() : close + tag.size();
+            } else {
+                i = tag_end;
+            }
+            token(i);
+        } else if (c == ';') {
+            in_statement = false;
+            ++i;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else {
+            token(++i);
+        }
+    }
+    return scan;
+}
+
+// Quitar espacios, comentarios y ';' finales para poder usar la consulta dentro de DECLARE CURSOR
+inline std::string strip_statement(const std::string& query) {
+    return query.substr(0, scan_statement(query).end);
+}
+
+// Serializa filas como objetos JSON. El descriptor de columnas (clave escapada y convertidor
+// según el OID del tipo) se construye una sola vez por consulta
+class RowWriter {
+public:
+    RowWriter(const pqxx::result& res, bool binary) : columns_(mcp::pg::describe_columns(res, binary)) {}
+
+    void write_row(const pqxx::row& row, mcp::JsonWriter& writer) const {
+        writer.begin_object();
+        const mcp::pg::Column* column = columns_.data();
+        for (auto field : row) {
+            writer.raw_key(column->key);
+            if (field.is_null()) writer.null();
+            else column->convert(writer, field.view());
+            ++column;
+        }
+        writer.end_object();
+    }
+
+private:
+    std::vector<mcp::pg::Column> columns_;
+};
+
+// Declarar el cursor y obtener la descripción de columnas sin leer filas (FETCH 0).
+// El salto de línea evita que un comentario `--` al final de la consulta anule el FETCH
+inline pqxx::result declare_cursor(pqxx::transaction_base& txn, const std::string& sql, bool binary) {
+    return txn.exec(std::string("DECLARE mcp_cursor ") + (binary ? "BINARY " : "") +
+                    "NO SCROLL CURSOR FOR " + sql + "\n; FETCH FORWARD 0 FROM mcp_cursor");
+}
+
+// Arreglo JSON de filas acotado por DB_MAX_ROWS / DB_MAX_BYTES. Si se trunca, al terminar el
+// arreglo se envuelve en {"truncated": true, "row_count": N, "rows": [...]}
+class CappedRows {
+public:
+    explicit CappedRows(std::string& out) : out_(out), start_(out.size()), writer_(out) {
+        writer_.begin_array();
+    }
+
+    // Devuelve false, sin dejar la fila en la salida, si no cabe en DB_MAX_ROWS / DB_MAX_BYTES.
+    // El tamaño se mide después de escribirla: una fila ancha (texto o jsonb grande) que se pase
+    // del límite se retira entera. Tras un false solo queda llamar a finish()
+    bool write(const RowWriter& rows, const pqxx::row& row) {
+        const QueryOptions& limits = query_options();
+        if (row_count_ >= limits.max_rows) {
+            truncated_ = true;
+            return false;
+        }
+        const std::size_t before = out_.size();
+        rows.write_row(row, writer_);
+        if (out_.size() - start_ > limits.max_bytes) {
+            out_.resize(before);
+            truncated_ = true;
+            return false;
+        }
+        ++row_count_;
+        return true;
+    }
+
+    bool truncated() const { return truncated_; }
+    std::size_t row_count() const { return row_count_; }
+
+    void finish() {
+        writer_.end_array();
+        if (truncated_) {
+            out_.insert(start_, "{\"truncated\":true,\"row_count\":" + std::to_string(row_count_) + ",\"rows\":");
+            out_ += '}';
+        }
+    }
+
+private:
+    std::string& out_;
+    const std::size_t start_;
+    mcp::JsonWriter writer_;
+    std::size_t row_count_ = 0;
+    bool truncated_ = false;
+};
+
+// Ejecutar la consulta con un cursor del lado del servidor, leyendo por lotes hasta agotar
+// el resultado o alcanzar DB_MAX_ROWS / DB_MAX_BYTES.
+// Con DB_BINARY_RESULTS el cursor es BINARY y los valores se decodifican desde el formato
+// binario; si alguna columna no tiene decodificador se vuelve a declarar en formato texto.
+inline void write_query_rows(pqxx::transaction_base& txn, const std::string& query, std::string& out) {
+    const QueryOptions& limits = query_options();
+    const std::string sql = strip_statement(query);
+    bool binary = limits.binary_results;
+    pqxx::result description = declare_cursor(txn, sql, binary);
+    if (binary && !mcp::pg::has_binary_decoders(description)) {
+        binary = false;
+        txn.exec("CLOSE mcp_cursor");
+        description = declare_cursor(txn, sql, false);
+    }
+    const RowWriter rows(description, binary);
+
+    CappedRows capped(out);
+    bool done = false;
+    while (!done && !capped.truncated()) {
+        // Pedir como máximo una fila más que el límite para saber si hay que truncar
+        std::size_t batch_size = std::min(limits.fetch_size, limits.max_rows - capped.row_count() + 1);
+        pqxx::result batch = txn.exec("FETCH FORWARD " + std::to_string(batch_size) + " FROM mcp_cursor");
+        for (auto row : batch) {
+            if (!capped.write(rows, row)) break;
+        }
+        done = static_cast<std::size_t>(batch.size()) < batch_size;
+    }
+    txn.exec("CLOSE mcp_cursor");
+    capped.finish();
+}
+
+// Resultado de error de una consulta
+inline std::string query_error(const std::string& message) {
+    json error = {{"error", "Error en la consulta: " + message}};
+    return error.dump();
+}
+
+// Caché de resultados de read_query, acotada por QUERY_CACHE_MAX_BYTES (0 la desactiva)
+inline mcp::QueryCache& query_cache() {
+    static mcp::QueryCache* cache = new mcp::QueryCache(
+        static_cast<std::size_t>(std::max(0L, mcp::env_long("QUERY_CACHE_MAX_BYTES", 64L * 1024 * 1024))),
+        std::chrono::milliseconds(mcp::env_long("QUERY_CACHE_TTL_MS", 60000)));
+    return *cache;
+}
+
+// Caducidad de un resultado según su consulta: las que dependen de la hora o de funciones
+// volátiles no se guardan en caché
+inline std::chrono::milliseconds query_cache_ttl(const std::string& normalized) {
+    static const char* const volatile_markers[] = {
+        "now(", "random(", "clock_timestamp(", "statement_timestamp(", "transaction_timestamp(",
+        "timeofday(", "current_date", "current_time", "localtime", "nextval(", "txid_current", "pg_stat"
+    };
+    for (const char* marker : volatile_markers) {
+        if (normalized.find(marker) != std::string::npos) return std::chrono::milliseconds(0);
+    }
+    return query_cache().default_ttl();
+}
+
+// Ejecutar consulta
+inline std::string read_db_query(const std::string& query) {
+    try {
+        if (query.find("SELECT") != 0 && query.find("select") != 0) {
+            throw std::runtime_error("Solo se permiten consultas SELECT");
+        }
+        const std::string key = mcp::normalize_sql(query);
+        if (auto cached = query_cache().get(key)) return *cached;
+
+        std::string out;
+        {
+            auto conn = db_pool().acquire();
+            pqxx::read_transaction txn(*conn);
+            write_query_rows(txn, query, out);
+        }
+        query_cache().put(key, out, query_cache_ttl(key));
+        return out;
+    } catch (const std::exception& e) {
+        return query_error(e.what());
+    }
+}
+
+// Clave de caché de una consulta de read_queries, aparte de las de read_query: los resultados
+// de un lote se leen de otra forma (un solo FETCH, en texto) y no se mezclan
+inline std::string batch_cache_key(const std::string& query) {
+    return "read_queries\n" + mcp::normalize_sql(query);
+}
+
+// Ejecutar varias consultas SELECT con pqxx::pipeline: se envían juntas dentro de una transacción
+// de solo lectura y los resultados se recogen en un solo viaje de red. Cada consulta se lee con
+// su propio cursor, como en read_query, sin reescribirla: un solo FETCH de DB_MAX_ROWS + 1 filas.
+// Un error en una consulta aborta la transacción, así que se informa en su resultado y las
+// siguientes se reenvían en una transacción nueva.
+// Devuelve [{"query": ..., "result": <mismo formato que read_query>}, ...]
+inline std::string read_db_queries(const std::vector<std::string>& queries) {
+    std::vector<std::string> results(queries.size());
+    std::vector<std::string> keys(queries.size());
+    std::vector<std::size_t> pending;
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        if (queries[i].find("SELECT") != 0 && queries[i].find("select") != 0) {
+            results[i] = query_error("Solo se permiten consultas SELECT");
+            continue;
+        }
+        // Una sentencia de más desalinearía los resultados del pipeline
+        if (scan_statement(queries[i]).statements > 1) {
+            results[i] = query_error("Solo se permite una sentencia por consulta");
+            continue;
+        }
+        keys[i] = batch_cache_key(queries[i]);
+        if (auto cached = query_cache().get(keys[i])) results[i] = *cached;
+        else pending.push_back(i);
+    }
+
+    try {
+        std::size_t next = 0;
+        if (!pending.empty()) {
+            auto conn = db_pool().acquire();
+            while (next < pending.size()) {
+                pqxx::read_transaction txn(*conn);
+                pqxx::pipeline pipe(txn);
+                // Retener todas las consultas (DECLARE y FETCH de cada una) para enviarlas de una vez
+                pipe.retain(static_cast<int>(2 * (pending.size() - next)));
+                const std::string fetch_size = std::to_string(query_options().max_rows + 1);
+                std::vector<std::pair<pqxx::pipeline::query_id, pqxx::pipeline::query_id>> ids;
+                for (std::size_t k = next; k < pending.size(); ++k) {
+                    const std::string cursor = "mcp_batch_" + std::to_string(k);
+                    ids.emplace_back(
+                        pipe.insert("DECLARE " + cursor + " NO SCROLL CURSOR FOR " + strip_statement(queries[pending[k]]) + "\n"),
+                        pipe.insert("FETCH FORWARD " + fetch_size + " FROM " + cursor));
+                }
+                std::size_t k = 0;
+                try {
+                    for (; k < ids.size(); ++k) {
+                        pipe.retrieve(ids[k].first);
+                        pqxx::result res = pipe.retrieve(ids[k].second);
+                        const std::size_t i = pending[next + k];
+                        const RowWriter rows(res, false);
+                        CappedRows capped(results[i]);
+                        for (auto row : res) {
+                            if (!capped.write(rows, row)) break;
+                        }
+                        capped.finish();
+                        query_cache().put(keys[i], results[i], query_cache_ttl(keys[i]));
+                    }
+                    next = pending.size();
+                } catch (const std::exception& e) {
+                    results[pending[next + k]] = query_error(e.what());
+                    next += k + 1;
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        // Fallo de conexión: las consultas sin resultado reciben el error
+        for (std::size_t i : pending) {
+            if (results[i].empty()) results[i] = query_error(e.what());
+        }
+    }
+
+    std::string out;
+    mcp::JsonWriter writer(out);
+    writer.begin_array();
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        writer.begin_object();
+        writer.key("query");
+        writer.string(queries[i]);
+        writer.key("result");
+        writer.raw(results[i]);
+        writer.end_object();
+    }
+    writer.end_array();
+    return out;
+}
+
+// Definición de herramientas
+inline json get_tools(bool schema, bool query) {
+    json tools = json::array();
+    if (schema) {
+        const json schema_format_parameter = {
+            {"type", "string"},
+            {"enum", {"json", "compact", "columns"}},
+            {"description", "Opcional, json por defecto. compact: una línea por tabla, tabla(columna tipo PK/FK→tabla.columna, ...) con filas estimadas, índices y particiones; json: un objeto por tabla con columns, primary_key, foreign_keys, indexes, rows_estimate y partitions; columns: un objeto {table_name, column_name, data_type} por columna."}
+        };
+        tools.push_back({
+            {"type", "function"},
+            {"function", {
+                {"name", "get_schema"},
+                {"description", "Recupera el esquema completo de la base de datos: columnas, claves primarias y foráneas, índices, filas estimadas y particiones."},
+                {"parameters", {
+                    {"type", "object"},
+                    {"properties", {
+                        {"format", schema_format_parameter}
+                    }},
+                    {"required", json::array()}
+                }}
+            }}
+        });
+        tools.push_back({
+            {"type", "function"},
+            {"function", {
+                {"name", "list_tables"},
+                {"description", "Lista las tablas de la base de datos (nombre, tipo y filas estimadas, sin columnas), por páginas. Útil en bases de datos grandes antes de describe_tables."},
+                {"parameters", {
+                    {"type", "object"},
+                    {"properties", {
+                        {"offset", {
+                            {"type", "integer"},
+                            {"minimum", 0},
+                            {"description", "Posición de la primera tabla de la página (por defecto 0)."}
+                        }},
+                        {"limit", {
+                            {"type", "integer"},
+                            {"minimum", 1},
+                            {"maximum", 1000},
+                            {"description", "Número máximo de tablas de la página (por defecto 200)."}
+                        }},
+                        {"format", schema_format_parameter}
+                    }},
+                    {"required", json::array()}
+                }}
+            }}
+        });
+        tools.push_back({
+            {"type", "function"},
+            {"function", {
+                {"name", "describe_tables"},
+                {"description", "Devuelve columnas, claves, índices, filas estimadas y particiones solo de las tablas indicadas."},
+                {"parameters", {
+                    {"type", "object"},
+                    {"properties", {
+                        {"names", {
+                            {"type", "array"},
+                            {"items", {{"type", "string"}}},
+                            {"description", "Nombres de las tablas a describir."}
+                        }},
+                        {"format", schema_format_parameter}
+                    }},
+                    {"required", {"names"}}
+                }}
+            }}
+        });
+    }
+    if (query) {
+        tools.push_back({
+            {"type", "function"},
+            {"function", {
+                {"name", "read_query"},
+                {"description", "Ejecuta una consulta SELECT y devuelve el resultado como una lista de diccionarios."},
+                {"parameters", {
+                    {"type", "object"},
+                    {"properties", {
+                        {"query", {
+                            {"type", "string"},
+                            {"description", "La consulta SQL SELECT a ejecutar."}
+                        }}
+                    }},
+                    {"required", {"query"}}
+                }}
+            }}
+        });
+        tools.push_back({
+            {"type", "function"},
+            {"function", {
+                {"name", "read_queries"},
+                {"description", "Ejecuta varias consultas SELECT en un solo viaje a la base de datos y devuelve, en el mismo orden, una lista de objetos {query, result}. Un error en una consulta no impide ejecutar las demás."},
+                {"parameters", {
+                    {"type", "object"},
+                    {"properties", {
+                        {"queries", {
+                            {"type", "array"},
+                            {"items", {{"type", "string"}}},
+                            {"description", "Las consultas SQL SELECT a ejecutar."}
+                        }}
+                    }},
+                    {"required", {"queries"}}
+                }}
+            }}
+        });
+    }
+    return tools;
+}
+
+// Limpiar JSON: bloque ```json o primer objeto/arreglo de la respuesta (ver json_extract.hpp)
+inline std::string clean_json_str(const std::string& data) {
+    return mcp::extract_json(data);
+}
+
+// Función LLM: recibe mensajes y herramientas, devuelve la respuesta en texto. Con streaming,
+// on_tool_call recibe cada llamada a herramienta en cuanto está completa (puede estar vacío)
+using LlmFn = std::function<std::string(const json&, const json&, const mcp::ToolCallFn&)>;
+
+// Cliente nativo del LLM, configurado con variables de entorno (ver llm_client.hpp)
+inline mcp::LlmClient& llm_client() {
+    static mcp::LlmClient* client = new mcp::LlmClient(mcp::LlmConfig::from_env());
+    return *client;
+}
+
+// LLM sin pasar por Python: petición HTTP directa desde C++, con streaming SSE salvo LLM_STREAM=0
+inline LlmFn native_llm() {
+    return [](const json& messages, const json& tools, const mcp::ToolCallFn& on_tool_call) {
+        mcp::LlmClient& client = llm_client();
+        if (client.config().stream) return client.chat_stream(messages, tools, on_tool_call);
+        return client.chat(messages, tools);
+    };
+}
+
+// Caché de respuestas del LLM por contenido exacto de la petición, desactivada salvo que se fije
+// LLM_CACHE_TTL_MS: reutilizar respuestas cambia el comportamiento no determinista del modelo.
+// Nunca se destruye: los hilos de trabajo pueden seguir usándola al terminar el intérprete
+inline mcp::LlmCache& llm_cache() {
+    static mcp::LlmCache* cache = new mcp::LlmCache(
+        static_cast<std::size_t>(mcp::env_long("LLM_CACHE_MAX_BYTES", 32L * 1024 * 1024)),
+        std::chrono::milliseconds(mcp::env_long("LLM_CACHE_TTL_MS", 0)),
+        mcp::env_string("LLM_CACHE_FILE"),
+        static_cast<std::size_t>(mcp::env_long("LLM_CACHE_FILE_MAX_BYTES", 256L * 1024 * 1024)));
+    return *cache;
+}
+
+// Servir desde la caché las peticiones idénticas (ámbito, mensajes y herramientas). El ámbito
+// del LLM nativo es su endpoint y modelo; un callback de Python no se puede identificar, así que
+// solo se cachea si el llamador da un cache_namespace que distinga el callback, el modelo y sus
+// parámetros. Las respuestas con error no se guardan; con use_cache=false la caché no se
+// consulta ni se llena
+inline LlmFn cached_llm(LlmFn inner, bool native, bool use_cache, const std::string& cache_namespace = "") {
+    if (!use_cache || (!native && cache_namespace.empty()) || !llm_cache().enabled()) return inner;
+    return [inner = std::move(inner), native, cache_namespace](const json& messages, const json& tools,
+                                                               const mcp::ToolCallFn& on_tool_call) {
+        std::string scope = "python " + cache_namespace;
+        if (native) {
+            const mcp::LlmConfig& config = llm_client().config();
+            scope = "native " + config.host + config.path + " " + config.model + "\n" + cache_namespace;
+        }
+        const std::string key = mcp::ContentHash()
+                                    .update(scope)
+                                    .update("\n")
+                                    .update(messages.dump())
+                                    .update("\n")
+                                    .update(tools.dump())
+                                    .hex();
+        if (std::shared_ptr<const std::string> hit = llm_cache().get(key)) {
+            return *hit;
+        }
+        std::string result = inner(messages, tools, on_tool_call);
+        json parsed = json::parse(result, nullptr, false);
+        if (!result.empty() && !(parsed.is_object() && parsed.contains("error"))) {
+            llm_cache().put(key, result);
+        }
+        return result;
+    };
+}
+
+// Resultado de interpretar las respuestas del LLM en run_with_retries, expuesto en get_stats()
+struct RepairCounters {
+    std::atomic<unsigned long long> parsed{0};    // JSON válido a la primera
+    std::atomic<unsigned long long> repaired{0};  // válido tras la reparación local
+    std::atomic<unsigned long long> failed{0};    // irreparable: se vuelve a llamar al LLM
+};
+
+inline RepairCounters& repair_counters() {
+    static RepairCounters* counters = new RepairCounters();
+    return *counters;
+}
+
+// Interpretar la respuesta del LLM; si no es JSON válido se intenta repararla localmente antes
+// de gastar otra llamada al LLM
+inline json parse_llm_json(const std::string& result) {
+    const std::string cleaned = clean_json_str(result);
+    json parsed = json::parse(cleaned, nullptr, false);
+    if (!parsed.is_discarded()) {
+        ++repair_counters().parsed;
+        return parsed;
+    }
+    if (std::optional<std::string> repaired = mcp::repair_json(cleaned)) {
+        ++repair_counters().repaired;
+        return json::parse(*repaired);
+    }
+    ++repair_counters().failed;
+    return json::parse(cleaned);  // lanza json::parse_error con el detalle del fallo
+}
+
+// Validar y reintentar
+inline std::string run_with_retries(const LlmFn& func, const json& messages, const json& tools, int max_retries = 3) {
+    for (int retry = 0; retry < max_retries; ++retry) {
+        try {
+            std::string result = func(messages, tools, nullptr);
+            if (result.empty()) {
+                throw std::runtime_error("Resultado vacío desde la devolución de llamada LLM");
+            }
+            json parsed = parse_llm_json(result);
+            return parsed.dump();
+        } catch (const json::parse_error& e) {
+            if (retry == max_retries - 1) {
+                throw std::runtime_error("Error al parsear JSON después de reintentos: " + std::string(e.what()));
+            }
+        } catch (const std::exception& e) {
+            if (retry == max_retries - 1) {
+                throw std::runtime_error("Fallo después de reintentos: " + std::string(e.what()));
+            }
+        }
+    }
+    throw std::runtime_error("Fallo después de reintentos");
+}
+
+// Llamada a herramienta solicitada por el LLM, ya validada
+struct ToolCall {
+    std::string id;
+    std::string name;
+    json args;
+};
+
+// Validar el nombre y los argumentos de una llamada; lanza std::runtime_error si no son válidos
+inline void check_tool_args(const ToolCall& call) {
+    if (call.name == "read_query") {
+        if (!call.args.contains("query") || !call.args["query"].is_string()) {
+            throw std::runtime_error("Falta el argumento de consulta en la llamada a read_query");
+        }
+    } else if (call.name == "read_queries") {
+        if (!call.args.contains("queries") || !call.args["queries"].is_array()) {
+            throw std::runtime_error("Falta el arreglo de consultas en la llamada a read_queries");
+        }
+    } else if (call.name == "get_schema" || call.name == "list_tables" || call.name == "describe_tables") {
+        if (call.args.contains("format")) {
+            if (!call.args["format"].is_string()) throw std::runtime_error("El argumento format de " + call.name + " debe ser una cadena");
+            mcp::parse_schema_format(call.args["format"].get<std::string>());
+        }
+        if (call.name == "list_tables") {
+            if (!call.args.is_object()) throw std::runtime_error("Los argumentos de list_tables deben ser un objeto");
+            for (const char* key : {"offset", "limit"}) {
+                if (call.args.contains(key) && !call.args[key].is_number_unsigned()) {
+                    throw std::runtime_error(std::string("El argumento ") + key + " de list_tables debe ser un entero no negativo");
+                }
+            }
+        } else if (call.name == "describe_tables") {
+            if (!call.args.contains("names") || !call.args["names"].is_array()) {
+                throw std::runtime_error("Falta el arreglo de nombres en la llamada a describe_tables");
+            }
+            for (const auto& name : call.args["names"]) {
+                if (!name.is_string()) throw std::runtime_error("Los nombres de describe_tables deben ser cadenas");
+            }
+        }
+    } else {
+        throw std::runtime_error("Herramienta desconocida: " + call.name);
+    }
+}
+
+inline ToolCall parse_tool_call(const json& tc) {
+    ToolCall call;
+    call.id = tc["id"].get<std::string>();
+    call.name = tc["function"]["name"].get<std::string>();
+    std::string args_str = tc["function"]["arguments"].get<std::string>();
+    try {
+        call.args = json::parse(args_str);
+    } catch (const json::parse_error& e) {
+        throw std::runtime_error("Error al parsear argumentos de la herramienta: " + std::string(e.what()));
+    }
+    check_tool_args(call);
+    return call;
+}
+
+// Las herramientas no lanzan excepciones: los errores se devuelven como JSON al LLM
+inline std::string execute_tool(const ToolCall& call) {
+    if (call.name == "get_schema" || call.name == "list_tables" || call.name == "describe_tables") {
+        std::optional<mcp::SchemaFormat> format;
+        if (call.args.contains("format")) format = mcp::parse_schema_format(call.args["format"].get<std::string>());
+        if (call.name == "list_tables") {
+            const std::size_t offset = call.args.value("offset", std::size_t{0});
+            const std::size_t limit = std::clamp<std::size_t>(call.args.value("limit", std::size_t{200}), 1, 1000);
+            return list_db_tables(offset, limit, format);
+        }
+        if (call.name == "describe_tables") {
+            return describe_db_tables(call.args["names"].get<std::vector<std::string>>(), format);
+        }
+        return get_db_schema(format);
+    }
+    if (call.name == "read_queries") {
+        std::vector<std::string> queries;
+        for (const auto& q : call.args["queries"]) {
+            queries.push_back(q.is_string() ? q.get<std::string>() : q.dump());
+        }
+        return read_db_queries(queries);
+    }
+    return read_db_query(call.args["query"].get<std::string>());
+}
+
+// Hilos que ejecutan las herramientas en paralelo, tantos como conexiones admite el pool: una
+// llamada de más solo esperaría una conexión libre hasta agotar DB_POOL_ACQUIRE_TIMEOUT_MS
+inline mcp::ThreadPool& tool_workers() {
+    // Igual que el pool de conexiones, nunca se destruye
+    static mcp::ThreadPool* workers = new mcp::ThreadPool(mcp::PoolConfig::from_env().max_size);
+    return *workers;
+}
+
+// Encolar una tarea en tool_workers(); el future entrega su resultado o su excepción
+inline std::future<std::string> run_on_tool_workers(std::function<std::string()> task) {
+    auto packaged = std::make_shared<std::packaged_task<std::string()>>(std::move(task));
+    std::future<std::string> result = packaged->get_future();
+    tool_workers().submit([packaged] { (*packaged)(); });
+    return result;
+}
+
+// Herramientas lanzadas en tool_workers() durante el streaming de la respuesta, antes de que el
+// LLM termine, indexadas por tool_call_id. Todas son de solo lectura, así que adelantarlas no tiene efectos
+class ToolPrefetch {
+public:
+    // Callback para el LLM; las llamadas inválidas se ignoran y run_tool_calls las reporta
+    void start(const json& tc) {
+        ToolCall call;
+        try {
+            call = parse_tool_call(tc);
+        } catch (const std::exception&) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (call.id.empty() || pending_.count(call.id)) return;
+        std::string id = call.id;
+        pending_.emplace(std::move(id), run_on_tool_workers([call = std::move(call)] { return execute_tool(call); }));
+    }
+
+    // Resultado adelantado de la llamada, o un future inválido si no se lanzó
+    std::future<std::string> take(const std::string& id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(id);
+        if (it == pending_.end()) return {};
+        std::future<std::string> result = std::move(it->second);
+        pending_.erase(it);
+        return result;
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::future<std::string>> pending_;
+};
+
+// Ejecutar las llamadas de un mismo turno en paralelo en tool_workers() (cada una con su
+// conexión del pool) y añadir los mensajes de herramienta en el orden original. Las que ya se lanzaron durante
+// el streaming solo se esperan
+inline void run_tool_calls(const json& tool_calls, json& messages, ToolPrefetch& prefetch) {
+    std::vector<ToolCall> calls;
+    calls.reserve(tool_calls.size());
+    for (const auto& tc : tool_calls) {
+        calls.push_back(parse_tool_call(tc));
+    }
+
+    std::vector<std::string> results(calls.size());
+    std::vector<std::future<std::string>> pending(calls.size());
+    for (std::size_t i = 0; i < calls.size(); ++i) {
+        pending[i] = prefetch.take(calls[i].id);
+        if (pending[i].valid()) continue;
+        if (calls.size() == 1) {
+            results[i] = execute_tool(calls[i]);
+        } else {
+            pending[i] = run_on_tool_workers([call = calls[i]] { return execute_tool(call); });
+        }
+    }
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        if (pending[i].valid()) results[i] = pending[i].get();
+    }
+
+    for (std::size_t i = 0; i < calls.size(); ++i) {
+        messages.push_back({
+            {"role", "tool"},
+            {"tool_call_id", calls[i].id},
+            {"name", calls[i].name},
+            {"content", std::move(results[i])}
+        });
+    }
+}
+
+// Respuesta de chat completions devuelta por el callback. Se interpreta tal cual antes de buscar
+// el JSON dentro del texto: el contenido del mensaje puede traer su propio bloque ```json
+inline json parse_completion(const std::string& result) {
+    json response = json::parse(result, nullptr, false);
+    return response.is_discarded() ? json::parse(clean_json_str(result)) : response;
+}
+
+// Texto de la respuesta: el content de una respuesta de chat completions o, si no lo es, el
+// texto tal cual
+inline std::string completion_text(const std::string& result) {
+    json response = json::parse(result, nullptr, false);
+    if (response.is_object() && response.contains("choices") && response["choices"].is_array() &&
+        !response["choices"].empty() && response["choices"][0].is_object()) {
+        const json& message = response["choices"][0].value("message", json());
+        if (message.is_object() && message.contains("content") && message["content"].is_string()) {
+            return message["content"].get<std::string>();
+        }
+    }
+    return result;
+}
+
+// Conversación con herramientas: llamar al LLM, ejecutar las tool_calls que pida y repetir hasta
+// que responda con contenido (como máximo 10 rondas). Devuelve ese contenido
+inline std::string complete_with_tools(json messages, const json& tools, const LlmFn& llm_callback) {
+    ToolPrefetch prefetch;
+    const mcp::ToolCallFn on_tool_call = [&prefetch](const json& tc) { prefetch.start(tc); };
+
+    std::string result = llm_callback(messages, tools, on_tool_call);
+    json response = parse_completion(result);
+
+    if (response.contains("error")) {
+        throw std::runtime_error(response["error"]["message"].get<std::string>());
+    }
+
+    if (!response.contains("choices") || response["choices"].empty()) {
+        throw std::runtime_error("No hay opciones en la respuesta del LLM");
+    }
+
+    json choice = response["choices"][0];
+    json message_response = choice["message"];
+    // Asegurar que el mensaje tenga un rol
+    message_response["role"] = "assistant";
+    messages.push_back(message_response);
+
+    int max_loops = 10;
+    while (message_response.contains("tool_calls") && !message_response["tool_calls"].empty() && max_loops > 0) {
+        run_tool_calls(message_response["tool_calls"], messages, prefetch);
+
+        result = llm_callback(messages, tools, on_tool_call);
+        response = parse_completion(result);
+        if (response.contains("error")) {
+            throw std::runtime_error(response["error"]["message"].get<std::string>());
+        }
+        if (!response.contains("choices") || response["choices"].empty()) {
+            throw std::runtime_error("No hay opciones en la respuesta del LLM");
+        }
+        choice = response["choices"][0];
+        message_response = choice["message"];
+        message_response["role"] = "assistant";
+        messages.push_back(message_response);
+        max_loops--;
+    }
+
+    if (message_response.contains("content") && !message_response["content"].is_null()) {
+        return message_response["content"].get<std::string>();
+    } else {
+        throw std::runtime_error("No hay contenido válido en la respuesta final del LLM");
+    }
+}
+
+// LlmFn cuyo resultado es el contenido final del bucle de herramientas, para las etapas que
+// pasan por run_with_retries y ofrecen herramientas al LLM
+inline LlmFn with_tool_loop(const LlmFn& llm_callback) {
+    return [llm_callback](const json& messages, const json& tools, const mcp::ToolCallFn&) {
+        return complete_with_tools(messages, tools, llm_callback);
+    };
+}
+
+inline std::string run_agent(const std::string& message, const LlmFn& llm_callback) {
+    try {
+        return complete_with_tools(agent_messages(INSTRUCTIONS, message), get_tools(true, true), llm_callback);
+    } catch (const std::exception& e) {
+        return "Error en run_agent: " + std::string(e.what());
+    }
+}
+
+// Las herramientas del análisis (get_schema) se ejecutan en el bucle de complete_with_tools;
+// devuelve el JSON del análisis
+inline std::string analyze_database(const std::string& message, const LlmFn& llm_callback) {
+    try {
+        json messages = agent_messages(INSTRUCTIONS_DB_ANALYSIS_AND_SQL, message);
+
+        json tools = get_tools(true, false);
+
+        return run_with_retries(with_tool_loop(llm_callback), messages, tools);
+    } catch (const std::exception& e) {
+        return "Error en analyze_database: " + std::string(e.what());
+    }
+}
+
+// Documento JSON de una respuesta del LLM, reparado si hace falta. Si es la respuesta completa
+// de chat completions se interpreta el contenido del mensaje. Devuelve discarded si no hay JSON
+inline nlohmann::ordered_json llm_json_document(const std::string& text) {
+    auto parse = [](const std::string& text) {
+        nlohmann::ordered_json doc = nlohmann::ordered_json::parse(text, nullptr, false);
+        if (doc.is_discarded()) {
+            if (std::optional<std::string> repaired = mcp::repair_json(text)) {
+                doc = nlohmann::ordered_json::parse(*repaired, nullptr, false);
+            }
+        }
+        return doc;
+    };
+    nlohmann::ordered_json doc = nlohmann::ordered_json::parse(text, nullptr, false);
+    if (doc.is_discarded()) doc = parse(clean_json_str(text));
+    if (doc.is_object() && !doc.contains("metrics") && doc.contains("choices") && doc["choices"].is_array() &&
+        !doc["choices"].empty()) {
+        const auto& choice = doc["choices"][0];
+        auto message = choice.is_object() ? choice.find("message") : choice.end();
+        if (message != choice.end() && message->is_object() && message->contains("content") &&
+            (*message)["content"].is_string()) {
+            doc = parse(clean_json_str((*message)["content"].get<std::string>()));
+        }
+    }
+    return doc;
+}
+
+// Datos del dashboard. El LLM escribe las consultas de las métricas del análisis y las ejecuta
+// con read_queries en el bucle de herramientas; devuelve el JSON de métricas con sus datos
+inline std::string get_data_from_database(const std::string& analysis_json, const LlmFn& llm_callback) {
+    try {
+        json messages = {
+            {{"role", "system"}, {"content", INSTRUCTIONS_SQL_METRIC_DATA_JSON_ONLY}},
+            {{"role", "user"}, {"content", analysis_json}}
+        };
+
+        json tools = get_tools(false, true);
+
+        return run_with_retries(with_tool_loop(llm_callback), messages, tools);
+    } catch (const std::exception& e) {
+        return "Error en get_data_from_database: " + std::string(e.what());
+    }
+}
+
+// Métricas con datos para el dashboard (ver llm_json_document)
+inline nlohmann::ordered_json dashboard_data(const std::string& data_json) {
+    return llm_json_document(data_json);
+}
+
+// Por defecto el HTML se genera en C++ (dashboard_renderer.hpp) y solo se le pide al LLM si los
+// datos no tienen la forma {"metrics": [...]}; DASHBOARD_RENDER=llm se lo pide primero al LLM y
+// usa el renderizador nativo como respaldo
+inline bool llm_renders_dashboard() {
+    static const bool llm = mcp::env_string("DASHBOARD_RENDER", "native") == "llm";
+    return llm;
+}
+
+inline std::string generate_html_dashboard(const std::string& data_json, const LlmFn& llm_callback) {
+    const char* const no_data =
+        "<html><body><h1>Error</h1><p>No se encontraron datos válidos para generar el dashboard. Verifique que las "
+        "consultas SQL devuelvan datos de las tablas sales, customers y products.</p></body></html>";
+    auto llm_html = [&]() -> std::optional<std::string> {
+        json messages = {
+            {{"role", "system"}, {"content", INSTRUCTIONS_RENDER_DASHBOARD_FROM_DATA}},
+            {{"role", "user"}, {"content", data_json}}
+        };
+        std::string html = completion_text(llm_callback(messages, json::array(), nullptr));
+        if (std::optional<std::string_view> block = mcp::find_fenced_block(html, "html")) {
+            return std::string(*block);
+        }
+        return std::nullopt;
+    };
+    try {
+        const bool llm_first = llm_renders_dashboard();
+        if (llm_first) {
+            if (std::optional<std::string> html = llm_html()) return *html;
+            // Si no se encuentra un bloque HTML, se genera el dashboard a partir de los datos
+        }
+        if (std::optional<std::string> html = mcp::render_dashboard(dashboard_data(data_json))) {
+            return *html;
+        }
+        // Datos con otra forma (por ejemplo, los que escribe el LLM cuando el análisis no trae SQL)
+        if (!llm_first) {
+            if (std::optional<std::string> html = llm_html()) return *html;
+        }
+        return no_data;
+    } catch (const std::exception& e) {
+        std::cerr << "Error en generate_html_dashboard: " << e.what() << std::endl;
+        return "<html><body><h1>Error</h1><p>Error en generate_html_dashboard: " + std::string(e.what()) + "</p></body></html>";
+    }
+}
+
+inline std::string run_dashboard_agent(const std::string& message, const LlmFn& llm_callback) {
+    try {
+        std::string analysis_json = analyze_database(message, llm_callback);
+        std::string data_json = get_data_from_database(analysis_json, llm_callback);
+        return generate_html_dashboard(data_json, llm_callback);
+    } catch (const std::exception& e) {
+        return "<html><body><h1>Error</h1><p>Error en run_dashboard_agent: " + std::string(e.what()) + "</p></body></html>";
+    }
+}
+
+// Contadores internos expuestos con get_stats() en Python y /stats en el servidor HTTP
+inline json agent_stats() {
+    mcp::QueryCache::Stats cache = query_cache().stats();
+    mcp::ConnectionPool::Stats pool = db_pool().stats();
+    mcp::LlmCache::Stats llm = llm_cache().stats();
+    mcp::SchemaSearchCache::Stats search = schema_search().stats();
+    return {
+        {"query_cache", {
+            {"hits", cache.hits},
+            {"misses", cache.misses},
+            {"evictions", cache.evictions},
+            {"expirations", cache.expirations},
+            {"entries", cache.entries},
+            {"bytes", cache.bytes}
+        }},
+        {"llm_cache", {
+            {"hits", llm.memory.hits},
+            {"misses", llm.memory.misses},
+            {"evictions", llm.memory.evictions},
+            {"expirations", llm.memory.expirations},
+            {"entries", llm.memory.entries},
+            {"bytes", llm.memory.bytes},
+            {"disk_hits", llm.disk.hits},
+            {"disk_entries", llm.disk.entries},
+            {"disk_bytes", llm.disk.bytes}
+        }},
+        {"json_repair", {
+            {"parsed", repair_counters().parsed.load()},
+            {"repaired", repair_counters().repaired.load()},
+            {"failed", repair_counters().failed.load()}
+        }},
+        {"schema_search", {
+            {"builds", search.builds},
+            {"tables", search.tables},
+            {"terms", search.terms},
+            {"reused", search.reused}
+        }},
+        {"connection_pool", {
+            {"total", pool.total},
+            {"idle", pool.idle},
+            {"created", pool.created},
+            {"reused", pool.reused},
+            {"discarded", pool.discarded},
+            {"timeouts", pool.timeouts}
+        }}
+    };
+}
+
+}  // namespace mcp::agent
@@ -0,0 +1,127 @@
+// Servidor HTTP nativo del agente sobre httplib.h, sin Python ni FastAPI: usa el cliente
+// nativo del LLM y el mismo núcleo que el módulo cpp_agent (agent_core.hpp).
+//
+//   POST /run_agent            {"message": "...", "use_cache": true}  -> {"result": "..."}
+//   POST /run_dashboard_agent  {"message": "...", "use_cache": true}  -> {"result": "<html>..."}
+//   GET  /stats                contadores de cachés, reparaciones y pool de conexiones
+//   GET  /health
+//
+// El cuerpo también puede ser el mensaje como texto plano. Las respuestas se comprimen con gzip
+// cuando el cliente envía Accept-Encoding: gzip.
+//
+// Compilar:
+//   g++ -O2 -std=c++17 -Iinclude -I. agent_server.cpp -o agent_server -lpqxx -lpq -lz -pthread
+// (para endpoints https del LLM añadir -DCPPHTTPLIB_OPENSSL_SUPPORT -lssl -lcrypto)
+#define CPPHTTPLIB_ZLIB_SUPPORT
+#include <httplib/httplib.h>
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <ctime>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "agent_core.hpp"
+#include "env.hpp"
+
+namespace {
+using namespace mcp::agent;
+
+// Mensaje y opciones de una petición al agente
+struct AgentRequest {
+    std::string message;
+    bool use_cache = true;
+};
+
+AgentRequest parse_agent_request(const httplib::Request& req) {
+    AgentRequest out;
+    const std::string content_type = req.get_header_value("Content-Type");
+    if (content_type.rfind("text/plain", 0) == 0) {
+        out.message = req.body;
+    } else {
+        json body = json::parse(req.body, nullptr, false);
+        if (!body.is_object()) {
+            throw std::runtime_error("El cuerpo debe ser un objeto JSON con el campo \"message\"");
+        }
+        auto message = body.find("message");
+        if (message == body.end() || !message->is_string()) {
+            throw std::runtime_error("Falta el campo \"message\" o no es una cadena");
+        }
+        out.message = message->get<std::string>();
+        auto use_cache = body.find("use_cache");
+        if (use_cache != body.end()) {
+            if (!use_cache->is_boolean()) throw std::runtime_error("\"use_cache\" debe ser booleano");
+            out.use_cache = use_cache->get<bool>();
+        }
+    }
+    if (out.message.empty()) throw std::runtime_error("El mensaje está vacío");
+    return out;
+}
+
+void reply_json(httplib::Response& res, int status, const json& body) {
+    res.status = status;
+    res.set_content(body.dump(), "application/json");
+}
+
+// Manejador POST para un agente; los errores del agente ya vienen como texto en el resultado,
+// así que aquí solo se rechazan peticiones mal formadas
+httplib::Server::Handler agent_handler(std::string (*agent)(const std::string&, const LlmFn&)) {
+    return [agent](const httplib::Request& req, httplib::Response& res) {
+        AgentRequest request;
+        try {
+            request = parse_agent_request(req);
+        } catch (const std::exception& e) {
+            reply_json(res, 400, {{"error", e.what()}});
+            return;
+        }
+        LlmFn llm = cached_llm(native_llm(), true, request.use_cache);
+        reply_json(res, 200, {{"result", agent(request.message, llm)}});
+    };
+}
+
+}  // namespace
+
+int main() {
+    const std::string host = mcp::env_string("AGENT_SERVER_HOST", "0.0.0.0");
+    const int port = static_cast<int>(mcp::env_long("AGENT_SERVER_PORT", 8000));
+    const auto threads = static_cast<std::size_t>(mcp::env_long("AGENT_SERVER_THREADS", 32));
+    // 0: sin límite; con límite, las conexiones que no caben en la cola se cierran al aceptarlas
+    const auto max_queued = static_cast<std::size_t>(mcp::env_long("AGENT_SERVER_MAX_QUEUED", 0));
+
+    httplib::Server server;
+    // Cada petición ocupa un hilo mientras espera al LLM, así que el pool se dimensiona aparte
+    // del valor por defecto de httplib (número de núcleos)
+    server.new_task_queue = [threads, max_queued] { return new httplib::ThreadPool(threads, max_queued); };
+    server.set_tcp_nodelay(true);
+    server.set_keep_alive_max_count(static_cast<std::size_t>(mcp::env_long("AGENT_SERVER_KEEPALIVE_MAX", 100)));
+    server.set_keep_alive_timeout(static_cast<time_t>(mcp::env_long("AGENT_SERVER_KEEPALIVE_TIMEOUT_S", 5)));
+    server.set_payload_max_length(static_cast<std::size_t>(mcp::env_long("AGENT_SERVER_MAX_BODY_BYTES", 1 << 20)));
+
+    server.Post("/run_agent", agent_handler(&run_agent));
+    server.Post("/run_dashboard_agent", agent_handler(&run_dashboard_agent));
+    server.Get("/stats", [](const httplib::Request&, httplib::Response& res) {
+        reply_json(res, 200, agent_stats());
+    });
+    server.Get("/health", [](const httplib::Request&, httplib::Response& res) {
+        reply_json(res, 200, {{"status", "ok"}});
+    });
+    server.set_exception_handler([](const httplib::Request&, httplib::Response& res, std::exception_ptr ep) {
+        std::string message = "Error desconocido";
+        try {
+            std::rethrow_exception(ep);
+        } catch (const std::exception& e) {
+            message = e.what();
+        } catch (...) {
+        }
+        std::cerr << "Error en agent_server: " << message << std::endl;
+        reply_json(res, 500, {{"error", message}});
+    });
+
+    std::cerr << "agent_server escuchando en " << host << ":" << port << " con " << threads << " hilos" << std::endl;
+    if (!server.listen(host, port)) {
+        std::cerr << "No se pudo escuchar en " << host << ":" << port << std::endl;
+        return 1;
+    }
+    return 0;
+}
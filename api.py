@@ -1,6 +1,6 @@
 from fastapi import FastAPI
 import cpp_agent
-from openai import AzureOpenAI
+from openai import AsyncAzureOpenAI
 import os
 import json
 import logging
@@ -23,16 +23,17 @@ AZURE_OPENAI_API_VERSION = os.getenv("AZURE_OPENAI_API_VERSION", "2024-02-15-pre
 if not all([AZURE_OPENAI_ENDPOINT, AZURE_OPENAI_API_KEY]):
     raise ValueError("Missing Azure OpenAI environment variables")
 
-client = AzureOpenAI(
+client = AsyncAzureOpenAI(
     azure_endpoint=AZURE_OPENAI_ENDPOINT,
     api_key=AZURE_OPENAI_API_KEY,
     api_version=AZURE_OPENAI_API_VERSION
 )
 
-def llm_callback(messages, tools):
+# cpp_agent ejecuta esta corrutina en el event loop desde su pool de hilos
+async def llm_callback(messages, tools):
     try:
         logger.info(f"Sending request to Azure OpenAI with messages: {messages}")
-        response = client.chat.completions.create(
+        response = await client.chat.completions.create(
             model=AZURE_OPENAI_DEPLOYMENT,
             messages=messages,
             tools=tools if tools else [],
@@ -58,7 +59,7 @@ def llm_callback(messages, tools):
 async def run_agent(query: str):
     try:
         logger.info(f"Processing query: {query}")
-        result = cpp_agent.run_agent(query, llm_callback)
+        result = await cpp_agent.run_agent_async(query, llm_callback)
         logger.info(f"Query result: {result}")
         return {"result": result}
     except Exception as e:
@@ -69,7 +70,7 @@ async def run_agent(query: str):
 async def run_dashboard_agent(query: str):
     try:
         logger.info(f"Processing dashboard query: {query}")
-        result = cpp_agent.run_dashboard_agent(query, llm_callback)
+        result = await cpp_agent.run_dashboard_agent_async(query, llm_callback)
         logger.info(f"Dashboard result length: {len(result)}")
         return {"result": result}
     except Exception as e:
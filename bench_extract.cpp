@@ -0,0 +1,138 @@
+// Microbenchmark de la extracción de JSON y HTML de las respuestas del LLM. Compara
+// json_extract.hpp con la implementación anterior basada en std::regex (clean_json_str y el
+// bloque ```html de generate_html_dashboard), copiada aquí tal cual.
+//
+// Compilar y ejecutar:
+//   g++ -O2 -std=c++17 -Iinclude -I. bench_extract.cpp -o bench_extract && ./bench_extract
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <regex>
+#include <string>
+
+#include "json_extract.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+std::string legacy_clean_json_str(const std::string& data) {
+    if (data.empty()) {
+        return "{}";
+    }
+    std::regex code_block(R"(```json\s*([\s\S]*?)\s*```)");
+    std::smatch match;
+    if (std::regex_search(data, match, code_block)) {
+        return match[1].str();
+    }
+    size_t start = data.find('{');
+    if (start == std::string::npos) start = data.find('[');
+    if (start == std::string::npos) {
+        return "{}";
+    }
+    int brace_count = 0;
+    char start_char = data[start];
+    char end_char = (start_char == '{') ? '}' : ']';
+    for (size_t i = start; i < data.length(); ++i) {
+        if (data[i] == start_char) brace_count++;
+        if (data[i] == end_char) brace_count--;
+        if (brace_count == 0) {
+            return data.substr(start, i - start + 1);
+        }
+    }
+    return "{}";
+}
+
+std::string legacy_html_block(const std::string& html) {
+    std::regex html_block(R"(```html\s*([\s\S]*?)\s*```)");
+    std::smatch match;
+    if (std::regex_search(html, match, html_block)) {
+        return match[1].str();
+    }
+    return "";
+}
+
+// Respuesta típica del paso de métricas: JSON de `rows` filas, con o sin bloque ```json
+std::string metrics_answer(int rows, bool fenced) {
+    json metrics = json::array();
+    for (int i = 0; i < rows; ++i) {
+        metrics.push_back({{"name", "Producto " + std::to_string(i)},
+                           {"total_sales", i * 10.5},
+                           {"note", "incluye {llaves} y [corchetes] en texto"}});
+    }
+    json answer = {{"metrics", {{{"title", "Ventas"}, {"visualization_type", "bar_chart"}, {"data", metrics}}}}};
+    std::string body = answer.dump(2);
+    if (!fenced) return "Estos son los datos solicitados:\n" + body + "\nAvíseme si necesita algo más.";
+    return "Estos son los datos solicitados:\n```json\n" + body + "\n```\nAvíseme si necesita algo más.";
+}
+
+std::string html_answer(int rows) {
+    std::string html = "<!DOCTYPE html><html><head><title>Dashboard</title></head><body>\n";
+    for (int i = 0; i < rows; ++i) {
+        html += "<tr><td>Producto " + std::to_string(i) + "</td><td>" + std::to_string(i * 10.5) + "</td></tr>\n";
+    }
+    html += "<script>const data = `plantilla`;</script></body></html>";
+    return "Aquí está el dashboard:\n```html\n" + html + "\n```\n";
+}
+
+// Mejor tiempo medio por llamada de `iterations` ejecuciones, en microsegundos
+double best_us(int rounds, int iterations, const std::function<std::size_t()>& fn) {
+    double best = 1e300;
+    std::size_t sink = 0;
+    for (int r = 0; r < rounds; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) sink += fn();
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / iterations);
+    }
+    if (sink == 0) std::printf("(sin resultados)\n");
+    return best;
+}
+
+void report(const char* name, std::size_t bytes, double legacy, double fast, bool same) {
+    std::printf("%-26s %8zu B  regex %10.1f us  escáner %8.1f us  x%-7.1f %s\n", name, bytes, legacy, fast,
+                legacy / fast, same ? "" : "(resultado distinto)");
+}
+
+}  // namespace
+
+int main() {
+    const int rounds = 5;
+    const int iterations = 20;
+
+    // Tamaños moderados: el std::regex de libstdc++ es recursivo y con [\s\S]*? desborda una pila
+    // de 8 MiB a partir de unos 60 KB de entrada (el escáner no tiene ese límite)
+    for (int rows : {10, 50, 100}) {
+        const std::string fenced = metrics_answer(rows, true);
+        const std::string bare = metrics_answer(rows, false);
+        const std::string html = html_answer(rows);
+
+        std::string label = "```json, " + std::to_string(rows) + " filas";
+        report(label.c_str(), fenced.size(),
+               best_us(rounds, iterations, [&] { return legacy_clean_json_str(fenced).size(); }),
+               best_us(rounds, iterations, [&] { return mcp::extract_json(fenced).size(); }),
+               legacy_clean_json_str(fenced) == mcp::extract_json(fenced));
+
+        // Sin bloque el regex recorre todo el texto antes de recurrir al conteo de llaves; el
+        // conteo anterior además no ignora las llaves dentro de cadenas
+        label = "JSON sin bloque, " + std::to_string(rows);
+        report(label.c_str(), bare.size(),
+               best_us(rounds, iterations, [&] { return legacy_clean_json_str(bare).size(); }),
+               best_us(rounds, iterations, [&] { return mcp::extract_json(bare).size(); }),
+               legacy_clean_json_str(bare) == mcp::extract_json(bare));
+
+        label = "```html, " + std::to_string(rows) + " filas";
+        report(label.c_str(), html.size(),
+               best_us(rounds, iterations, [&] { return legacy_html_block(html).size(); }),
+               best_us(rounds, iterations, [&] { return mcp::find_fenced_block(html, "html")->size(); }),
+               legacy_html_block(html) == std::string(*mcp::find_fenced_block(html, "html")));
+    }
+
+    // Llaves dentro de cadenas: el conteo anterior corta el objeto antes de tiempo
+    const std::string tricky = R"(Resultado: {"label": "total }", "values": [1, 2]} fin)";
+    std::printf("\nllaves en cadenas:\n  regex:   %s\n  escáner: %s\n", legacy_clean_json_str(tricky).c_str(),
+                mcp::extract_json(tricky).c_str());
+    return 0;
+}
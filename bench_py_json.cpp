@@ -0,0 +1,196 @@
+// Microbenchmark de la conversión json ⇄ Python con cargas del tamaño de un resultado de
+// read_query. Compara py_json.hpp con una conversión recursiva equivalente a la del antiguo
+// type_caster (una cadena nueva por clave, listas sin tamaño reservado) y, si pybind11 está
+// disponible, con el propio type_caster anterior.
+//
+// Compilar y ejecutar:
+//   g++ -O2 -std=c++17 -Iinclude -I. $(python3-config --includes) bench_py_json.cpp
+//       $(python3-config --ldflags --embed) -o bench_py_json && ./bench_py_json [filas]
+// (en una sola línea)
+#include <Python.h>
+#if __has_include(<pybind11/pybind11.h>)
+#include <pybind11/pybind11.h>
+#define BENCH_HAS_PYBIND11 1
+#endif
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+
+#include "py_json.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+// Mensaje de herramienta con el resultado de una consulta de `rows` filas
+json make_payload(int rows) {
+    json result = json::array();
+    for (int i = 0; i < rows; ++i) {
+        result.push_back({
+            {"id", i},
+            {"customer_name", "Cliente " + std::to_string(i)},
+            {"email", "cliente" + std::to_string(i) + "@example.com"},
+            {"total_amount", i * 1.25},
+            {"quantity", i % 17},
+            {"is_active", i % 3 != 0},
+            {"created_at", "2024-05-01 12:34:56"},
+            {"notes", i % 5 == 0 ? json(nullptr) : json("sin observaciones")},
+            {"tags", {"a", "b", i % 2 ? "c" : "d"}},
+        });
+    }
+    return json::array({
+        {{"role", "system"}, {"content", "Instrucciones del sistema"}},
+        {{"role", "user"}, {"content", "¿Cuáles son las ventas por cliente?"}},
+        {{"role", "tool"}, {"tool_call_id", "call_1"}, {"name", "read_query"}, {"content", result.dump()}},
+        {{"role", "tool"}, {"tool_call_id", "call_2"}, {"name", "read_query_rows"}, {"content", result}},
+    });
+}
+
+// Conversión recursiva con el mismo algoritmo que el type_caster anterior, sin pybind11
+PyObject* recursive_to_py(const json& src) {
+    if (src.is_object()) {
+        PyObject* dict = PyDict_New();
+        for (auto& [key, val] : src.items()) {
+            PyObject* k = PyUnicode_FromStringAndSize(key.data(), static_cast<Py_ssize_t>(key.size()));
+            PyObject* v = recursive_to_py(val);
+            PyDict_SetItem(dict, k, v);
+            Py_DECREF(k);
+            Py_DECREF(v);
+        }
+        return dict;
+    }
+    if (src.is_array()) {
+        PyObject* list = PyList_New(0);
+        for (auto& val : src) {
+            PyObject* v = recursive_to_py(val);
+            PyList_Append(list, v);
+            Py_DECREF(v);
+        }
+        return list;
+    }
+    if (src.is_string()) {
+        const auto& s = src.get_ref<const std::string&>();
+        return PyUnicode_FromStringAndSize(s.data(), static_cast<Py_ssize_t>(s.size()));
+    }
+    if (src.is_boolean()) return PyBool_FromLong(src.get<bool>());
+    if (src.is_number_integer()) return PyLong_FromLong(src.get<long>());
+    if (src.is_number_float()) return PyFloat_FromDouble(src.get<double>());
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+#ifdef BENCH_HAS_PYBIND11
+namespace py = pybind11;
+
+// El type_caster<nlohmann::json>::cast anterior, tal cual
+py::handle legacy_cast(nlohmann::json src) {
+    if (src.is_object()) {
+        py::dict dict;
+        for (auto& [key, val] : src.items()) {
+            dict[py::str(key)] = legacy_cast(val);
+        }
+        return dict.release();
+    } else if (src.is_array()) {
+        py::list list;
+        for (auto& val : src) {
+            list.append(legacy_cast(val));
+        }
+        return list.release();
+    } else if (src.is_string()) {
+        return py::str(src.get<std::string>()).release();
+    } else if (src.is_boolean()) {
+        return py::bool_(src.get<bool>()).release();
+    } else if (src.is_number_integer()) {
+        return py::int_(src.get<long>()).release();
+    } else if (src.is_number_float()) {
+        return py::float_(src.get<double>()).release();
+    }
+    return py::none().release();
+}
+#endif
+
+// Mejor tiempo de `iterations` ejecuciones, en milisegundos
+double best_ms(int iterations, const std::function<void()>& fn) {
+    double best = 1e300;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void check(PyObject* obj) {
+    if (!obj) {
+        PyErr_Print();
+        std::exit(1);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int rows = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const int iterations = 10;
+    Py_Initialize();
+
+    const json payload = make_payload(rows);
+    std::printf("carga: %d filas, %zu bytes serializados\n\n", rows, payload.dump().size());
+
+    // json -> Python
+    const double fast = best_ms(iterations, [&] {
+        PyObject* obj = mcp::json_to_py(payload);
+        check(obj);
+        Py_DECREF(obj);
+    });
+    const double recursive = best_ms(iterations, [&] {
+        PyObject* obj = recursive_to_py(payload);
+        check(obj);
+        Py_DECREF(obj);
+    });
+    std::printf("json -> Python\n");
+    std::printf("  py_json.hpp (iterativo)        %9.2f ms\n", fast);
+    std::printf("  recursivo, API de C            %9.2f ms  (x%.2f)\n", recursive, recursive / fast);
+#ifdef BENCH_HAS_PYBIND11
+    const double legacy = best_ms(iterations, [&] { py::handle(legacy_cast(payload)).dec_ref(); });
+    std::printf("  type_caster anterior (pybind11) %8.2f ms  (x%.2f)\n", legacy, legacy / fast);
+#endif
+
+    // Python -> json
+    PyObject* obj = mcp::json_to_py(payload);
+    check(obj);
+    PyObject* json_module = PyImport_ImportModule("json");
+    check(json_module);
+    PyObject* dumps = PyObject_GetAttrString(json_module, "dumps");
+    check(dumps);
+
+    json back;
+    const double to_json = best_ms(iterations, [&] {
+        json out;
+        if (!mcp::py_to_json(obj, out)) check(nullptr);
+        back = std::move(out);
+    });
+    const double via_text = best_ms(iterations, [&] {
+        PyObject* text = PyObject_CallOneArg(dumps, obj);
+        check(text);
+        Py_ssize_t size = 0;
+        const char* data = PyUnicode_AsUTF8AndSize(text, &size);
+        json out = json::parse(data, data + size);
+        Py_DECREF(text);
+    });
+    std::printf("\nPython -> json\n");
+    std::printf("  py_json.hpp (iterativo)        %9.2f ms\n", to_json);
+    std::printf("  json.dumps + json::parse       %9.2f ms  (x%.2f)\n", via_text, via_text / to_json);
+    std::printf("\nida y vuelta idéntica: %s\n", back == payload ? "sí" : "NO");
+
+    Py_DECREF(dumps);
+    Py_DECREF(json_module);
+    Py_DECREF(obj);
+    Py_Finalize();
+    return back == payload ? 0 : 1;
+}
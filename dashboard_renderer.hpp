@@ -0,0 +1,474 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mcp {
+
+// Renderizado determinista del dashboard a partir del JSON de métricas, sin pasar por el LLM.
+// Se usa nlohmann::ordered_json para conservar el orden de las columnas de cada consulta.
+namespace dashboard {
+
+using ojson = nlohmann::ordered_json;
+
+inline constexpr const char* kPalette[] = {"#4CAF50", "#2196F3", "#FF9800", "#F44336", "#9C27B0",
+                                           "#00BCD4", "#FFC107", "#795548", "#607D8B", "#E91E63"};
+inline constexpr std::size_t kPaletteSize = sizeof(kPalette) / sizeof(kPalette[0]);
+
+inline std::string escape_html(std::string_view s) {
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            case '\'': out += "&#39;"; break;
+            default: out += c;
+        }
+    }
+    return out;
+}
+
+// JSON para incrustar en un <script>: "</" cerraría la etiqueta antes de tiempo
+inline std::string script_json(const ojson& value) {
+    std::string text = value.dump(-1, ' ', false, ojson::error_handler_t::replace);
+    std::string out;
+    out.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '<' && i + 1 < text.size() && text[i + 1] == '/') {
+            out += "<\\/";
+            ++i;
+        } else {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+// Valor numérico de una celda; acepta números y cadenas numéricas (numeric de PostgreSQL)
+inline std::optional<double> as_number(const ojson& v) {
+    if (v.is_number()) return v.get<double>();
+    if (v.is_string()) {
+        const std::string& s = v.get_ref<const std::string&>();
+        if (s.empty()) return std::nullopt;
+        char* end = nullptr;
+        double d = std::strtod(s.c_str(), &end);
+        if (end == s.c_str() + s.size() && std::isfinite(d)) return d;
+    }
+    return std::nullopt;
+}
+
+// Fecha u hora ISO (YYYY-MM-DD...), como las que devuelve PostgreSQL
+inline bool looks_temporal(const ojson& v) {
+    if (!v.is_string()) return false;
+    const std::string& s = v.get_ref<const std::string&>();
+    auto digit = [&](std::size_t i) { return i < s.size() && s[i] >= '0' && s[i] <= '9'; };
+    return s.size() >= 7 && digit(0) && digit(1) && digit(2) && digit(3) && s[4] == '-' && digit(5) && digit(6);
+}
+
+inline std::string cell_text(const ojson& v) {
+    if (v.is_null()) return "";
+    if (v.is_string()) return v.get<std::string>();
+    if (v.is_number_float()) {
+        // Dos decimales como en el ejemplo de las instrucciones, sin ceros de más en enteros
+        double d = v.get<double>();
+        if (d == std::floor(d) && std::fabs(d) < 1e15) return std::to_string(static_cast<long long>(d));
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%.2f", d);
+        return buf;
+    }
+    return v.dump();
+}
+
+// Columnas de un resultado clasificadas por contenido
+struct Columns {
+    std::vector<std::string> all;
+    std::vector<std::string> numeric;
+    std::vector<std::string> temporal;
+    std::vector<std::string> categorical;  // ni numéricas ni temporales
+
+    const std::string* first_label() const {
+        if (!categorical.empty()) return &categorical.front();
+        if (!temporal.empty()) return &temporal.front();
+        return all.empty() ? nullptr : &all.front();
+    }
+};
+
+inline Columns classify(const ojson& rows) {
+    Columns cols;
+    for (const auto& row : rows) {
+        if (!row.is_object()) continue;
+        for (const auto& item : row.items()) {
+            if (std::find(cols.all.begin(), cols.all.end(), item.key()) == cols.all.end()) cols.all.push_back(item.key());
+        }
+    }
+    for (const auto& name : cols.all) {
+        bool any = false, numeric = true, temporal = true;
+        for (const auto& row : rows) {
+            if (!row.is_object()) continue;
+            auto it = row.find(name);
+            if (it == row.end() || it->is_null()) continue;
+            any = true;
+            if (!as_number(*it)) numeric = false;
+            if (!looks_temporal(*it)) temporal = false;
+        }
+        if (any && numeric) {
+            cols.numeric.push_back(name);
+        } else if (any && temporal) {
+            cols.temporal.push_back(name);
+        } else {
+            cols.categorical.push_back(name);
+        }
+    }
+    return cols;
+}
+
+inline ojson column_values(const ojson& rows, const std::string& name, bool numeric) {
+    ojson out = ojson::array();
+    for (const auto& row : rows) {
+        auto it = row.is_object() ? row.find(name) : row.end();
+        if (it == row.end() || it->is_null()) {
+            out.push_back(nullptr);
+        } else if (numeric) {
+            auto d = as_number(*it);
+            out.push_back(d ? ojson(*d) : ojson(nullptr));
+        } else {
+            out.push_back(cell_text(*it));
+        }
+    }
+    return out;
+}
+
+// "total_sales" -> "Total sales"
+inline std::string humanize(std::string_view name) {
+    std::string out(name);
+    std::replace(out.begin(), out.end(), '_', ' ');
+    if (!out.empty()) out[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(out[0])));
+    return out;
+}
+
+// Gráfico de Chart.js en un <canvas>
+inline std::string chart(std::size_t id, const ojson& config) {
+    const std::string canvas = "chart-" + std::to_string(id);
+    return "<div class=\"relative h-72\"><canvas id=\"" + canvas + "\"></canvas></div>\n<script>new Chart(document.getElementById('" +
+           canvas + "'), " + script_json(config) + ");</script>\n";
+}
+
+inline ojson dataset(const std::string& label, ojson data, std::size_t color, bool per_point_colors = false) {
+    ojson ds = {{"label", humanize(label)}, {"data", std::move(data)}};
+    if (per_point_colors) {
+        ojson colors = ojson::array();
+        for (std::size_t i = 0; i < ds["data"].size(); ++i) colors.push_back(kPalette[i % kPaletteSize]);
+        ds["backgroundColor"] = std::move(colors);
+    } else {
+        ds["backgroundColor"] = kPalette[color % kPaletteSize];
+        ds["borderColor"] = kPalette[color % kPaletteSize];
+    }
+    return ds;
+}
+
+inline std::string render_table(const ojson& rows, const Columns& cols) {
+    std::string html = "<div class=\"overflow-x-auto\"><table class=\"w-full text-left border-collapse text-sm\">\n<thead><tr class=\"bg-gray-200\">";
+    for (const auto& name : cols.all) html += "<th class=\"p-2\">" + escape_html(humanize(name)) + "</th>";
+    html += "</tr></thead>\n<tbody>\n";
+    for (const auto& row : rows) {
+        html += "<tr class=\"border-b\">";
+        for (const auto& name : cols.all) {
+            auto it = row.is_object() ? row.find(name) : row.end();
+            const bool numeric = std::find(cols.numeric.begin(), cols.numeric.end(), name) != cols.numeric.end();
+            html += numeric ? "<td class=\"p-2 text-right\">" : "<td class=\"p-2\">";
+            if (it != row.end()) html += escape_html(cell_text(*it));
+            html += "</td>";
+        }
+        html += "</tr>\n";
+    }
+    return html + "</tbody></table></div>\n";
+}
+
+// Categorías (o fechas) en el eje x y una serie por cada columna numérica
+inline std::string render_category_chart(std::size_t id, const ojson& rows, const Columns& cols, bool time_series) {
+    const std::string* label = nullptr;
+    if (time_series && !cols.temporal.empty()) label = &cols.temporal.front();
+    if (!label) label = cols.first_label();
+    if (!label || cols.numeric.empty()) return render_table(rows, cols);
+
+    ojson sorted = rows;
+    if (time_series) {
+        // Las fechas ISO se ordenan bien como texto
+        std::stable_sort(sorted.begin(), sorted.end(), [&](const ojson& a, const ojson& b) {
+            return cell_text(a.value(*label, ojson())) < cell_text(b.value(*label, ojson()));
+        });
+    }
+    ojson datasets = ojson::array();
+    std::size_t color = 0;
+    for (const auto& name : cols.numeric) {
+        if (name == *label) continue;
+        ojson ds = dataset(name, column_values(sorted, name, true), color++);
+        if (time_series) {
+            ds["fill"] = false;
+            ds["tension"] = 0.25;
+        }
+        datasets.push_back(std::move(ds));
+    }
+    if (datasets.empty()) return render_table(rows, cols);
+    ojson config = {
+        {"type", time_series ? "line" : "bar"},
+        {"data", {{"labels", column_values(sorted, *label, false)}, {"datasets", std::move(datasets)}}},
+        {"options", {{"responsive", true}, {"maintainAspectRatio", false},
+                     {"scales", {{"y", {{"beginAtZero", !time_series}}}}}}},
+    };
+    return chart(id, config);
+}
+
+inline std::string render_pie(std::size_t id, const ojson& rows, const Columns& cols) {
+    const std::string* label = cols.first_label();
+    if (!label || cols.numeric.empty() || cols.numeric.front() == *label) return render_table(rows, cols);
+    const std::string& value = cols.numeric.front();
+    ojson config = {
+        {"type", "pie"},
+        {"data", {{"labels", column_values(rows, *label, false)},
+                  {"datasets", ojson::array({dataset(value, column_values(rows, value, true), 0, true)})}}},
+        {"options", {{"responsive", true}, {"maintainAspectRatio", false}}},
+    };
+    return chart(id, config);
+}
+
+// Dos columnas numéricas como x e y; la primera categórica, si la hay, etiqueta cada punto
+inline std::string render_scatter(std::size_t id, const ojson& rows, const Columns& cols) {
+    if (cols.numeric.size() < 2) return render_table(rows, cols);
+    const std::string& x = cols.numeric[0];
+    const std::string& y = cols.numeric[1];
+    const std::string* label = cols.categorical.empty() ? nullptr : &cols.categorical.front();
+    ojson points = ojson::array();
+    for (const auto& row : rows) {
+        if (!row.is_object()) continue;
+        auto xv = as_number(row.value(x, ojson()));
+        auto yv = as_number(row.value(y, ojson()));
+        if (!xv || !yv) continue;
+        ojson point = {{"x", *xv}, {"y", *yv}};
+        if (label) point["label"] = cell_text(row.value(*label, ojson()));
+        points.push_back(std::move(point));
+    }
+    ojson ds = dataset(y, std::move(points), 1);
+    ojson config = {
+        {"type", "scatter"},
+        {"data", {{"datasets", ojson::array({std::move(ds)})}}},
+        {"options", {{"responsive", true}, {"maintainAspectRatio", false},
+                     {"scales", {{"x", {{"title", {{"display", true}, {"text", humanize(x)}}}}},
+                                 {"y", {{"title", {{"display", true}, {"text", humanize(y)}}}}}}}}},
+    };
+    return chart(id, config);
+}
+
+// Tabla dinámica coloreada por intensidad: filas y columnas de las dos primeras dimensiones
+// (categóricas o temporales) y el primer valor numérico en las celdas
+inline std::string render_heatmap(const ojson& rows, const Columns& cols) {
+    std::vector<std::string> dims = cols.categorical;
+    dims.insert(dims.end(), cols.temporal.begin(), cols.temporal.end());
+    std::vector<std::string> values = cols.numeric;
+    // Con una sola dimensión textual, una columna numérica pequeña (hora, día) hace de segunda
+    if (dims.size() < 2 && values.size() >= 2) {
+        dims.push_back(values.front());
+        values.erase(values.begin());
+    }
+    if (dims.empty() || values.empty()) return render_table(rows, cols);
+    const std::string& row_dim = dims[0];
+    const std::string* col_dim = dims.size() > 1 ? &dims[1] : nullptr;
+    const std::string& value = values.front();
+
+    std::vector<std::string> row_keys, col_keys;
+    std::map<std::pair<std::string, std::string>, double> cells;
+    for (const auto& row : rows) {
+        if (!row.is_object()) continue;
+        auto v = as_number(row.value(value, ojson()));
+        if (!v) continue;
+        std::string r = cell_text(row.value(row_dim, ojson()));
+        std::string c = col_dim ? cell_text(row.value(*col_dim, ojson())) : humanize(value);
+        if (std::find(row_keys.begin(), row_keys.end(), r) == row_keys.end()) row_keys.push_back(r);
+        if (std::find(col_keys.begin(), col_keys.end(), c) == col_keys.end()) col_keys.push_back(c);
+        cells[{r, c}] += *v;
+    }
+    if (row_keys.empty()) return render_table(rows, cols);
+    // Escala de color sobre las celdas ya sumadas, no sobre los valores de cada fila
+    double lo = cells.begin()->second, hi = lo;
+    for (const auto& cell : cells) {
+        lo = std::min(lo, cell.second);
+        hi = std::max(hi, cell.second);
+    }
+
+    std::string html = "<div class=\"overflow-x-auto\"><table class=\"text-sm border-collapse\">\n<thead><tr><th class=\"p-2\"></th>";
+    for (const auto& c : col_keys) html += "<th class=\"p-2\">" + escape_html(c) + "</th>";
+    html += "</tr></thead>\n<tbody>\n";
+    for (const auto& r : row_keys) {
+        html += "<tr><th class=\"p-2 text-left\">" + escape_html(r) + "</th>";
+        for (const auto& c : col_keys) {
+            auto it = cells.find({r, c});
+            if (it == cells.end()) {
+                html += "<td class=\"p-2\"></td>";
+                continue;
+            }
+            const double t = hi > lo ? (it->second - lo) / (hi - lo) : 1.0;
+            char style[96];
+            std::snprintf(style, sizeof(style), "background-color: rgba(33, 150, 243, %.2f);%s", 0.1 + 0.9 * t,
+                          t > 0.6 ? " color: white;" : "");
+            html += "<td class=\"p-2 text-right\" style=\"" + std::string(style) + "\">" +
+                    escape_html(cell_text(ojson(it->second))) + "</td>";
+        }
+        html += "</tr>\n";
+    }
+    return html + "</tbody></table></div>\n";
+}
+
+// KPI del primer registro; si hay una columna de objetivo se muestra el avance como medio anillo
+inline std::string render_gauge(std::size_t id, const ojson& rows, const Columns& cols) {
+    if (rows.empty() || !rows[0].is_object() || cols.numeric.empty()) return render_table(rows, cols);
+    const ojson& row = rows[0];
+    auto is_target = [](std::string name) {
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        for (const char* hint : {"target", "goal", "objetivo", "meta", "max", "limit", "quota", "cuota"}) {
+            if (name.find(hint) != std::string::npos) return true;
+        }
+        return false;
+    };
+    const std::string* value = nullptr;
+    const std::string* target = nullptr;
+    for (const auto& name : cols.numeric) {
+        if (is_target(name)) {
+            if (!target) target = &name;
+        } else if (!value) {
+            value = &name;
+        }
+    }
+    if (!value) value = &cols.numeric.front();
+    if (target == value) target = nullptr;
+    const double v = as_number(row.value(*value, ojson())).value_or(0.0);
+
+    std::string html = "<div class=\"text-center\"><div class=\"text-4xl font-bold\">" +
+                       escape_html(cell_text(ojson(v))) + "</div><div class=\"text-gray-500\">" +
+                       escape_html(humanize(*value)) + "</div>";
+    const double t = target ? as_number(row.value(*target, ojson())).value_or(0.0) : 0.0;
+    if (!target || t <= 0) return html + "</div>\n";
+
+    const double pct = std::clamp(v / t, 0.0, 1.0);
+    char caption[96];
+    std::snprintf(caption, sizeof(caption), "%.1f%% de %s", 100.0 * v / t, cell_text(ojson(t)).c_str());
+    ojson config = {
+        {"type", "doughnut"},
+        {"data", {{"labels", {humanize(*value), "Restante"}},
+                  {"datasets", ojson::array({{{"data", {pct, 1.0 - pct}}, {"backgroundColor", {kPalette[0], "#E0E0E0"}}}})}}},
+        {"options", {{"responsive", true}, {"maintainAspectRatio", false}, {"rotation", -90}, {"circumference", 180},
+                     {"cutout", "70%"}, {"plugins", {{"legend", {{"display", false}}}}}}},
+    };
+    return html + "<div class=\"text-gray-600\">" + escape_html(caption) + "</div></div>\n" + chart(id, config);
+}
+
+// Etapas en orden con barras horizontales y la conversión respecto de la primera
+inline std::string render_funnel(std::size_t id, const ojson& rows, const Columns& cols) {
+    const std::string* label = cols.first_label();
+    if (!label || cols.numeric.empty() || cols.numeric.front() == *label) return render_table(rows, cols);
+    const std::string& value = cols.numeric.front();
+    ojson labels = ojson::array();
+    ojson values = ojson::array();
+    double base = 0;
+    for (const auto& row : rows) {
+        if (!row.is_object()) continue;
+        const double v = as_number(row.value(value, ojson())).value_or(0.0);
+        if (labels.empty()) base = v;
+        std::string text = cell_text(row.value(*label, ojson()));
+        if (base > 0 && !labels.empty()) {
+            char pct[32];
+            std::snprintf(pct, sizeof(pct), " (%.1f%%)", 100.0 * v / base);
+            text += pct;
+        }
+        labels.push_back(std::move(text));
+        values.push_back(v);
+    }
+    ojson config = {
+        {"type", "bar"},
+        {"data", {{"labels", std::move(labels)}, {"datasets", ojson::array({dataset(value, std::move(values), 0, true)})}}},
+        {"options", {{"indexAxis", "y"}, {"responsive", true}, {"maintainAspectRatio", false},
+                     {"plugins", {{"legend", {{"display", false}}}}}}},
+    };
+    return chart(id, config);
+}
+
+inline std::string metric_text(const ojson& metric, std::initializer_list<const char*> keys) {
+    for (const char* key : keys) {
+        auto it = metric.find(key);
+        if (it != metric.end() && it->is_string() && !it->get_ref<const std::string&>().empty()) return it->get<std::string>();
+    }
+    return "";
+}
+
+}  // namespace dashboard
+
+// Documento HTML completo (Tailwind y Chart.js desde CDN, como pide INSTRUCTIONS_RENDER_DASHBOARD_FROM_DATA)
+// con una tarjeta por métrica de {"metrics": [...]}. Devuelve std::nullopt si no hay ninguna
+// métrica con filas objeto en "data"
+inline std::optional<std::string> render_dashboard(const nlohmann::ordered_json& doc,
+                                                   std::string_view title = "Metrics Dashboard") {
+    using namespace dashboard;
+    auto metrics = doc.is_object() ? doc.find("metrics") : doc.end();
+    if (metrics == doc.end() || !metrics->is_array()) return std::nullopt;
+
+    std::string cards;
+    std::size_t id = 0;
+    for (const auto& metric : *metrics) {
+        if (!metric.is_object()) continue;
+        auto data = metric.find("data");
+        if (data == metric.end() || !data->is_array()) continue;
+        // Cada renderizador espera filas objeto; las demás (arreglos o escalares que puede
+        // devolver el LLM) se omiten
+        ojson rows = ojson::array();
+        for (const auto& row : *data) {
+            if (row.is_object()) rows.push_back(row);
+        }
+        if (rows.empty()) continue;
+        const Columns cols = classify(rows);
+        const std::string type = metric_text(metric, {"visualization_type", "type"});
+
+        std::string body;
+        if (type == "bar_chart") body = render_category_chart(id, rows, cols, false);
+        else if (type == "time_series") body = render_category_chart(id, rows, cols, true);
+        else if (type == "pie_chart") body = render_pie(id, rows, cols);
+        else if (type == "scatter_plot") body = render_scatter(id, rows, cols);
+        else if (type == "heatmap") body = render_heatmap(rows, cols);
+        else if (type == "gauge") body = render_gauge(id, rows, cols);
+        else if (type == "funnel") body = render_funnel(id, rows, cols);
+        else body = render_table(rows, cols);
+        ++id;
+
+        const std::string name = metric_text(metric, {"metric", "name", "title"});
+        const std::string description = metric_text(metric, {"description"});
+        const bool wide = type == "table" || type == "heatmap" || cols.all.size() > 4;
+        cards += wide ? "<div class=\"bg-white p-4 rounded-lg shadow-md md:col-span-2\">\n"
+                      : "<div class=\"bg-white p-4 rounded-lg shadow-md\">\n";
+        cards += "<h2 class=\"text-xl font-semibold\">" + escape_html(name.empty() ? humanize(type) : name) + "</h2>\n";
+        if (!description.empty()) cards += "<p class=\"text-gray-600 mb-4\">" + escape_html(description) + "</p>\n";
+        cards += body + "</div>\n";
+    }
+    if (cards.empty()) return std::nullopt;
+
+    return "<!DOCTYPE html>\n<html lang=\"en\">\n<head>\n<meta charset=\"UTF-8\">\n"
+           "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n<title>" +
+           escape_html(title) +
+           "</title>\n<script src=\"https://cdn.tailwindcss.com\"></script>\n"
+           "<script src=\"https://cdn.jsdelivr.net/npm/chart.js@4.4.3/dist/chart.umd.js\"></script>\n</head>\n"
+           "<body class=\"bg-gray-100 p-4\">\n<h1 class=\"text-2xl font-bold text-center mb-6\">" +
+           escape_html(title) + "</h1>\n<div class=\"grid grid-cols-1 md:grid-cols-2 gap-4\">\n" + cards +
+           "</div>\n</body>\n</html>\n";
+}
+
+}  // namespace mcp
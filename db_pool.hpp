@@ -0,0 +1,237 @@
+#pragma once
+#include <pqxx/pqxx>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "env.hpp"
+
+namespace mcp {
+
+// Parámetros del pool de conexiones
+struct PoolConfig {
+    std::size_t min_size = 1;
+    std::size_t max_size = 8;
+    std::chrono::milliseconds acquire_timeout{5000};
+    std::chrono::milliseconds idle_timeout{300000};
+    std::chrono::milliseconds health_check_interval{30000};
+
+    // Leer la configuración desde las variables de entorno DB_POOL_*
+    static PoolConfig from_env() {
+        PoolConfig config;
+        config.min_size = static_cast<std::size_t>(std::max(0L, env_long("DB_POOL_MIN", 1)));
+        config.max_size = static_cast<std::size_t>(std::max(1L, env_long("DB_POOL_MAX", 8)));
+        if (config.min_size > config.max_size) config.min_size = config.max_size;
+        config.acquire_timeout = std::chrono::milliseconds(env_long("DB_POOL_ACQUIRE_TIMEOUT_MS", 5000));
+        config.idle_timeout = std::chrono::milliseconds(env_long("DB_POOL_IDLE_TIMEOUT_MS", 300000));
+        config.health_check_interval = std::chrono::milliseconds(env_long("DB_POOL_HEALTH_CHECK_MS", 30000));
+        return config;
+    }
+};
+
+class ConnectionPool;
+
+// Conexión prestada por el pool; se devuelve automáticamente al destruirse
+class PooledConnection {
+public:
+    PooledConnection(ConnectionPool* pool, std::unique_ptr<pqxx::connection> conn)
+        : pool_(pool), conn_(std::move(conn)) {}
+    PooledConnection(PooledConnection&& other) noexcept = default;
+    PooledConnection& operator=(PooledConnection&&) = delete;
+    PooledConnection(const PooledConnection&) = delete;
+    PooledConnection& operator=(const PooledConnection&) = delete;
+    ~PooledConnection();
+
+    pqxx::connection& operator*() { return *conn_; }
+    pqxx::connection* operator->() { return conn_.get(); }
+
+private:
+    ConnectionPool* pool_;
+    std::unique_ptr<pqxx::connection> conn_;
+};
+
+// Pool acotado y seguro entre hilos de conexiones a PostgreSQL
+class ConnectionPool {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct Stats {
+        std::size_t total = 0;
+        std::size_t idle = 0;
+        unsigned long long created = 0;
+        unsigned long long reused = 0;
+        unsigned long long discarded = 0;
+        unsigned long long timeouts = 0;
+    };
+
+    ConnectionPool(std::string conninfo, PoolConfig config)
+        : conninfo_(std::move(conninfo)), config_(config) {
+        // Precalentar hasta el tamaño mínimo
+        for (std::size_t i = 0; i < config_.min_size; ++i) {
+            auto conn = std::make_unique<pqxx::connection>(conninfo_);
+            idle_.push_back({std::move(conn), clock::now(), clock::now()});
+            ++total_;
+            ++stats_.created;
+        }
+        if (config_.idle_timeout.count() > 0) reaper_ = std::thread([this] { reap_loop(); });
+    }
+
+    ~ConnectionPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        reaper_wake_.notify_all();
+        if (reaper_.joinable()) reaper_.join();
+    }
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Obtener una conexión; espera hasta acquire_timeout si el pool está lleno
+    PooledConnection acquire() {
+        const auto deadline = clock::now() + config_.acquire_timeout;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            while (!idle_.empty()) {
+                // LIFO: se reutiliza la conexión más reciente y las antiguas quedan al frente, donde
+                // las cierra reap_idle_locked cuando superan idle_timeout
+                Idle entry = std::move(idle_.back());
+                idle_.pop_back();
+                lock.unlock();
+                if (is_healthy(entry)) {
+                    lock.lock();
+                    ++stats_.reused;
+                    return PooledConnection(this, std::move(entry.conn));
+                }
+                entry.conn.reset();
+                lock.lock();
+                --total_;
+                ++stats_.discarded;
+            }
+            if (total_ < config_.max_size) {
+                ++total_;
+                lock.unlock();
+                try {
+                    auto conn = std::make_unique<pqxx::connection>(conninfo_);
+                    lock.lock();
+                    ++stats_.created;
+                    return PooledConnection(this, std::move(conn));
+                } catch (...) {
+                    lock.lock();
+                    --total_;
+                    available_.notify_one();
+                    throw;
+                }
+            }
+            if (available_.wait_until(lock, deadline) == std::cv_status::timeout && idle_.empty() && total_ >= config_.max_size) {
+                ++stats_.timeouts;
+                throw std::runtime_error("Tiempo de espera agotado al obtener una conexión del pool");
+            }
+        }
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats s = stats_;
+        s.total = total_;
+        s.idle = idle_.size();
+        return s;
+    }
+
+private:
+    friend class PooledConnection;
+
+    struct Idle {
+        std::unique_ptr<pqxx::connection> conn;
+        clock::time_point last_used;
+        clock::time_point last_checked;
+    };
+
+    // Verificar la conexión si lleva más de health_check_interval sin comprobarse
+    bool is_healthy(Idle& entry) const {
+        if (!entry.conn || !entry.conn->is_open()) return false;
+        if (clock::now() - entry.last_checked < config_.health_check_interval) return true;
+        try {
+            pqxx::nontransaction txn(*entry.conn);
+            txn.exec("SELECT 1");
+            return true;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    // Devolver una conexión al pool; las conexiones rotas se descartan
+    void release(std::unique_ptr<pqxx::connection> conn) {
+        std::vector<std::unique_ptr<pqxx::connection>> doomed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto now = clock::now();
+            if (conn && conn->is_open()) {
+                idle_.push_back({std::move(conn), now, now});
+            } else {
+                doomed.push_back(std::move(conn));
+                --total_;
+                ++stats_.discarded;
+            }
+            reap_idle_locked(now, doomed);
+        }
+        available_.notify_one();
+        // Las conexiones descartadas se cierran fuera del candado
+    }
+
+    // Sacar del pool las conexiones ociosas que excedan idle_timeout por encima del mínimo; las
+    // más antiguas están al frente. Se llama con mutex_ tomado y se cierran fuera del candado
+    void reap_idle_locked(clock::time_point now, std::vector<std::unique_ptr<pqxx::connection>>& doomed) {
+        while (!idle_.empty() && total_ > config_.min_size && now - idle_.front().last_used > config_.idle_timeout) {
+            doomed.push_back(std::move(idle_.front().conn));
+            idle_.pop_front();
+            --total_;
+            ++stats_.discarded;
+        }
+    }
+
+    // Hilo que encoge el pool sin esperar a que se devuelva otra conexión: tras un pico de carga
+    // las conexiones sobrantes se cierran entre idle_timeout y 1.5 × idle_timeout después de su
+    // último uso
+    void reap_loop() {
+        const auto interval = std::max(std::chrono::milliseconds(1), config_.idle_timeout / 2);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            reaper_wake_.wait_for(lock, interval, [this] { return stopping_; });
+            if (stopping_) break;
+            std::vector<std::unique_ptr<pqxx::connection>> doomed;
+            reap_idle_locked(clock::now(), doomed);
+            if (doomed.empty()) continue;
+            lock.unlock();
+            doomed.clear();
+            lock.lock();
+        }
+    }
+
+    const std::string conninfo_;
+    const PoolConfig config_;
+    mutable std::mutex mutex_;
+    std::condition_variable available_;
+    std::deque<Idle> idle_;
+    std::size_t total_ = 0;
+    Stats stats_;
+    bool stopping_ = false;
+    std::condition_variable reaper_wake_;
+    std::thread reaper_;  // último miembro: arranca con el resto ya construido
+};
+
+inline PooledConnection::~PooledConnection() {
+    if (pool_ && conn_) pool_->release(std::move(conn_));
+}
+
+}  // namespace mcp
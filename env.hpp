@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdlib>
+#include <string>
+
+namespace mcp {
+
+// Leer una variable de entorno numérica con valor por defecto
+inline long env_long(const char* name, long fallback) {
+    const char* value = std::getenv(name);
+    if (!value || !*value) return fallback;
+    char* end = nullptr;
+    long parsed = std::strtol(value, &end, 10);
+    return (end && *end == '\0') ? parsed : fallback;
+}
+
+// Leer una variable de entorno de texto con valor por defecto
+inline std::string env_string(const char* name, const std::string& fallback = "") {
+    const char* value = std::getenv(name);
+    return (value && *value) ? std::string(value) : fallback;
+}
+
+}  // namespace mcp
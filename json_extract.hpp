@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace mcp {
+
+namespace detail {
+
+// Primer carácter estructural de JSON ({ } [ ] ") en [p, end), o end. Con SSE2 se comparan 16
+// bytes por iteración; el resto se recorre con una tabla
+inline const char* find_structural(const char* p, const char* end) {
+#if defined(__SSE2__)
+    const __m128i open_brace = _mm_set1_epi8('{');
+    const __m128i close_brace = _mm_set1_epi8('}');
+    const __m128i open_bracket = _mm_set1_epi8('[');
+    const __m128i close_bracket = _mm_set1_epi8(']');
+    const __m128i quote = _mm_set1_epi8('"');
+    while (end - p >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, open_brace), _mm_cmpeq_epi8(chunk, close_brace));
+        hits = _mm_or_si128(hits, _mm_or_si128(_mm_cmpeq_epi8(chunk, open_bracket), _mm_cmpeq_epi8(chunk, close_bracket)));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, quote));
+        const int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p) {
+        switch (*p) {
+            case '{': case '}': case '[': case ']': case '"': return p;
+            default: break;
+        }
+    }
+    return end;
+}
+
+// Comilla que cierra una cadena JSON que empieza en p (tras la comilla de apertura), o end
+inline const char* find_string_end(const char* p, const char* end) {
+    while (p < end) {
+        const char* q = static_cast<const char*>(std::memchr(p, '"', static_cast<std::size_t>(end - p)));
+        if (!q) return end;
+        // Escapada si la precede un número impar de barras invertidas
+        std::size_t slashes = 0;
+        for (const char* b = q; b > p && b[-1] == '\\'; --b) ++slashes;
+        if (slashes % 2 == 0) return q;
+        p = q + 1;
+    }
+    return end;
+}
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+}  // namespace detail
+
+// Contenido del primer bloque ```lang ... ``` sin los espacios de los extremos, equivalente a
+// std::regex("```lang\\s*([\\s\\S]*?)\\s*```") pero en una sola pasada con memchr
+inline std::optional<std::string_view> find_fenced_block(std::string_view text, std::string_view lang) {
+    const char* const begin = text.data();
+    const char* const end = begin + text.size();
+    const char* p = begin;
+    while (p < end) {
+        const char* tick = static_cast<const char*>(std::memchr(p, '`', static_cast<std::size_t>(end - p)));
+        if (!tick) return std::nullopt;
+        std::string_view rest(tick, static_cast<std::size_t>(end - tick));
+        if (rest.substr(0, 3) != "```" || rest.substr(3, lang.size()) != lang) {
+            p = tick + 1;
+            continue;
+        }
+        const char* body = tick + 3 + lang.size();
+        while (body < end && detail::is_space(*body)) ++body;
+        // Cierre: la siguiente secuencia ```
+        for (const char* q = body; q < end;) {
+            const char* close = static_cast<const char*>(std::memchr(q, '`', static_cast<std::size_t>(end - q)));
+            if (!close) return std::nullopt;
+            if (end - close >= 3 && close[1] == '`' && close[2] == '`') {
+                const char* last = close;
+                while (last > body && detail::is_space(last[-1])) --last;
+                return std::string_view(body, static_cast<std::size_t>(last - body));
+            }
+            q = close + 1;
+        }
+        return std::nullopt;
+    }
+    return std::nullopt;
+}
+
+// Primer objeto o arreglo JSON del texto, delimitado contando llaves y corchetes fuera de las
+// cadenas. Si el texto termina antes de cerrarlo se devuelve el fragmento hasta el final; si no
+// hay ninguno, std::nullopt
+inline std::optional<std::string_view> find_json_value(std::string_view text) {
+    const char* const end = text.data() + text.size();
+    const char* p = text.data();
+    const char* start = nullptr;
+    while (!start) {
+        // Antes del valor no se interpretan las comillas: pueden ser prosa
+        p = detail::find_structural(p, end);
+        if (p == end) return std::nullopt;
+        if (*p == '{' || *p == '[') start = p;
+        ++p;
+    }
+    std::size_t depth = 1;
+    while (p < end) {
+        p = detail::find_structural(p, end);
+        if (p == end) break;
+        switch (*p) {
+            case '"':
+                p = detail::find_string_end(p + 1, end);
+                break;
+            case '{':
+            case '[':
+                ++depth;
+                break;
+            default:
+                if (--depth == 0) return std::string_view(start, static_cast<std::size_t>(p + 1 - start));
+                break;
+        }
+        if (p < end) ++p;
+    }
+    return std::string_view(start, static_cast<std::size_t>(end - start));
+}
+
+// Texto JSON de una respuesta del LLM: el bloque ```json si lo hay, si no el primer objeto o
+// arreglo (o su fragmento si está cortado); "{}" si no hay ninguno
+inline std::string extract_json(std::string_view text) {
+    if (auto block = find_fenced_block(text, "json")) return std::string(*block);
+    if (auto value = find_json_value(text)) return std::string(*value);
+    return "{}";
+}
+
+}  // namespace mcp
@@ -0,0 +1,238 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <cctype>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mcp {
+
+namespace detail {
+
+inline bool is_ident_start(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '$' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+inline bool is_ident_char(char c) {
+    return is_ident_start(c) || std::isdigit(static_cast<unsigned char>(c)) || c == '-';
+}
+
+// Literal sin comillas en posición de valor: constantes de Python/JavaScript, prefijos cortados
+// al final de la entrada y, en último caso, el texto como cadena
+inline void append_bare_word(std::string& out, std::string_view word, bool at_end) {
+    if (word == "true" || word == "True") { out += "true"; return; }
+    if (word == "false" || word == "False") { out += "false"; return; }
+    if (word == "null" || word == "None" || word == "undefined" || word == "NaN" || word == "Infinity") {
+        out += "null";
+        return;
+    }
+    if (at_end) {
+        for (std::string_view literal : {"true", "false", "null"}) {
+            if (literal.substr(0, word.size()) == word) {
+                out.append(literal);
+                return;
+            }
+        }
+    }
+    out += '"';
+    out.append(word);
+    out += '"';
+}
+
+// Número copiado tal cual salvo lo que JSON no admite: '+' inicial, ".5" y finales cortados
+inline void append_number(std::string& out, std::string_view num) {
+    if (!num.empty() && num.front() == '+') num.remove_prefix(1);
+    while (!num.empty() && std::string_view(".eE+-").find(num.back()) != std::string_view::npos) num.remove_suffix(1);
+    if (num.empty()) {
+        out += '0';
+        return;
+    }
+    std::size_t start = out.size();
+    out.append(num);
+    std::size_t digits = start + (out[start] == '-' ? 1 : 0);
+    if (digits < out.size() && out[digits] == '.') out.insert(digits, 1, '0');
+}
+
+}  // namespace detail
+
+// Reparar la salida casi-JSON habitual de un LLM: comas finales o ausentes, claves sin comillas,
+// cadenas con comillas simples, comentarios // /* */ y #, True/False/None, y arreglos, objetos o
+// cadenas cortados al final. El texto tras el primer valor completo se ignora. Devuelve
+// std::nullopt si la entrada no empieza por '{' o '[' o si el resultado sigue sin ser JSON válido.
+inline std::optional<std::string> repair_json(std::string_view in) {
+    struct Frame {
+        bool object;
+        std::size_t count = 0;
+        bool have_key = false;
+        bool have_colon = false;
+    };
+    std::vector<Frame> stack;
+    std::string out;
+    out.reserve(in.size() + 16);
+    const std::size_t n = in.size();
+    std::size_t i = 0;
+    bool done = false;
+
+    auto skip_space = [&] {
+        while (i < n) {
+            const char c = in[i];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                ++i;
+            } else if (c == '#' || (c == '/' && i + 1 < n && in[i + 1] == '/')) {
+                while (i < n && in[i] != '\n') ++i;
+            } else if (c == '/' && i + 1 < n && in[i + 1] == '*') {
+                std::size_t end = in.find("*/", i + 2);
+                i = end == std::string_view::npos ? n : end + 2;
+            } else {
+                break;
+            }
+        }
+    };
+
+    // Separadores y ':' que faltan antes de un valor; false si no hay dónde colocarlo
+    auto before_value = [&]() -> bool {
+        if (stack.empty()) return true;
+        Frame& f = stack.back();
+        if (f.object) {
+            if (!f.have_key) return false;
+            if (!f.have_colon) out += ':';
+            return true;
+        }
+        if (f.count++ > 0) out += ',';
+        return true;
+    };
+    auto after_value = [&] {
+        if (stack.empty()) {
+            done = true;
+        } else if (stack.back().object) {
+            stack.back().have_key = false;
+            stack.back().have_colon = false;
+        }
+    };
+    // Clave u objeto con valor pendiente: completar con null
+    auto finish_pair = [&] {
+        Frame& f = stack.back();
+        if (f.object && f.have_key) {
+            if (!f.have_colon) out += ':';
+            out += "null";
+            f.have_key = f.have_colon = false;
+        }
+    };
+    auto close_top = [&] {
+        finish_pair();
+        out += stack.back().object ? '}' : ']';
+        stack.pop_back();
+        after_value();
+    };
+
+    auto read_string = [&] {
+        const char quote = in[i++];
+        out += '"';
+        while (i < n && in[i] != quote) {
+            const char c = in[i++];
+            if (c == '\\') {
+                if (i >= n) break;  // escape cortado
+                const char e = in[i++];
+                if (e == '\'') {
+                    out += '\'';
+                } else if (std::string_view("\"\\/bfnrtu").find(e) != std::string_view::npos) {
+                    out += '\\';
+                    out += e;
+                } else {
+                    out += "\\\\";
+                    out += e;
+                }
+            } else if (c == '"') {
+                out += "\\\"";
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                static constexpr char hex[] = "0123456789abcdef";
+                switch (c) {
+                    case '\n': out += "\\n"; break;
+                    case '\r': out += "\\r"; break;
+                    case '\t': out += "\\t"; break;
+                    default:
+                        out += "\\u00";
+                        out += hex[(c >> 4) & 0xF];
+                        out += hex[c & 0xF];
+                }
+            } else {
+                out += c;
+            }
+        }
+        if (i < n) ++i;  // comilla de cierre; si falta, la cadena estaba cortada
+        out += '"';
+    };
+
+    while (!done) {
+        skip_space();
+        if (i >= n) break;
+        const char c = in[i];
+        Frame* top = stack.empty() ? nullptr : &stack.back();
+
+        if (!top && c != '{' && c != '[') {
+            // La raíz debe ser un objeto o un arreglo; cualquier otra cosa es prosa
+            return std::nullopt;
+        }
+        if (c == '}' || c == ']') {
+            ++i;
+            close_top();
+        } else if (c == ',') {
+            // Las comas se regeneran; una coma tras una clave sin valor equivale a null
+            ++i;
+            if (top) finish_pair();
+        } else if (c == ':') {
+            ++i;
+            if (top && top->object && top->have_key && !top->have_colon) {
+                out += ':';
+                top->have_colon = true;
+            }
+        } else if (top && top->object && !top->have_key) {
+            // Posición de clave: cadena, identificador o número
+            if (top->count++ > 0) out += ',';
+            if (c == '"' || c == '\'') {
+                read_string();
+            } else if (detail::is_ident_char(c)) {
+                std::size_t start = i;
+                while (i < n && detail::is_ident_char(in[i])) ++i;
+                out += '"';
+                out.append(in.substr(start, i - start));
+                out += '"';
+            } else {
+                return std::nullopt;
+            }
+            top->have_key = true;
+        } else if (c == '{' || c == '[') {
+            ++i;
+            if (!before_value()) return std::nullopt;
+            out += c;
+            stack.push_back({c == '{'});
+        } else if (c == '"' || c == '\'') {
+            if (!before_value()) return std::nullopt;
+            read_string();
+            after_value();
+        } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+' || c == '.') {
+            std::size_t start = i;
+            while (i < n && std::string_view("+-0123456789.eE").find(in[i]) != std::string_view::npos) ++i;
+            if (!before_value()) return std::nullopt;
+            detail::append_number(out, in.substr(start, i - start));
+            after_value();
+        } else if (detail::is_ident_start(c)) {
+            std::size_t start = i;
+            while (i < n && detail::is_ident_char(in[i])) ++i;
+            if (!before_value()) return std::nullopt;
+            detail::append_bare_word(out, in.substr(start, i - start), i >= n);
+            after_value();
+        } else {
+            ++i;  // carácter que no puede empezar nada: ignorarlo
+        }
+    }
+    // Entrada cortada: cerrar lo que quedó abierto
+    while (!stack.empty()) close_top();
+
+    if (out.empty() || !nlohmann::json::accept(out)) return std::nullopt;
+    return out;
+}
+
+}  // namespace mcp
@@ -0,0 +1,125 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace mcp {
+
+// Añadir `s` a `out` escapado como contenido de una cadena JSON (sin comillas)
+inline void append_escaped(std::string& out, std::string_view s) {
+    static constexpr char hex[] = "0123456789abcdef";
+    std::size_t run = 0;
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out.append(s.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xF];
+                break;
+        }
+    }
+    out.append(s.data() + run, s.size() - run);
+}
+
+// Escritor JSON en flujo: escribe directamente en un búfer de salida sin construir un DOM.
+// El llamador es responsable de emitir una secuencia válida (clave antes de cada valor en objetos).
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    std::string& buffer() { return out_; }
+
+    void begin_object() { separator(); out_ += '{'; need_comma_ = false; }
+    void end_object() { out_ += '}'; need_comma_ = true; }
+    void begin_array() { separator(); out_ += '['; need_comma_ = false; }
+    void end_array() { out_ += ']'; need_comma_ = true; }
+
+    void key(std::string_view k) {
+        separator();
+        out_ += '"';
+        append_escaped(out_, k);
+        out_ += "\":";
+        need_comma_ = false;
+    }
+
+    // Clave ya escapada con comillas y dos puntos (p.ej. precalculada por columna)
+    void raw_key(std::string_view quoted_key) {
+        separator();
+        out_.append(quoted_key);
+        need_comma_ = false;
+    }
+
+    void string(std::string_view v) {
+        separator();
+        out_ += '"';
+        append_escaped(out_, v);
+        out_ += '"';
+        need_comma_ = true;
+    }
+
+    // Valor que ya es JSON válido (número textual, documento json/jsonb, etc.)
+    void raw(std::string_view v) {
+        separator();
+        out_.append(v);
+        need_comma_ = true;
+    }
+
+    void number(long long v) {
+        separator();
+        char buf[24];
+        auto res = std::to_chars(buf, buf + sizeof(buf), v);
+        out_.append(buf, res.ptr);
+        need_comma_ = true;
+    }
+
+    void number(double v) {
+        separator();
+        if (!std::isfinite(v)) {
+            // Igual que nlohmann::json: NaN e infinito se serializan como null
+            out_ += "null";
+        } else {
+            char buf[32];
+            auto res = std::to_chars(buf, buf + sizeof(buf), v);
+            std::string_view text(buf, static_cast<std::size_t>(res.ptr - buf));
+            out_.append(text);
+            if (text.find_first_of(".e") == std::string_view::npos) out_ += ".0";
+        }
+        need_comma_ = true;
+    }
+
+    void boolean(bool v) { separator(); out_ += v ? "true" : "false"; need_comma_ = true; }
+    void null() { separator(); out_ += "null"; need_comma_ = true; }
+
+private:
+    void separator() {
+        if (need_comma_) out_ += ',';
+    }
+
+    std::string& out_;
+    bool need_comma_ = false;
+};
+
+// Clave JSON escapada con comillas y dos puntos, lista para JsonWriter::raw_key
+inline std::string quoted_key(std::string_view k) {
+    std::string out;
+    out.reserve(k.size() + 3);
+    out += '"';
+    append_escaped(out, k);
+    out += "\":";
+    return out;
+}
+
+}  // namespace mcp
@@ -0,0 +1,389 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "query_cache.hpp"
+
+namespace mcp {
+
+// FNV-1a de 128 bits, incremental; identifica el contenido de una petición al LLM
+class ContentHash {
+public:
+    ContentHash& update(std::string_view data) {
+        for (unsigned char c : data) {
+            hash_ ^= c;
+            hash_ *= kPrime;
+        }
+        return *this;
+    }
+
+    // 32 dígitos hexadecimales
+    std::string hex() const {
+        static constexpr char digits[] = "0123456789abcdef";
+        std::string out(32, '0');
+        unsigned __int128 h = hash_;
+        for (int i = 31; i >= 0; --i, h >>= 4) out[static_cast<std::size_t>(i)] = digits[static_cast<unsigned>(h & 0xF)];
+        return out;
+    }
+
+private:
+    static constexpr unsigned __int128 kPrime = (static_cast<unsigned __int128>(1) << 88) + 0x13B;
+    unsigned __int128 hash_ = (static_cast<unsigned __int128>(0x6c62272e07bb0142ULL) << 64) | 0x62b821756295c58dULL;
+};
+
+// Almacén persistente de respuestas: un archivo de registros que solo crece, leído con mmap y
+// compartido entre procesos con flock(2). Cada registro se añade con un único write() en modo
+// O_APPEND bajo el bloqueo exclusivo; los registros de otros procesos se descubren al fallar una
+// búsqueda, con el bloqueo compartido. Al superar max_bytes el archivo se reescribe solo con las
+// entradas vigentes y se reemplaza con rename(); los demás procesos lo notan al bloquear, porque
+// el inodo abierto ya no es el de la ruta.
+class LlmDiskStore {
+public:
+    struct Stats {
+        unsigned long long hits = 0;
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+    };
+
+    LlmDiskStore(std::string path, std::size_t max_bytes) : path_(std::move(path)), max_bytes_(max_bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (int error = reopen_locked()) {
+            throw std::runtime_error("No se pudo abrir la caché del LLM " + path_ + ": " + std::strerror(error));
+        }
+        // Con el bloqueo exclusivo: cabecera de un archivo nuevo y cola de un proceso que murió
+        // a mitad de write
+        if (FileLock file = lock_file_locked(LOCK_EX)) refresh_locked(true);
+    }
+
+    ~LlmDiskStore() {
+        unmap_locked();
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    LlmDiskStore(const LlmDiskStore&) = delete;
+    LlmDiskStore& operator=(const LlmDiskStore&) = delete;
+
+    // Valor vigente y tiempo que le queda, o std::nullopt
+    std::optional<std::pair<std::string, std::chrono::milliseconds>> get(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end() || it->second.expires_at_ms <= now_ms()) {
+            // Puede haber un registro más reciente de otro proceso
+            if (FileLock file = lock_file_locked(LOCK_SH)) refresh_locked(false);
+            it = index_.find(key);
+            if (it == index_.end()) return std::nullopt;
+        }
+        const long long remaining = it->second.expires_at_ms - now_ms();
+        if (remaining <= 0 || it->second.offset + it->second.size > mapped_size_) return std::nullopt;
+        ++hits_;
+        return std::make_pair(std::string(mapped_ + it->second.offset, it->second.size),
+                              std::chrono::milliseconds(remaining));
+    }
+
+    void put(const std::string& key, std::string_view value, std::chrono::milliseconds ttl) {
+        // Un valor que no cabe en la mitad del límite obligaría a compactar en cada escritura
+        if (key.size() != kKeySize || ttl.count() <= 0 || kFileHeader + kRecordHeader + value.size() > max_bytes_ / 2) return;
+        std::string record(kRecordHeader, '\0');
+        write_u32(&record[0], kRecordMagic);
+        write_u32(&record[4], static_cast<std::uint32_t>(value.size()));
+        write_i64(&record[8], now_ms() + ttl.count());
+        std::memcpy(&record[16], key.data(), kKeySize);
+        write_u32(&record[16 + kKeySize], checksum(value));
+        record.append(value);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        FileLock file = lock_file_locked(LOCK_EX);
+        if (!file) return;
+        refresh_locked(true);
+        if (scanned_ == 0) return;  // no se pudo escribir la cabecera
+        if (!write_all(fd_, record.data(), record.size())) {
+            // Disco lleno: quitar lo que se llegó a escribir y seguir sin caché
+            if (::ftruncate(fd_, static_cast<off_t>(scanned_)) == 0) remap_locked();
+            return;
+        }
+        refresh_locked(true);
+        if (scanned_ > max_bytes_) compact_locked();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (FileLock file = lock_file_locked(LOCK_EX)) replace_locked(std::string(kFileMagic, kFileHeader));
+    }
+
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (FileLock file = lock_file_locked(LOCK_SH)) refresh_locked(false);
+        return {hits_, index_.size(), live_bytes_};
+    }
+
+private:
+    static constexpr char kFileMagic[] = "MCPLLMC1";
+    static constexpr std::size_t kFileHeader = 8;
+    static constexpr std::uint32_t kRecordMagic = 0x52504c4d;  // "MLPR"
+    static constexpr std::size_t kKeySize = 32;
+    static constexpr std::size_t kRecordHeader = 16 + kKeySize + 4;  // magic, tamaño, caducidad, clave, suma
+
+    struct Location {
+        std::size_t offset;
+        std::size_t size;
+        long long expires_at_ms;
+    };
+
+    // flock(2) sobre el descriptor abierto; se suelta al destruirse. Cerrar el descriptor
+    // (replace_locked) también lo suelta
+    class FileLock {
+    public:
+        FileLock() = default;
+        explicit FileLock(int fd) : fd_(fd) {}
+        FileLock(FileLock&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+        FileLock& operator=(FileLock&&) = delete;
+        ~FileLock() {
+            if (fd_ >= 0) ::flock(fd_, LOCK_UN);
+        }
+        explicit operator bool() const { return fd_ >= 0; }
+
+    private:
+        int fd_ = -1;
+    };
+
+    static long long now_ms() {
+        // Reloj de pared: las caducidades deben sobrevivir a un reinicio
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    static void write_u32(char* p, std::uint32_t v) { std::memcpy(p, &v, sizeof(v)); }
+    static void write_i64(char* p, long long v) { std::memcpy(p, &v, sizeof(v)); }
+    static std::uint32_t read_u32(const char* p) { std::uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+    static long long read_i64(const char* p) { long long v; std::memcpy(&v, p, sizeof(v)); return v; }
+
+    static std::uint32_t checksum(std::string_view data) {
+        std::uint32_t h = 2166136261u;
+        for (unsigned char c : data) {
+            h ^= c;
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    static bool write_all(int fd, const char* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t n = ::write(fd, data, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    // Abrir (o crear) el archivo de path_ con el índice vacío; devuelve 0 o el errno del fallo
+    int reopen_locked() {
+        unmap_locked();
+        if (fd_ >= 0) ::close(fd_);
+        index_.clear();
+        live_bytes_ = 0;
+        scanned_ = 0;
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+        return fd_ < 0 ? errno : 0;
+    }
+
+    // Bloquear el archivo que está ahora en path_. Si otro proceso lo reemplazó desde que se
+    // abrió, se abre el nuevo (con el índice vacío) y se vuelve a bloquear
+    FileLock lock_file_locked(int operation) {
+        for (int attempt = 0; attempt < 8; ++attempt) {
+            if (fd_ < 0 && reopen_locked() != 0) return {};
+            if (::flock(fd_, operation) != 0) {
+                if (errno == EINTR) continue;
+                return {};
+            }
+            struct stat opened {};
+            struct stat on_disk {};
+            if (::fstat(fd_, &opened) == 0 && ::stat(path_.c_str(), &on_disk) == 0 &&
+                opened.st_dev == on_disk.st_dev && opened.st_ino == on_disk.st_ino) {
+                return FileLock(fd_);
+            }
+            ::flock(fd_, LOCK_UN);
+            if (reopen_locked() != 0) return {};
+        }
+        return {};
+    }
+
+    void unmap_locked() {
+        if (mapped_) ::munmap(const_cast<char*>(mapped_), mapped_size_);
+        mapped_ = nullptr;
+        mapped_size_ = 0;
+    }
+
+    void remap_locked() {
+        unmap_locked();
+        struct stat st {};
+        if (fd_ < 0 || ::fstat(fd_, &st) != 0 || st.st_size == 0) return;
+        void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) return;
+        mapped_ = static_cast<const char*>(p);
+        mapped_size_ = static_cast<std::size_t>(st.st_size);
+    }
+
+    // Incorporar al índice los registros añadidos desde el último escaneo, propios o de otros
+    // procesos; requiere el bloqueo del archivo. Con el exclusivo no hay escrituras en curso, así
+    // que una cola que no forma un registro solo puede venir de un proceso que murió a mitad de
+    // write: se recorta para que los registros siguientes no queden ocultos tras ella. También se
+    // empieza de cero un archivo sin cabecera o de otra versión
+    void refresh_locked(bool exclusive) {
+        remap_locked();
+        if (scanned_ == 0) {
+            if (mapped_size_ < kFileHeader || std::memcmp(mapped_, kFileMagic, kFileHeader) != 0) {
+                if (!exclusive || ::ftruncate(fd_, 0) != 0 || !write_all(fd_, kFileMagic, kFileHeader)) return;
+                remap_locked();
+            }
+            scanned_ = kFileHeader;
+        }
+        while (scanned_ + kRecordHeader <= mapped_size_) {
+            const char* p = mapped_ + scanned_;
+            if (read_u32(p) != kRecordMagic) break;
+            const std::size_t size = read_u32(p + 4);
+            if (scanned_ + kRecordHeader + size > mapped_size_) break;  // registro incompleto
+            std::string_view value(p + kRecordHeader, size);
+            if (read_u32(p + 16 + kKeySize) != checksum(value)) break;
+            std::string key(p + 16, kKeySize);
+            auto it = index_.find(key);
+            if (it != index_.end()) live_bytes_ -= it->second.size;
+            index_[std::move(key)] = {scanned_ + kRecordHeader, size, read_i64(p + 8)};
+            live_bytes_ += size;
+            scanned_ += kRecordHeader + size;
+        }
+        if (exclusive && mapped_size_ > scanned_ && ::ftruncate(fd_, static_cast<off_t>(scanned_)) == 0) remap_locked();
+    }
+
+    // Reescribir el archivo con las entradas vigentes más recientes, hasta la mitad de max_bytes
+    // para no compactar en cada escritura. Requiere el bloqueo exclusivo y el índice al día
+    void compact_locked() {
+        const long long now = now_ms();
+        std::vector<std::pair<const std::string*, Location>> live;
+        for (const auto& [key, loc] : index_) {
+            if (loc.expires_at_ms > now && loc.offset + loc.size <= mapped_size_) live.emplace_back(&key, loc);
+        }
+        // Elegir las más recientes y escribirlas en su orden original, para que la siguiente
+        // compactación siga reconociéndolas como las más nuevas
+        std::sort(live.begin(), live.end(), [](const auto& a, const auto& b) { return a.second.offset > b.second.offset; });
+        std::size_t keep = 0;
+        std::size_t total = kFileHeader;
+        while (keep < live.size() && total + kRecordHeader + live[keep].second.size <= max_bytes_ / 2) {
+            total += kRecordHeader + live[keep].second.size;
+            ++keep;
+        }
+        live.resize(keep);
+        std::reverse(live.begin(), live.end());
+        std::string data(kFileMagic, kFileHeader);
+        data.reserve(total);
+        for (const auto& [key_ptr, loc] : live) {
+            const std::string& key = *key_ptr;
+            std::string_view value(mapped_ + loc.offset, loc.size);
+            std::size_t start = data.size();
+            data.resize(start + kRecordHeader);
+            write_u32(&data[start], kRecordMagic);
+            write_u32(&data[start + 4], static_cast<std::uint32_t>(loc.size));
+            write_i64(&data[start + 8], loc.expires_at_ms);
+            std::memcpy(&data[start + 16], key.data(), kKeySize);
+            write_u32(&data[start + 16 + kKeySize], checksum(value));
+            data.append(value);
+        }
+        replace_locked(data);
+    }
+
+    // Poner data en path_ de forma atómica (archivo temporal y rename) y abrir el archivo nuevo.
+    // Requiere el bloqueo exclusivo; si algo falla, el archivo y el índice quedan como estaban
+    bool replace_locked(const std::string& data) {
+        const std::string tmp = path_ + ".tmp." + std::to_string(::getpid());
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0) return false;
+        const bool ok = write_all(fd, data.data(), data.size());
+        ::close(fd);
+        if (!ok || ::rename(tmp.c_str(), path_.c_str()) != 0) {
+            ::unlink(tmp.c_str());
+            return false;
+        }
+        return reopen_locked() == 0;
+    }
+
+    const std::string path_;
+    const std::size_t max_bytes_;
+    mutable std::mutex mutex_;
+    int fd_ = -1;
+    const char* mapped_ = nullptr;
+    std::size_t mapped_size_ = 0;
+    std::size_t scanned_ = 0;  // fin de los registros válidos indexados; 0 si falta leer la cabecera
+    std::unordered_map<std::string, Location> index_;
+    std::size_t live_bytes_ = 0;
+    unsigned long long hits_ = 0;
+};
+
+// Caché de respuestas del LLM por contenido exacto de la petición: LRU en memoria (QueryCache)
+// y, opcionalmente, un LlmDiskStore que sobrevive a reinicios
+class LlmCache {
+public:
+    struct Stats {
+        QueryCache::Stats memory;
+        LlmDiskStore::Stats disk;
+    };
+
+    LlmCache(std::size_t max_bytes, std::chrono::milliseconds ttl, const std::string& path, std::size_t file_max_bytes)
+        : memory_(max_bytes, ttl) {
+        if (!path.empty() && ttl.count() > 0) disk_ = std::make_unique<LlmDiskStore>(path, file_max_bytes);
+    }
+
+    bool enabled() const { return memory_.default_ttl().count() > 0; }
+
+    std::shared_ptr<const std::string> get(const std::string& key) {
+        if (auto hit = memory_.get(key)) return hit;
+        if (!disk_) return nullptr;
+        auto stored = disk_->get(key);
+        if (!stored) return nullptr;
+        auto value = std::make_shared<const std::string>(stored->first);
+        memory_.put(key, std::move(stored->first), stored->second);
+        return value;
+    }
+
+    void put(const std::string& key, const std::string& value) {
+        memory_.put(key, value, memory_.default_ttl());
+        if (disk_) disk_->put(key, value, memory_.default_ttl());
+    }
+
+    void clear() {
+        memory_.clear();
+        if (disk_) disk_->clear();
+    }
+
+    Stats stats() {
+        return {memory_.stats(), disk_ ? disk_->stats() : LlmDiskStore::Stats{}};
+    }
+
+private:
+    QueryCache memory_;
+    std::unique_ptr<LlmDiskStore> disk_;
+};
+
+}  // namespace mcp
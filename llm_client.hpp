@@ -0,0 +1,341 @@
+#pragma once
+#include <httplib/httplib.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "env.hpp"
+
+namespace mcp {
+
+// Configuración del endpoint de chat completions (OpenAI o Azure OpenAI)
+struct LlmConfig {
+    std::string host;  // esquema://host[:puerto]
+    std::string path;  // ruta de /chat/completions, incluida la query string
+    std::string api_key;
+    std::string model;
+    bool azure = false;
+    long timeout_s = 120;
+    bool stream = true;  // pedir la respuesta como eventos SSE (`stream: true`)
+
+    // Con AZURE_OPENAI_ENDPOINT se usan las mismas variables que api.py; si no, OPENAI_BASE_URL
+    // (por defecto https://api.openai.com/v1), OPENAI_API_KEY y OPENAI_MODEL. Una URL http://
+    // local permite probar contra un servidor simulado.
+    static LlmConfig from_env() {
+        LlmConfig config;
+        std::string base;
+        const std::string azure_endpoint = env_string("AZURE_OPENAI_ENDPOINT");
+        if (!azure_endpoint.empty()) {
+            config.azure = true;
+            base = azure_endpoint;
+            config.api_key = env_string("AZURE_OPENAI_API_KEY");
+            config.model = env_string("AZURE_OPENAI_DEPLOYMENT", "gpt-4");
+        } else {
+            base = env_string("OPENAI_BASE_URL", "https://api.openai.com/v1");
+            config.api_key = env_string("OPENAI_API_KEY");
+            config.model = env_string("OPENAI_MODEL", "gpt-4o");
+        }
+        config.timeout_s = env_long("LLM_TIMEOUT_S", 120);
+        config.stream = env_long("LLM_STREAM", 1) != 0;
+
+        // Separar esquema://host[:puerto] del prefijo de ruta
+        std::size_t scheme = base.find("://");
+        std::size_t slash = base.find('/', scheme == std::string::npos ? 0 : scheme + 3);
+        config.host = base.substr(0, slash);
+        std::string prefix = slash == std::string::npos ? "" : base.substr(slash);
+        while (!prefix.empty() && prefix.back() == '/') prefix.pop_back();
+        if (config.azure) {
+            config.path = prefix + "/openai/deployments/" + config.model + "/chat/completions?api-version=" +
+                          env_string("AZURE_OPENAI_API_VERSION", "2024-02-15-preview");
+        } else {
+            config.path = prefix + "/chat/completions";
+        }
+        return config;
+    }
+};
+
+// Aviso de una llamada a herramienta cuyos argumentos ya están completos, antes de que termine
+// la respuesta del LLM. Recibe {"id", "type", "function": {"name", "arguments"}}
+using ToolCallFn = std::function<void(const nlohmann::json&)>;
+
+// Reconstruye una respuesta de chat completions a partir de los eventos SSE de `stream: true`.
+// Cada llamada a herramienta se anuncia en cuanto sus argumentos forman un JSON completo (o al
+// empezar la siguiente), para poder ejecutarla mientras el modelo sigue generando.
+class StreamAccumulator {
+public:
+    using json = nlohmann::json;
+
+    explicit StreamAccumulator(ToolCallFn on_tool_call) : on_tool_call_(std::move(on_tool_call)) {}
+
+    // Procesar bytes recibidos; las líneas pueden llegar partidas entre llamadas
+    void feed(const char* data, std::size_t size) {
+        buffer_.append(data, size);
+        std::size_t start = 0;
+        for (;;) {
+            std::size_t end = buffer_.find('\n', start);
+            if (end == std::string::npos) break;
+            std::string_view line(buffer_.data() + start, end - start);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            handle_line(line);
+            start = end + 1;
+        }
+        buffer_.erase(0, start);
+    }
+
+    const std::string& error() const { return error_; }
+
+    // Respuesta con el mismo formato que la llamada sin streaming
+    std::string response() {
+        finish();
+        json message = {{"role", "assistant"}, {"content", has_content_ ? json(content_) : json(nullptr)}};
+        if (!calls_.empty()) {
+            message["tool_calls"] = json::array();
+            for (const auto& call : calls_) message["tool_calls"].push_back(to_json(call));
+        }
+        json choice = {{"index", 0}, {"message", std::move(message)}};
+        choice["finish_reason"] = finish_reason_.empty() ? json(nullptr) : json(finish_reason_);
+        return json{{"choices", json::array({std::move(choice)})}}.dump();
+    }
+
+private:
+    struct PartialCall {
+        std::string id;
+        std::string name;
+        std::string arguments;
+        bool announced = false;
+    };
+
+    static json to_json(const PartialCall& call) {
+        return {{"id", call.id}, {"type", "function"}, {"function", {{"name", call.name}, {"arguments", call.arguments}}}};
+    }
+
+    void announce(PartialCall& call) {
+        if (call.announced || call.name.empty()) return;
+        call.announced = true;
+        if (on_tool_call_) on_tool_call_(to_json(call));
+    }
+
+    void finish() {
+        for (auto& call : calls_) announce(call);
+    }
+
+    void handle_line(std::string_view line) {
+        if (line.substr(0, 5) != "data:") return;  // líneas vacías, comentarios, event:, id:
+        line.remove_prefix(5);
+        if (!line.empty() && line.front() == ' ') line.remove_prefix(1);
+        if (line == "[DONE]") {
+            finish();
+            return;
+        }
+        json chunk = json::parse(line, nullptr, false);
+        if (chunk.is_discarded() || !chunk.is_object()) return;
+        if (chunk.contains("error")) {
+            const json& err = chunk["error"];
+            error_ = err.is_object() && err.contains("message") && err["message"].is_string()
+                         ? err["message"].get<std::string>()
+                         : err.dump();
+            return;
+        }
+        // Azure envía primero un evento sin choices con los resultados del filtro de contenido
+        auto choices = chunk.find("choices");
+        if (choices == chunk.end() || !choices->is_array() || choices->empty()) return;
+        const json& choice = (*choices)[0];
+        auto delta = choice.find("delta");
+        if (delta != choice.end() && delta->is_object()) {
+            auto content = delta->find("content");
+            if (content != delta->end() && content->is_string()) {
+                content_ += content->get<std::string>();
+                has_content_ = true;
+            }
+            auto tool_calls = delta->find("tool_calls");
+            if (tool_calls != delta->end() && tool_calls->is_array()) {
+                for (const auto& tc : *tool_calls) apply_tool_delta(tc);
+            }
+        }
+        auto finish_reason = choice.find("finish_reason");
+        if (finish_reason != choice.end() && finish_reason->is_string()) {
+            finish_reason_ = finish_reason->get<std::string>();
+            finish();
+        }
+    }
+
+    void apply_tool_delta(const json& tc) {
+        if (!tc.is_object()) return;
+        auto idx = tc.find("index");
+        const std::size_t index = idx != tc.end() && idx->is_number_unsigned() ? idx->get<std::size_t>() : 0;
+        if (index >= calls_.size()) {
+            // Empieza una llamada nueva: las anteriores ya están completas
+            finish();
+            calls_.resize(index + 1);
+        }
+        PartialCall& call = calls_[index];
+        auto id = tc.find("id");
+        if (id != tc.end() && id->is_string()) call.id = id->get<std::string>();
+        auto fn = tc.find("function");
+        if (fn == tc.end() || !fn->is_object()) return;
+        auto name = fn->find("name");
+        if (name != fn->end() && name->is_string()) call.name += name->get<std::string>();
+        auto arguments = fn->find("arguments");
+        if (arguments != fn->end() && arguments->is_string()) {
+            const std::string& piece = arguments->get_ref<const std::string&>();
+            call.arguments += piece;
+            // Un objeto solo puede quedar completo con una llave de cierre
+            if (piece.find('}') != std::string::npos && json::accept(call.arguments)) announce(call);
+        }
+    }
+
+    ToolCallFn on_tool_call_;
+    std::string buffer_;
+    std::string content_;
+    bool has_content_ = false;
+    std::string finish_reason_;
+    std::vector<PartialCall> calls_;
+    std::string error_;
+};
+
+// Cliente nativo de chat completions sobre httplib. Mantiene un conjunto de clientes HTTP con
+// keep-alive para reutilizar las conexiones entre llamadas y entre hilos.
+class LlmClient {
+public:
+    using json = nlohmann::json;
+
+    explicit LlmClient(LlmConfig config) : config_(std::move(config)) {
+        if (config_.api_key.empty()) {
+            throw std::runtime_error("Faltan variables de entorno del LLM (AZURE_OPENAI_API_KEY u OPENAI_API_KEY)");
+        }
+    }
+
+    const LlmConfig& config() const { return config_; }
+
+    // Cuerpo de la petición; los mensajes del asistente se limpian de campos que la API no acepta
+    std::string request_body(const json& messages, const json& tools, bool stream = false) const {
+        json body = {{"messages", json::array()}};
+        if (!config_.azure) body["model"] = config_.model;
+        for (const auto& msg : messages) {
+            json clean = json::object();
+            for (const char* key : {"role", "content", "name", "tool_call_id", "tool_calls"}) {
+                auto it = msg.find(key);
+                if (it == msg.end()) continue;
+                if (std::string(key) == "tool_calls" && (!it->is_array() || it->empty())) continue;
+                clean[key] = *it;
+            }
+            if (!clean.contains("content")) clean["content"] = nullptr;
+            body["messages"].push_back(std::move(clean));
+        }
+        if (!tools.empty()) {
+            body["tools"] = tools;
+            body["tool_choice"] = "auto";
+        }
+        if (stream) body["stream"] = true;
+        return body.dump();
+    }
+
+    // Enviar la conversación y devolver el cuerpo JSON de la respuesta. Los errores se devuelven
+    // como {"error": {"message": ...}}, igual que el callback de api.py
+    std::string chat(const json& messages, const json& tools) {
+        const std::string body = request_body(messages, tools);
+        Lease client(*this);
+        auto res = client->Post(config_.path, body, "application/json");
+        if (!res) {
+            client.discard();
+            return error_json("Error de conexión con el LLM: " + httplib::to_string(res.error()));
+        }
+        if (res->status != 200) {
+            return error_json("El LLM respondió con estado " + std::to_string(res->status) + ": " + res->body);
+        }
+        return std::move(res->body);
+    }
+
+    // Igual que chat(), pero con `stream: true`: la respuesta se reconstruye a partir de los
+    // eventos SSE y on_tool_call se invoca en cuanto cada llamada a herramienta está completa
+    std::string chat_stream(const json& messages, const json& tools, const ToolCallFn& on_tool_call) {
+        const std::string body = request_body(messages, tools, true);
+        StreamAccumulator stream(on_tool_call);
+        std::string raw;  // inicio del cuerpo sin procesar, para informar errores que no llegan como SSE
+        Lease client(*this);
+        auto res = client->Post(config_.path, httplib::Headers{{"Accept", "text/event-stream"}}, body,
+                                "application/json", [&](const char* data, std::size_t size) {
+                                    if (raw.size() < 4096) raw.append(data, std::min<std::size_t>(size, 4096));
+                                    stream.feed(data, size);
+                                    return true;
+                                });
+        if (!res) {
+            client.discard();
+            return error_json("Error de conexión con el LLM: " + httplib::to_string(res.error()));
+        }
+        if (res->status != 200) {
+            return error_json("El LLM respondió con estado " + std::to_string(res->status) + ": " + raw);
+        }
+        if (!stream.error().empty()) {
+            return error_json(stream.error());
+        }
+        return stream.response();
+    }
+
+protected:
+    static std::string error_json(const std::string& message) {
+        return json{{"error", {{"message", message}}}}.dump();
+    }
+
+    // Cliente HTTP prestado; vuelve al conjunto al destruirse salvo que se descarte
+    class Lease {
+    public:
+        explicit Lease(LlmClient& owner) : owner_(owner), client_(owner.acquire()) {}
+        ~Lease() {
+            if (client_) owner_.release(std::move(client_));
+        }
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        httplib::Client* operator->() { return client_.get(); }
+        void discard() { client_.reset(); }
+
+    private:
+        LlmClient& owner_;
+        std::unique_ptr<httplib::Client> client_;
+    };
+
+private:
+    std::unique_ptr<httplib::Client> acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!idle_.empty()) {
+                auto client = std::move(idle_.back());
+                idle_.pop_back();
+                return client;
+            }
+        }
+        auto client = std::make_unique<httplib::Client>(config_.host);
+        if (!client->is_valid()) {
+            throw std::runtime_error("URL del LLM no válida: " + config_.host +
+                                     " (para https compile con CPPHTTPLIB_OPENSSL_SUPPORT)");
+        }
+        client->set_keep_alive(true);
+        client->set_connection_timeout(10);
+        client->set_read_timeout(static_cast<time_t>(config_.timeout_s));
+        client->set_write_timeout(static_cast<time_t>(config_.timeout_s));
+        if (config_.azure) {
+            client->set_default_headers({{"api-key", config_.api_key}});
+        } else {
+            client->set_bearer_token_auth(config_.api_key);
+        }
+        return client;
+    }
+
+    void release(std::unique_ptr<httplib::Client> client) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(std::move(client));
+    }
+
+    const LlmConfig config_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<httplib::Client>> idle_;
+};
+
+}  // namespace mcp
@@ -0,0 +1,404 @@
+// Servidor MCP (Model Context Protocol) nativo: publica get_schema, list_tables, describe_tables,
+// read_query, read_queries y run_dashboard_agent como herramientas y el esquema como recursos
+// (postgres://schema y postgres://schema/compact), sobre JSON-RPC 2.0 por stdio o por HTTP
+// (transporte streamable HTTP, POST /mcp).
+//
+// Las herramientas usan el mismo núcleo que el módulo cpp_agent (agent_core.hpp): conexiones
+// del pool, cachés de esquema y de consultas, y resultados serializados con JsonWriter. Las
+// respuestas JSON-RPC se escriben directamente en un búfer con JsonWriter, sin pasar el resultado
+// de la herramienta por un DOM.
+//
+// Compilar:
+//   g++ -O2 -std=c++17 -Iinclude -I. mcp_server.cpp -o mcp_server -lpqxx -lpq -pthread
+// Ejecutar por stdio (p.ej. desde la configuración de un cliente MCP):
+//   mcp_server
+// o por HTTP:
+//   MCP_TRANSPORT=http MCP_HTTP_PORT=8001 mcp_server
+#include <httplib/httplib.h>
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "agent_core.hpp"
+#include "env.hpp"
+#include "json_writer.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+using namespace mcp::agent;
+
+// Versiones del protocolo aceptadas, de la más reciente a la más antigua
+constexpr std::string_view kProtocolVersions[] = {"2025-06-18", "2025-03-26", "2024-11-05"};
+constexpr std::string_view kSchemaUri = "postgres://schema";
+constexpr std::string_view kCompactSchemaUri = "postgres://schema/compact";
+
+// Códigos de error de JSON-RPC 2.0
+constexpr int kParseError = -32700;
+constexpr int kInvalidRequest = -32600;
+constexpr int kMethodNotFound = -32601;
+constexpr int kInvalidParams = -32602;
+constexpr int kInternalError = -32603;
+
+// Error de protocolo; los errores de las herramientas se devuelven como resultado con isError
+class RpcError : public std::runtime_error {
+public:
+    RpcError(int code, const std::string& message) : std::runtime_error(message), code(code) {}
+    int code;
+};
+
+// Escribir {"jsonrpc":"2.0","id":...,"result": y dejar el escritor listo para el valor; el
+// llamador cierra el sobre con end_object()
+void begin_result(mcp::JsonWriter& writer, const json& id) {
+    writer.begin_object();
+    writer.key("jsonrpc");
+    writer.string("2.0");
+    writer.key("id");
+    writer.raw(id.dump());
+    writer.key("result");
+}
+
+std::string rpc_error(const json& id, int code, std::string_view message) {
+    std::string out;
+    mcp::JsonWriter writer(out);
+    writer.begin_object();
+    writer.key("jsonrpc");
+    writer.string("2.0");
+    writer.key("id");
+    writer.raw(id.dump());
+    writer.key("error");
+    writer.begin_object();
+    writer.key("code");
+    writer.number(static_cast<long long>(code));
+    writer.key("message");
+    writer.string(message);
+    writer.end_object();
+    writer.end_object();
+    return out;
+}
+
+// Lista de herramientas en formato MCP, serializada una sola vez: las de la base de datos salen
+// de get_tools() y se añade el pipeline del dashboard
+const std::string& tools_list_json() {
+    static const std::string* tools = [] {
+        json list = json::array();
+        for (const auto& tool : get_tools(true, true)) {
+            list.push_back({
+                {"name", tool["function"]["name"]},
+                {"description", tool["function"]["description"]},
+                {"inputSchema", tool["function"]["parameters"]}
+            });
+        }
+        list.push_back({
+            {"name", "run_dashboard_agent"},
+            {"description", "Analiza la base de datos, obtiene las métricas relevantes para la petición y devuelve un dashboard HTML."},
+            {"inputSchema", {
+                {"type", "object"},
+                {"properties", {
+                    {"message", {
+                        {"type", "string"},
+                        {"description", "Descripción en lenguaje natural del dashboard deseado."}
+                    }}
+                }},
+                {"required", {"message"}}
+            }}
+        });
+        return new std::string(json{{"tools", list}}.dump());
+    }();
+    return *tools;
+}
+
+// Ejecutar una herramienta; devuelve el texto del resultado y si es un error
+std::pair<std::string, bool> call_tool(const std::string& name, const json& args) {
+    try {
+        if (name == "run_dashboard_agent") {
+            auto message = args.find("message");
+            if (message == args.end() || !message->is_string()) {
+                throw std::runtime_error("Falta el argumento message en la llamada a run_dashboard_agent");
+            }
+            return {run_dashboard_agent(message->get<std::string>(), cached_llm(native_llm(), true, true)), false};
+        }
+        ToolCall call{"", name, args};
+        check_tool_args(call);
+        std::string text = execute_tool(call);
+        // read_query y get_schema informan los errores como {"error": ...}
+        const bool is_error = text.rfind("{\"error\":", 0) == 0;
+        return {std::move(text), is_error};
+    } catch (const std::exception& e) {
+        return {e.what(), true};
+    }
+}
+
+void write_tool_result(mcp::JsonWriter& writer, std::string_view text, bool is_error) {
+    writer.begin_object();
+    writer.key("content");
+    writer.begin_array();
+    writer.begin_object();
+    writer.key("type");
+    writer.string("text");
+    writer.key("text");
+    writer.string(text);
+    writer.end_object();
+    writer.end_array();
+    writer.key("isError");
+    writer.boolean(is_error);
+    writer.end_object();
+}
+
+void write_initialize(mcp::JsonWriter& writer, const json& params) {
+    std::string_view version = kProtocolVersions[0];
+    auto requested = params.find("protocolVersion");
+    if (requested != params.end() && requested->is_string()) {
+        for (std::string_view supported : kProtocolVersions) {
+            if (requested->get_ref<const std::string&>() == supported) version = supported;
+        }
+    }
+    writer.begin_object();
+    writer.key("protocolVersion");
+    writer.string(version);
+    writer.key("capabilities");
+    writer.raw(R"({"tools":{"listChanged":false},"resources":{"subscribe":false,"listChanged":false}})");
+    writer.key("serverInfo");
+    writer.raw(R"({"name":"mcp-postgresql","version":"1.0.0"})");
+    writer.end_object();
+}
+
+void write_resource(mcp::JsonWriter& writer, std::string_view uri, std::string_view name,
+                    std::string_view description, std::string_view mime_type) {
+    writer.begin_object();
+    writer.key("uri");
+    writer.string(uri);
+    writer.key("name");
+    writer.string(name);
+    writer.key("description");
+    writer.string(description);
+    writer.key("mimeType");
+    writer.string(mime_type);
+    writer.end_object();
+}
+
+void write_resources_list(mcp::JsonWriter& writer) {
+    writer.begin_object();
+    writer.key("resources");
+    writer.begin_array();
+    write_resource(writer, kSchemaUri, "schema", "Esquema de la base de datos: columnas, claves, índices, filas estimadas y particiones.",
+                   "application/json");
+    write_resource(writer, kCompactSchemaUri, "schema_compact",
+                   "Esquema de la base de datos en formato compacto: una línea por tabla.", "text/plain");
+    writer.end_array();
+    writer.end_object();
+}
+
+void write_resource_read(mcp::JsonWriter& writer, const json& params) {
+    auto uri = params.find("uri");
+    if (uri == params.end() || !uri->is_string()) throw RpcError(kInvalidParams, "Falta la URI del recurso");
+    const std::string& requested = uri->get_ref<const std::string&>();
+    if (requested != kSchemaUri && requested != kCompactSchemaUri) {
+        throw RpcError(kInvalidParams, "Recurso desconocido: " + requested);
+    }
+    const bool compact = requested == kCompactSchemaUri;
+    writer.begin_object();
+    writer.key("contents");
+    writer.begin_array();
+    writer.begin_object();
+    writer.key("uri");
+    writer.string(requested);
+    writer.key("mimeType");
+    writer.string(compact ? "text/plain" : "application/json");
+    writer.key("text");
+    writer.string(get_db_schema(compact ? mcp::SchemaFormat::compact : mcp::SchemaFormat::json));
+    writer.end_object();
+    writer.end_array();
+    writer.end_object();
+}
+
+// Atender un mensaje JSON-RPC; devuelve la respuesta o una cadena vacía para notificaciones
+// y respuestas del cliente. Un mensaje mal formado recibe -32600 aunque no traiga id (con id
+// null, como pide JSON-RPC 2.0)
+std::string handle_message(const json& msg) {
+    if (!msg.is_object()) return rpc_error(nullptr, kInvalidRequest, "El mensaje debe ser un objeto");
+    auto method_it = msg.find("method");
+    auto id_it = msg.find("id");
+    const bool is_notification = id_it == msg.end();
+    // El id solo puede ser cadena, número o null; si no, no se puede usar en la respuesta
+    if (!is_notification && !id_it->is_string() && !id_it->is_number() && !id_it->is_null()) {
+        return rpc_error(nullptr, kInvalidRequest, "El id debe ser una cadena, un número o null");
+    }
+    const json id = is_notification ? json(nullptr) : *id_it;
+    if (method_it == msg.end()) {
+        // Respuesta del cliente a una petición del servidor: este servidor no envía ninguna
+        if (msg.contains("result") || msg.contains("error")) return std::string();
+        return rpc_error(id, kInvalidRequest, "Falta el método");
+    }
+    auto version_it = msg.find("jsonrpc");
+    if (version_it == msg.end() || !version_it->is_string() || version_it->get_ref<const std::string&>() != "2.0") {
+        return rpc_error(id, kInvalidRequest, "Petición JSON-RPC no válida: jsonrpc debe ser \"2.0\"");
+    }
+    if (!method_it->is_string()) return rpc_error(id, kInvalidRequest, "El método debe ser una cadena");
+    auto params_it = msg.find("params");
+    if (params_it != msg.end() && !params_it->is_object() && !params_it->is_array()) {
+        return rpc_error(id, kInvalidRequest, "params debe ser un objeto o un arreglo");
+    }
+    const std::string& method = method_it->get_ref<const std::string&>();
+    if (is_notification) return std::string();  // notifications/initialized, cancelled, ...
+
+    static const json empty_params = json::object();
+    if (params_it != msg.end() && !params_it->is_object()) {
+        return rpc_error(id, kInvalidParams, "Los parámetros deben ir por nombre, en un objeto");
+    }
+    const json& params = params_it != msg.end() ? *params_it : empty_params;
+
+    std::string out;
+    mcp::JsonWriter writer(out);
+    try {
+        if (method == "tools/call") {
+            auto name = params.find("name");
+            if (name == params.end() || !name->is_string()) throw RpcError(kInvalidParams, "Falta el nombre de la herramienta");
+            auto args = params.find("arguments");
+            if (args != params.end() && !args->is_object()) throw RpcError(kInvalidParams, "Los argumentos deben ser un objeto");
+            auto [text, is_error] = call_tool(name->get<std::string>(), args != params.end() ? *args : empty_params);
+            out.reserve(text.size() + text.size() / 8 + 96);
+            begin_result(writer, id);
+            write_tool_result(writer, text, is_error);
+        } else if (method == "tools/list") {
+            begin_result(writer, id);
+            writer.raw(tools_list_json());
+        } else if (method == "resources/read") {
+            begin_result(writer, id);
+            write_resource_read(writer, params);
+        } else if (method == "resources/list") {
+            begin_result(writer, id);
+            write_resources_list(writer);
+        } else if (method == "resources/templates/list") {
+            begin_result(writer, id);
+            writer.raw(R"({"resourceTemplates":[]})");
+        } else if (method == "initialize") {
+            begin_result(writer, id);
+            write_initialize(writer, params);
+        } else if (method == "ping") {
+            begin_result(writer, id);
+            writer.raw("{}");
+        } else {
+            throw RpcError(kMethodNotFound, "Método no soportado: " + method);
+        }
+        writer.end_object();
+        return out;
+    } catch (const RpcError& e) {
+        return rpc_error(id, e.code, e.what());
+    } catch (const std::exception& e) {
+        return rpc_error(id, kInternalError, e.what());
+    }
+}
+
+// Atender un mensaje o un lote (arreglo) de mensajes; cadena vacía si no hay nada que responder
+std::string handle_payload(std::string_view payload) {
+    json msg = json::parse(payload, nullptr, false);
+    if (msg.is_discarded()) return rpc_error(nullptr, kParseError, "JSON no válido");
+    if (!msg.is_array()) return handle_message(msg);
+    if (msg.empty()) return rpc_error(nullptr, kInvalidRequest, "Lote vacío");
+    std::string out = "[";
+    for (const auto& item : msg) {
+        std::string response = handle_message(item);
+        if (response.empty()) continue;
+        if (out.size() > 1) out += ',';
+        out += response;
+    }
+    if (out.size() == 1) return std::string();
+    out += ']';
+    return out;
+}
+
+// Transporte stdio: un mensaje JSON por línea. Cada línea se atiende en el pool para que una
+// herramienta lenta (p.ej. el dashboard) no bloquee las demás; las respuestas pueden salir en
+// otro orden, lo que JSON-RPC permite porque se asocian por id
+int serve_stdio() {
+    std::ios::sync_with_stdio(false);
+    // Sin esto cada getline vacía std::cout desde este hilo sin out_mutex, en carrera con los
+    // hilos de trabajo, y las respuestas pueden salir repetidas o perderse
+    std::cin.tie(nullptr);
+    std::mutex out_mutex;
+    {
+        mcp::ThreadPool workers(static_cast<std::size_t>(mcp::env_long("MCP_STDIO_WORKERS", 8)));
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+            workers.submit([&out_mutex, line = std::move(line)] {
+                std::string response = handle_payload(line);
+                if (response.empty()) return;
+                response += '\n';
+                std::lock_guard<std::mutex> lock(out_mutex);
+                std::cout.write(response.data(), static_cast<std::streamsize>(response.size()));
+                std::cout.flush();
+            });
+        }
+        // El destructor del pool espera a que terminen las peticiones pendientes
+    }
+    return 0;
+}
+
+// Solo se aceptan orígenes locales para evitar ataques de DNS rebinding desde un navegador
+bool allowed_origin(const httplib::Request& req) {
+    if (!req.has_header("Origin")) return true;
+    const std::string origin = req.get_header_value("Origin");
+    for (std::string_view local : {"http://localhost", "https://localhost", "http://127.0.0.1", "https://127.0.0.1"}) {
+        if (origin.compare(0, local.size(), local) == 0 &&
+            (origin.size() == local.size() || origin[local.size()] == ':')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Transporte streamable HTTP sin sesiones: cada POST /mcp lleva uno o varios mensajes y la
+// respuesta es JSON (el servidor no inicia flujos SSE, así que GET /mcp responde 405)
+int serve_http() {
+    const std::string host = mcp::env_string("MCP_HTTP_HOST", "127.0.0.1");
+    const int port = static_cast<int>(mcp::env_long("MCP_HTTP_PORT", 8001));
+    const auto threads = static_cast<std::size_t>(mcp::env_long("MCP_HTTP_THREADS", 32));
+
+    httplib::Server server;
+    server.new_task_queue = [threads] { return new httplib::ThreadPool(threads); };
+    // Las respuestas se escriben en dos partes (cabeceras y cuerpo); sin TCP_NODELAY el algoritmo
+    // de Nagle y el ACK retardado del cliente añaden ~40 ms a cada petición en conexiones keep-alive
+    server.set_tcp_nodelay(true);
+    server.Post("/mcp", [](const httplib::Request& req, httplib::Response& res) {
+        if (!allowed_origin(req)) {
+            res.status = 403;
+            res.set_content(rpc_error(nullptr, kInvalidRequest, "Origen no permitido"), "application/json");
+            return;
+        }
+        std::string response = handle_payload(req.body);
+        if (response.empty()) {
+            res.status = 202;
+            return;
+        }
+        res.set_content(std::move(response), "application/json");
+    });
+    server.Get("/mcp", [](const httplib::Request&, httplib::Response& res) {
+        res.status = 405;
+        res.set_header("Allow", "POST");
+    });
+
+    std::cerr << "mcp_server escuchando en http://" << host << ":" << port << "/mcp" << std::endl;
+    if (!server.listen(host, port)) {
+        std::cerr << "No se pudo escuchar en " << host << ":" << port << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main() {
+    // stdout queda reservado para el protocolo; el núcleo solo escribe diagnósticos en stderr
+    const std::string transport = mcp::env_string("MCP_TRANSPORT", "stdio");
+    if (transport == "stdio") return serve_stdio();
+    if (transport == "http") return serve_http();
+    std::cerr << "MCP_TRANSPORT no válido: " << transport << std::endl;
+    return 1;
+}
@@ -0,0 +1,380 @@
+#pragma once
+#include <pqxx/pqxx>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "json_writer.hpp"
+
+namespace mcp::pg {
+
+// Convierte el valor (no nulo) de una celda y lo escribe como JSON
+using Converter = void (*)(JsonWriter&, std::string_view);
+
+// ---- Convertidores para el formato de texto de PostgreSQL ----
+
+inline void text_as_string(JsonWriter& w, std::string_view v) { w.string(v); }
+
+// La salida textual de int2/int4/int8/oid ya es un número JSON válido
+inline void text_as_integer(JsonWriter& w, std::string_view v) { w.raw(v); }
+
+inline bool is_special_float(std::string_view v) {
+    return v == "NaN" || v == "Infinity" || v == "-Infinity";
+}
+
+// float4/float8: NaN e infinito no existen en JSON y se serializan como null
+inline void text_as_float(JsonWriter& w, std::string_view v) {
+    if (is_special_float(v)) w.null();
+    else w.raw(v);
+}
+
+// numeric nunca usa exponente; NaN/Infinity se conservan como cadena para no perder el valor
+inline void text_as_numeric(JsonWriter& w, std::string_view v) {
+    if (is_special_float(v)) w.string(v);
+    else w.raw(v);
+}
+
+inline void text_as_bool(JsonWriter& w, std::string_view v) { w.boolean(!v.empty() && v[0] == 't'); }
+
+// json/jsonb llegan como documento JSON válido y se incrustan sin reparsear
+inline void text_as_json(JsonWriter& w, std::string_view v) { w.raw(v); }
+
+// Arreglos de números o booleanos: {1,NULL,{2,3}} -> [1,null,[2,3]]
+inline void text_as_scalar_array(JsonWriter& w, std::string_view v) {
+    // Los arreglos con límites explícitos ("[0:1]={...}") se dejan como cadena
+    if (v.empty() || v.front() != '{') {
+        w.string(v);
+        return;
+    }
+    std::string& out = w.buffer();
+    w.raw("");
+    std::size_t i = 0;
+    while (i < v.size()) {
+        const char c = v[i];
+        if (c == '{') { out += '['; ++i; continue; }
+        if (c == '}') { out += ']'; ++i; continue; }
+        if (c == ',') { out += ','; ++i; continue; }
+        std::size_t end = v.find_first_of(",}", i);
+        if (end == std::string_view::npos) end = v.size();
+        std::string_view token = v.substr(i, end - i);
+        if (token == "NULL" || is_special_float(token)) out += "null";
+        else if (token == "t") out += "true";
+        else if (token == "f") out += "false";
+        else out.append(token);
+        i = end;
+    }
+}
+
+// ---- Convertidores para el formato binario (cursores BINARY) ----
+
+// Leer un entero big-endian (orden de red) de tamaño fijo
+template <typename T>
+inline T read_be(const char* p) {
+    using U = std::make_unsigned_t<T>;
+    U value = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        value = static_cast<U>((value << 8) | static_cast<unsigned char>(p[i]));
+    }
+    return static_cast<T>(value);
+}
+
+template <typename T>
+inline void binary_as_integer(JsonWriter& w, std::string_view v) {
+    if (v.size() != sizeof(T)) { w.null(); return; }
+    w.number(static_cast<long long>(read_be<T>(v.data())));
+}
+
+// Número en coma flotante con el mismo texto que float4out/float8out (PostgreSQL 12+ con
+// extra_float_digits=1): los dígitos mínimos que reproducen el valor en su propia precisión,
+// en notación fija si el exponente decimal está en [-4, fixed_max_exp) y científica si no
+// (0.1, 100000, 1e+06, 1.5e-05). Así el resultado binario es idéntico al de formato texto
+template <typename T>
+inline void write_pg_float(JsonWriter& w, T value, int fixed_max_exp) {
+    if (!std::isfinite(value)) { w.null(); return; }
+    char buf[64];
+    const auto res = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::scientific);
+    std::string_view sci(buf, static_cast<std::size_t>(res.ptr - buf));  // [-]d[.ddd]e±XX
+    std::string& out = w.buffer();
+    w.raw("");
+    if (sci.front() == '-') {
+        out += '-';
+        sci.remove_prefix(1);
+    }
+    const std::size_t e = sci.find('e');
+    std::string digits(1, sci[0]);
+    if (e > 1) digits.append(sci.substr(2, e - 2));
+    int exp = 0;
+    for (std::size_t i = e + 2; i < sci.size(); ++i) exp = exp * 10 + (sci[i] - '0');
+    if (sci[e + 1] == '-') exp = -exp;
+
+    const int n = static_cast<int>(digits.size());
+    if (exp >= -4 && exp < fixed_max_exp) {
+        if (exp < 0) {
+            out += "0.";
+            out.append(static_cast<std::size_t>(-exp - 1), '0');
+            out += digits;
+        } else if (n <= exp + 1) {
+            out += digits;
+            out.append(static_cast<std::size_t>(exp + 1 - n), '0');
+        } else {
+            out.append(digits, 0, static_cast<std::size_t>(exp + 1));
+            out += '.';
+            out.append(digits, static_cast<std::size_t>(exp + 1), std::string::npos);
+        }
+        return;
+    }
+    out += digits[0];
+    if (n > 1) {
+        out += '.';
+        out.append(digits, 1, std::string::npos);
+    }
+    out += exp < 0 ? "e-" : "e+";
+    const int magnitude = exp < 0 ? -exp : exp;
+    if (magnitude < 10) out += '0';
+    out += std::to_string(magnitude);
+}
+
+inline void binary_as_float4(JsonWriter& w, std::string_view v) {
+    if (v.size() != 4) { w.null(); return; }
+    const std::uint32_t bits = read_be<std::uint32_t>(v.data());
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    write_pg_float(w, f, 6);  // FLT_DIG
+}
+
+inline void binary_as_float8(JsonWriter& w, std::string_view v) {
+    if (v.size() != 8) { w.null(); return; }
+    const std::uint64_t bits = read_be<std::uint64_t>(v.data());
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    write_pg_float(w, d, 15);  // DBL_DIG
+}
+
+inline void binary_as_bool(JsonWriter& w, std::string_view v) { w.boolean(!v.empty() && v[0] != 0); }
+
+// text, varchar, bpchar, name y json se envían como los mismos bytes que en formato texto
+inline void binary_as_string(JsonWriter& w, std::string_view v) { w.string(v); }
+inline void binary_as_json(JsonWriter& w, std::string_view v) { w.raw(v); }
+
+// jsonb: un byte de versión (1) seguido del documento en texto
+inline void binary_as_jsonb(JsonWriter& w, std::string_view v) {
+    if (v.empty() || v[0] != 1) { w.null(); return; }
+    w.raw(v.substr(1));
+}
+
+// bytea: mismo formato hexadecimal que la salida textual (\x...)
+inline void binary_as_bytea(JsonWriter& w, std::string_view v) {
+    static constexpr char hex[] = "0123456789abcdef";
+    std::string text = "\\x";
+    text.reserve(2 + v.size() * 2);
+    for (unsigned char c : v) {
+        text += hex[c >> 4];
+        text += hex[c & 0xF];
+    }
+    w.string(text);
+}
+
+inline void binary_as_uuid(JsonWriter& w, std::string_view v) {
+    static constexpr char hex[] = "0123456789abcdef";
+    if (v.size() != 16) { w.null(); return; }
+    char text[36];
+    std::size_t pos = 0;
+    for (std::size_t i = 0; i < 16; ++i) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) text[pos++] = '-';
+        const unsigned char c = static_cast<unsigned char>(v[i]);
+        text[pos++] = hex[c >> 4];
+        text[pos++] = hex[c & 0xF];
+    }
+    w.string(std::string_view(text, sizeof(text)));
+}
+
+// numeric: ndigits, weight, sign y dscale seguidos de dígitos en base 10000
+inline void binary_as_numeric(JsonWriter& w, std::string_view v) {
+    if (v.size() < 8) { w.null(); return; }
+    const int ndigits = read_be<std::int16_t>(v.data());
+    const int weight = read_be<std::int16_t>(v.data() + 2);
+    const std::uint16_t sign = read_be<std::uint16_t>(v.data() + 4);
+    const int dscale = read_be<std::uint16_t>(v.data() + 6);
+    if (ndigits < 0 || v.size() < 8 + 2 * static_cast<std::size_t>(ndigits)) { w.null(); return; }
+    if (sign == 0xC000) { w.string("NaN"); return; }
+    if (sign == 0xD000) { w.string("Infinity"); return; }
+    if (sign == 0xF000) { w.string("-Infinity"); return; }
+
+    auto digit = [&](int i) -> int {
+        return (i >= 0 && i < ndigits) ? read_be<std::int16_t>(v.data() + 8 + 2 * i) : 0;
+    };
+    std::string& out = w.buffer();
+    w.raw("");
+    if (sign == 0x4000) out += '-';
+    char buf[8];
+    if (weight < 0) {
+        out += '0';
+    } else {
+        for (int d = 0; d <= weight; ++d) {
+            std::snprintf(buf, sizeof(buf), d == 0 ? "%d" : "%04d", digit(d));
+            out += buf;
+        }
+    }
+    if (dscale > 0) {
+        out += '.';
+        int written = 0;
+        for (int d = weight + 1; written < dscale; ++d) {
+            std::snprintf(buf, sizeof(buf), "%04d", digit(d));
+            for (int k = 0; k < 4 && written < dscale; ++k, ++written) out += buf[k];
+        }
+    }
+}
+
+// HH:MM:SS con fracción de microsegundos sin ceros finales, como la salida textual
+inline void append_time(std::string& out, long long micros) {
+    char buf[32];
+    const long long secs = micros / 1000000;
+    std::snprintf(buf, sizeof(buf), "%02lld:%02lld:%02lld", secs / 3600, (secs / 60) % 60, secs % 60);
+    out += buf;
+    long long frac = micros % 1000000;
+    if (frac != 0) {
+        std::snprintf(buf, sizeof(buf), ".%06lld", frac);
+        std::size_t len = std::strlen(buf);
+        while (buf[len - 1] == '0') --len;
+        out.append(buf, len);
+    }
+}
+
+inline void binary_as_time(JsonWriter& w, std::string_view v) {
+    if (v.size() != 8) { w.null(); return; }
+    std::string text;
+    append_time(text, read_be<std::int64_t>(v.data()));
+    w.string(text);
+}
+
+// date, timestamp y timestamptz no tienen decodificador binario: su salida textual depende de
+// DateStyle y, en timestamptz, del TimeZone de la sesión, así que se leen siempre como texto
+
+// Descripción de un tipo integrado de PostgreSQL
+struct TypeInfo {
+    pqxx::oid oid;
+    const char* name;
+    Converter text;
+    Converter binary;  // nullptr si el tipo no tiene decodificador binario
+};
+
+// Registro de tipos integrados (pg_type.dat); los OID no listados se tratan como texto
+inline const TypeInfo* lookup_type(pqxx::oid oid) {
+    static const TypeInfo types[] = {
+        {16, "bool", text_as_bool, binary_as_bool},
+        {17, "bytea", text_as_string, binary_as_bytea},
+        {18, "char", text_as_string, binary_as_string},
+        {19, "name", text_as_string, binary_as_string},
+        {20, "int8", text_as_integer, binary_as_integer<std::int64_t>},
+        {21, "int2", text_as_integer, binary_as_integer<std::int16_t>},
+        {23, "int4", text_as_integer, binary_as_integer<std::int32_t>},
+        {24, "regproc", text_as_string, nullptr},
+        {25, "text", text_as_string, binary_as_string},
+        {26, "oid", text_as_integer, binary_as_integer<std::uint32_t>},
+        {28, "xid", text_as_integer, binary_as_integer<std::uint32_t>},
+        {29, "cid", text_as_integer, binary_as_integer<std::uint32_t>},
+        {114, "json", text_as_json, binary_as_json},
+        {142, "xml", text_as_string, nullptr},
+        {600, "point", text_as_string, nullptr},
+        {601, "lseg", text_as_string, nullptr},
+        {602, "path", text_as_string, nullptr},
+        {603, "box", text_as_string, nullptr},
+        {604, "polygon", text_as_string, nullptr},
+        {628, "line", text_as_string, nullptr},
+        {650, "cidr", text_as_string, nullptr},
+        {700, "float4", text_as_float, binary_as_float4},
+        {701, "float8", text_as_float, binary_as_float8},
+        {718, "circle", text_as_string, nullptr},
+        {774, "macaddr8", text_as_string, nullptr},
+        {790, "money", text_as_string, nullptr},
+        {829, "macaddr", text_as_string, nullptr},
+        {869, "inet", text_as_string, nullptr},
+        {1042, "bpchar", text_as_string, binary_as_string},
+        {1043, "varchar", text_as_string, binary_as_string},
+        {1082, "date", text_as_string, nullptr},
+        {1083, "time", text_as_string, binary_as_time},
+        {1114, "timestamp", text_as_string, nullptr},
+        {1184, "timestamptz", text_as_string, nullptr},
+        {1186, "interval", text_as_string, nullptr},
+        {1266, "timetz", text_as_string, nullptr},
+        {1560, "bit", text_as_string, nullptr},
+        {1562, "varbit", text_as_string, nullptr},
+        {1700, "numeric", text_as_numeric, binary_as_numeric},
+        {2205, "regclass", text_as_string, nullptr},
+        {2206, "regtype", text_as_string, nullptr},
+        {2950, "uuid", text_as_string, binary_as_uuid},
+        {3220, "pg_lsn", text_as_string, nullptr},
+        {3614, "tsvector", text_as_string, nullptr},
+        {3615, "tsquery", text_as_string, nullptr},
+        {3802, "jsonb", text_as_json, binary_as_jsonb},
+        {3904, "int4range", text_as_string, nullptr},
+        {3906, "numrange", text_as_string, nullptr},
+        {3908, "tsrange", text_as_string, nullptr},
+        {3910, "tstzrange", text_as_string, nullptr},
+        {3912, "daterange", text_as_string, nullptr},
+        {3926, "int8range", text_as_string, nullptr},
+        {4072, "jsonpath", text_as_string, nullptr},
+        {5069, "xid8", text_as_integer, nullptr},
+        // Arreglos
+        {1000, "_bool", text_as_scalar_array, nullptr},
+        {1005, "_int2", text_as_scalar_array, nullptr},
+        {1007, "_int4", text_as_scalar_array, nullptr},
+        {1016, "_int8", text_as_scalar_array, nullptr},
+        {1021, "_float4", text_as_scalar_array, nullptr},
+        {1022, "_float8", text_as_scalar_array, nullptr},
+        {1028, "_oid", text_as_scalar_array, nullptr},
+        {1231, "_numeric", text_as_scalar_array, nullptr},
+        {1009, "_text", text_as_string, nullptr},
+        {1015, "_varchar", text_as_string, nullptr},
+        {1182, "_date", text_as_string, nullptr},
+        {1115, "_timestamp", text_as_string, nullptr},
+        {1185, "_timestamptz", text_as_string, nullptr},
+        {2951, "_uuid", text_as_string, nullptr},
+        {199, "_json", text_as_string, nullptr},
+        {3807, "_jsonb", text_as_string, nullptr},
+    };
+    static const std::unordered_map<pqxx::oid, const TypeInfo*> index = [] {
+        std::unordered_map<pqxx::oid, const TypeInfo*> map;
+        for (const auto& t : types) map.emplace(t.oid, &t);
+        return map;
+    }();
+    auto it = index.find(oid);
+    return it == index.end() ? nullptr : it->second;
+}
+
+// Columna de un resultado: clave JSON precalculada y convertidor elegido una sola vez
+struct Column {
+    std::string key;
+    Converter convert;
+};
+
+// Con `binary` el resultado proviene de un cursor BINARY (ver has_binary_decoders)
+inline std::vector<Column> describe_columns(const pqxx::result& res, bool binary = false) {
+    std::vector<Column> columns;
+    columns.reserve(res.columns());
+    for (pqxx::row_size_type col = 0; col < res.columns(); ++col) {
+        const TypeInfo* type = lookup_type(res.column_type(col));
+        Converter convert = text_as_string;
+        if (type) convert = binary ? type->binary : type->text;
+        columns.push_back({quoted_key(res.column_name(col)), convert});
+    }
+    return columns;
+}
+
+// ¿Todas las columnas del resultado tienen decodificador binario?
+inline bool has_binary_decoders(const pqxx::result& res) {
+    for (pqxx::row_size_type col = 0; col < res.columns(); ++col) {
+        const TypeInfo* type = lookup_type(res.column_type(col));
+        if (!type || !type->binary) return false;
+    }
+    return true;
+}
+
+}  // namespace mcp::pg
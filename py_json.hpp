@@ -0,0 +1,277 @@
+#pragma once
+#include <Python.h>
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mcp {
+
+// Profundidad máxima de anidamiento; sin recursión no hay riesgo de desbordar la pila, pero una
+// lista que se contiene a sí misma crecería sin fin
+inline constexpr std::size_t kMaxPyJsonDepth = 10000;
+
+namespace detail {
+
+// Claves de objeto ya convertidas durante una conversión: las filas de un resultado repiten los
+// mismos nombres de columna miles de veces
+class KeyInterner {
+public:
+    KeyInterner() = default;
+    KeyInterner(const KeyInterner&) = delete;
+    KeyInterner& operator=(const KeyInterner&) = delete;
+    ~KeyInterner() {
+        for (auto& entry : keys_) Py_DECREF(entry.second);
+    }
+
+    // Referencia prestada; la vista debe seguir viva mientras dure el KeyInterner
+    PyObject* get(std::string_view key) {
+        auto it = keys_.find(key);
+        if (it != keys_.end()) return it->second;
+        PyObject* str = PyUnicode_DecodeUTF8(key.data(), static_cast<Py_ssize_t>(key.size()), "replace");
+        if (!str) return nullptr;
+        PyUnicode_InternInPlace(&str);
+        keys_.emplace(key, str);
+        return str;
+    }
+
+private:
+    std::unordered_map<std::string_view, PyObject*> keys_;
+};
+
+// Valor escalar, o contenedor vacío (la lista ya con su tamaño) (referencia nueva)
+inline PyObject* py_shallow(const nlohmann::json& value) {
+    using value_t = nlohmann::json::value_t;
+    switch (value.type()) {
+        case value_t::object:
+            return PyDict_New();
+        case value_t::array:
+            return PyList_New(static_cast<Py_ssize_t>(value.size()));
+        case value_t::string: {
+            const auto& s = value.get_ref<const nlohmann::json::string_t&>();
+            return PyUnicode_DecodeUTF8(s.data(), static_cast<Py_ssize_t>(s.size()), "replace");
+        }
+        case value_t::boolean:
+            return PyBool_FromLong(value.get<bool>());
+        case value_t::number_integer:
+            return PyLong_FromLongLong(value.get<long long>());
+        case value_t::number_unsigned:
+            return PyLong_FromUnsignedLongLong(value.get<unsigned long long>());
+        case value_t::number_float:
+            return PyFloat_FromDouble(value.get<double>());
+        case value_t::binary: {
+            const auto& b = value.get_binary();
+            return PyBytes_FromStringAndSize(reinterpret_cast<const char*>(b.data()), static_cast<Py_ssize_t>(b.size()));
+        }
+        case value_t::null:
+        case value_t::discarded:
+        default:
+            Py_INCREF(Py_None);
+            return Py_None;
+    }
+}
+
+}  // namespace detail
+
+// Convertir un json en objetos de Python sin recursión. Devuelve una referencia nueva, o nullptr
+// con la excepción de Python establecida. Requiere el GIL.
+inline PyObject* json_to_py(const nlohmann::json& value) {
+    PyObject* root = detail::py_shallow(value);
+    if (!root || !value.is_structured() || value.empty()) return root;
+
+    struct Frame {
+        const nlohmann::json* src;
+        PyObject* dst;
+        nlohmann::json::const_iterator it;
+        Py_ssize_t index;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({&value, root, value.cbegin(), 0});
+    detail::KeyInterner keys;
+
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        if (frame.it == frame.src->cend()) {
+            stack.pop_back();
+            continue;
+        }
+        const nlohmann::json& child = frame.it.value();
+        PyObject* item = detail::py_shallow(child);
+        if (!item) {
+            Py_DECREF(root);
+            return nullptr;
+        }
+        if (frame.src->is_object()) {
+            PyObject* key = keys.get(frame.it.key());
+            const bool ok = key && PyDict_SetItem(frame.dst, key, item) == 0;
+            Py_DECREF(item);  // el diccionario guarda su propia referencia
+            if (!ok) {
+                Py_DECREF(root);
+                return nullptr;
+            }
+        } else {
+            PyList_SET_ITEM(frame.dst, frame.index++, item);  // roba la referencia
+        }
+        ++frame.it;
+        if (child.is_structured() && !child.empty()) {
+            if (stack.size() >= kMaxPyJsonDepth) {
+                Py_DECREF(root);
+                PyErr_SetString(PyExc_ValueError, "JSON demasiado anidado para convertirlo a Python");
+                return nullptr;
+            }
+            stack.push_back({&child, item, child.cbegin(), 0});  // `frame` deja de ser válido aquí
+        }
+    }
+    return root;
+}
+
+namespace detail {
+
+// Escalar de Python a json; los contenedores quedan vacíos para rellenarlos después
+inline bool json_shallow(PyObject* obj, nlohmann::json& out) {
+    if (obj == Py_None) {
+        out = nullptr;
+    } else if (PyBool_Check(obj)) {
+        out = obj == Py_True;
+    } else if (PyLong_Check(obj)) {
+        int overflow = 0;
+        long long v = PyLong_AsLongLongAndOverflow(obj, &overflow);
+        if (overflow == 0) {
+            if (v == -1 && PyErr_Occurred()) return false;
+            out = v;
+        } else if (overflow > 0) {
+            unsigned long long u = PyLong_AsUnsignedLongLong(obj);
+            if (PyErr_Occurred()) {
+                // Fuera de rango de 64 bits: mismo criterio que json.loads con números enormes
+                PyErr_Clear();
+                double d = PyLong_AsDouble(obj);
+                if (d == -1.0 && PyErr_Occurred()) return false;
+                out = d;
+            } else {
+                out = u;
+            }
+        } else {
+            double d = PyLong_AsDouble(obj);
+            if (d == -1.0 && PyErr_Occurred()) return false;
+            out = d;
+        }
+    } else if (PyFloat_Check(obj)) {
+        out = PyFloat_AS_DOUBLE(obj);
+    } else if (PyUnicode_Check(obj)) {
+        Py_ssize_t size = 0;
+        const char* data = PyUnicode_AsUTF8AndSize(obj, &size);
+        if (!data) return false;
+        out = std::string(data, static_cast<std::size_t>(size));
+    } else if (PyDict_Check(obj)) {
+        out = nlohmann::json::object();
+    } else if (PyList_Check(obj) || PyTuple_Check(obj)) {
+        out = nlohmann::json::array();
+        out.get_ref<nlohmann::json::array_t&>().reserve(static_cast<std::size_t>(Py_SIZE(obj)));
+    } else {
+        PyErr_Format(PyExc_TypeError, "Tipo de Python no convertible a JSON: %s", Py_TYPE(obj)->tp_name);
+        return false;
+    }
+    return true;
+}
+
+// Clave de diccionario como texto. Como json.dumps: True, False y None pasan a "true", "false"
+// y "null", y los int y float (también sus subclases) se escriben con su repr. Cualquier otra
+// clave se convierte con str(), que puede ejecutar código de Python
+inline bool dict_key(PyObject* key, std::string& out) {
+    if (key == Py_True || key == Py_False || key == Py_None) {
+        out = key == Py_True ? "true" : key == Py_False ? "false" : "null";
+        return true;
+    }
+    PyObject* str = PyUnicode_Check(key) ? (Py_INCREF(key), key)
+                    : PyLong_Check(key)  ? PyLong_Type.tp_repr(key)
+                    : PyFloat_Check(key) ? PyFloat_Type.tp_repr(key)
+                                         : PyObject_Str(key);
+    if (!str) return false;
+    Py_ssize_t size = 0;
+    const char* data = PyUnicode_AsUTF8AndSize(str, &size);
+    if (data) out.assign(data, static_cast<std::size_t>(size));
+    Py_DECREF(str);
+    return data != nullptr;
+}
+
+}  // namespace detail
+
+// Convertir objetos de Python (dict, list, tuple, str, int, float, bool, None) a json sin
+// recursión. Devuelve false con la excepción de Python establecida. Requiere el GIL.
+inline bool py_to_json(PyObject* obj, nlohmann::json& out) {
+    if (!detail::json_shallow(obj, out)) return false;
+    if (!out.is_structured()) return true;
+
+    // Los marcos y el elemento en curso guardan referencias propias: str() de una clave puede
+    // ejecutar código de Python que modifique o libere los contenedores que se recorren
+    struct Frame {
+        PyObject* src;
+        nlohmann::json* dst;
+        Py_ssize_t pos;
+    };
+    std::vector<Frame> stack;
+    auto fail = [&stack] {
+        for (const Frame& frame : stack) Py_DECREF(frame.src);
+        return false;
+    };
+    Py_INCREF(obj);
+    stack.push_back({obj, &out, 0});
+    std::string key;
+
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        PyObject* item = nullptr;
+        nlohmann::json* slot = nullptr;
+        if (PyDict_Check(frame.src)) {
+            PyObject* k = nullptr;
+            if (!PyDict_Next(frame.src, &frame.pos, &k, &item)) {
+                Py_DECREF(frame.src);
+                stack.pop_back();
+                continue;
+            }
+            Py_INCREF(k);
+            Py_INCREF(item);
+            const bool ok = detail::dict_key(k, key);
+            Py_DECREF(k);
+            if (!ok) {
+                Py_DECREF(item);
+                return fail();
+            }
+            slot = &(*frame.dst)[key];
+        } else {
+            if (frame.pos >= Py_SIZE(frame.src)) {
+                Py_DECREF(frame.src);
+                stack.pop_back();
+                continue;
+            }
+            item = PyList_Check(frame.src) ? PyList_GET_ITEM(frame.src, frame.pos) : PyTuple_GET_ITEM(frame.src, frame.pos);
+            Py_INCREF(item);
+            ++frame.pos;
+            auto& array = frame.dst->get_ref<nlohmann::json::array_t&>();
+            array.emplace_back();
+            slot = &array.back();
+        }
+        if (!detail::json_shallow(item, *slot)) {
+            Py_DECREF(item);
+            return fail();
+        }
+        if (!slot->is_structured()) {
+            Py_DECREF(item);
+            continue;
+        }
+        if (stack.size() >= kMaxPyJsonDepth) {
+            Py_DECREF(item);
+            PyErr_SetString(PyExc_ValueError, "Estructura de Python demasiado anidada o circular para JSON");
+            return fail();
+        }
+        // Los hijos terminan antes de que el padre añada otro elemento, así que `slot` sigue
+        // siendo válido mientras su marco está en la pila. El marco se queda con la referencia
+        stack.push_back({item, slot, 0});
+    }
+    return true;
+}
+
+}  // namespace mcp
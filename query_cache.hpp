@@ -0,0 +1,219 @@
+#pragma once
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace mcp {
+
+// Texto normalizado de una consulta SQL para usarlo como clave de caché: sin comentarios,
+// espacios colapsados, palabras clave e identificadores sin comillas en minúsculas y sin ';'
+// final. Los literales y los identificadores entre comillas se conservan tal cual: a diferencia
+// del queryid de pg_stat_statements, dos consultas con distintas constantes devuelven datos
+// distintos y no pueden compartir entrada.
+inline std::string normalize_sql(std::string_view sql) {
+    enum class Kind { none, word, op, punct };
+    auto is_word = [](unsigned char c) { return std::isalnum(c) || c == '_' || c == '$' || c == '.' || c >= 0x80; };
+    auto is_op = [](char c) { return std::string_view("+-*/<>=~!@#%^&|`?:").find(c) != std::string_view::npos; };
+
+    std::string out;
+    out.reserve(sql.size());
+    Kind last = Kind::none;
+    auto emit = [&](Kind kind, std::string_view token) {
+        if ((kind == Kind::word && last == Kind::word) || (kind == Kind::op && last == Kind::op)) out += ' ';
+        out.append(token);
+        last = kind;
+    };
+
+    std::size_t i = 0;
+    const std::size_t n = sql.size();
+    while (i < n) {
+        const char c = sql[i];
+        if (std::isspace(static_cast<unsigned char>(c))) { ++i; continue; }
+        if (c == '-' && i + 1 < n && sql[i + 1] == '-') {
+            while (i < n && sql[i] != '\n') ++i;
+            continue;
+        }
+        if (c == '/' && i + 1 < n && sql[i + 1] == '*') {
+            // Los comentarios de bloque de PostgreSQL pueden anidarse
+            int depth = 0;
+            do {
+                if (sql.compare(i, 2, "/*") == 0) { ++depth; i += 2; }
+                else if (sql.compare(i, 2, "*/") == 0) { --depth; i += 2; }
+                else ++i;
+            } while (i < n && depth > 0);
+            continue;
+        }
+        if (c == '\'' || ((c == 'e' || c == 'E') && i + 1 < n && sql[i + 1] == '\'')) {
+            // Literal de cadena ('' escapa la comilla; en E'...' también la barra invertida)
+            const bool escapes = c != '\'';
+            std::size_t start = i;
+            i += escapes ? 2 : 1;
+            while (i < n) {
+                if (escapes && sql[i] == '\\') { i += 2; continue; }
+                if (sql[i] == '\'') {
+                    if (i + 1 < n && sql[i + 1] == '\'') { i += 2; continue; }
+                    ++i;
+                    break;
+                }
+                ++i;
+            }
+            emit(Kind::word, sql.substr(start, i - start));
+            continue;
+        }
+        if (c == '"') {
+            std::size_t start = i++;
+            while (i < n) {
+                if (sql[i] == '"') {
+                    if (i + 1 < n && sql[i + 1] == '"') { i += 2; continue; }
+                    ++i;
+                    break;
+                }
+                ++i;
+            }
+            emit(Kind::word, sql.substr(start, i - start));
+            continue;
+        }
+        if (c == '$') {
+            // Cadena con dólares: $etiqueta$ ... $etiqueta$
+            std::size_t tag_end = sql.find('$', i + 1);
+            if (tag_end != std::string_view::npos) {
+                std::string_view tag = sql.substr(i, tag_end - i + 1);
+                bool valid_tag = true;
+                for (char t : tag.substr(1, tag.size() - 2)) {
+                    if (!std::isalnum(static_cast<unsigned char>(t)) && t != '_') valid_tag = false;
+                }
+                if (valid_tag) {
+                    std::size_t close = sql.find(tag, tag_end + 1);
+                    std::size_t end = close == std::string_view::npos ? n : close + tag.size();
+                    emit(Kind::word, sql.substr(i, end - i));
+                    i = end;
+                    continue;
+                }
+            }
+        }
+        if (is_word(static_cast<unsigned char>(c))) {
+            std::string word;
+            while (i < n && is_word(static_cast<unsigned char>(sql[i]))) {
+                word += static_cast<char>(std::tolower(static_cast<unsigned char>(sql[i])));
+                ++i;
+            }
+            emit(Kind::word, word);
+            continue;
+        }
+        if (is_op(c)) {
+            std::size_t start = i;
+            while (i < n && is_op(sql[i]) && sql.compare(i, 2, "--") != 0 && sql.compare(i, 2, "/*") != 0) ++i;
+            if (i == start) ++i;
+            emit(Kind::op, sql.substr(start, i - start));
+            continue;
+        }
+        emit(Kind::punct, sql.substr(i, 1));
+        ++i;
+    }
+    while (!out.empty() && out.back() == ';') out.pop_back();
+    return out;
+}
+
+// Caché LRU de resultados en memoria, acotada por bytes y con caducidad por entrada
+class QueryCache {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct Stats {
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;
+        unsigned long long evictions = 0;
+        unsigned long long expirations = 0;
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+    };
+
+    QueryCache(std::size_t max_bytes, std::chrono::milliseconds default_ttl)
+        : max_bytes_(max_bytes), default_ttl_(default_ttl) {}
+
+    std::chrono::milliseconds default_ttl() const { return default_ttl_; }
+
+    std::shared_ptr<const std::string> get(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            ++stats_.misses;
+            return nullptr;
+        }
+        if (clock::now() >= it->second->expires_at) {
+            erase_locked(it->second);
+            ++stats_.expirations;
+            ++stats_.misses;
+            return nullptr;
+        }
+        // Mover al frente (más reciente)
+        lru_.splice(lru_.begin(), lru_, it->second);
+        ++stats_.hits;
+        return it->second->value;
+    }
+
+    void put(const std::string& key, std::string value, std::chrono::milliseconds ttl) {
+        const std::size_t bytes = entry_bytes(key, value);
+        if (ttl.count() <= 0 || bytes > max_bytes_) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) erase_locked(it->second);
+        lru_.push_front({key, std::make_shared<const std::string>(std::move(value)), clock::now() + ttl, bytes});
+        index_.emplace(key, lru_.begin());
+        stats_.bytes += bytes;
+        while (stats_.bytes > max_bytes_ && !lru_.empty()) {
+            erase_locked(std::prev(lru_.end()));
+            ++stats_.evictions;
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lru_.clear();
+        index_.clear();
+        stats_.bytes = 0;
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats s = stats_;
+        s.entries = lru_.size();
+        return s;
+    }
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const std::string> value;
+        clock::time_point expires_at;
+        std::size_t bytes;
+    };
+    using Iterator = std::list<Entry>::iterator;
+
+    // Tamaño aproximado de una entrada, incluyendo la clave y los nodos de la lista y el índice
+    static std::size_t entry_bytes(const std::string& key, const std::string& value) {
+        return 2 * key.size() + value.size() + 128;
+    }
+
+    void erase_locked(Iterator it) {
+        stats_.bytes -= it->bytes;
+        index_.erase(it->key);
+        lru_.erase(it);
+    }
+
+    const std::size_t max_bytes_;
+    const std::chrono::milliseconds default_ttl_;
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;
+    std::unordered_map<std::string, Iterator> index_;
+    Stats stats_;
+};
+
+}  // namespace mcp
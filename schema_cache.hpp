@@ -0,0 +1,334 @@
+#pragma once
+#include <pqxx/pqxx>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "db_pool.hpp"
+#include "json_writer.hpp"
+#include "schema_format.hpp"
+
+namespace mcp {
+
+// Instantánea inmutable del esquema, compartida entre hilos. Cada tabla se serializa una sola
+// vez en cada codificación; get_schema las concatena y describe_tables las reutiliza
+struct SchemaSnapshot {
+    std::string signature;  // firma del catálogo con la que se construyó
+    std::string json;       // serialización que devuelve la herramienta get_schema
+    std::string compact;    // codificación compacta (ver schema_format.hpp)
+    std::string columns;    // un objeto por columna, la forma anterior de json
+    std::vector<SchemaTable> tables;          // ordenadas por nombre
+    std::vector<std::string> table_json;      // objeto JSON de cada tabla
+    std::vector<std::string> table_compact;   // línea compacta de cada tabla, con '\n'
+    std::vector<std::string> table_columns;   // objetos de las columnas de cada tabla separados por comas
+    std::unordered_map<std::string, std::size_t> by_name;
+    std::unordered_map<std::string, std::size_t> by_lower_name;
+
+    const std::string& text(SchemaFormat format) const {
+        switch (format) {
+            case SchemaFormat::compact: return compact;
+            case SchemaFormat::columns: return columns;
+            case SchemaFormat::json: break;
+        }
+        return json;
+    }
+
+    // Posición de una tabla por nombre exacto o, si no, sin distinguir mayúsculas; se acepta
+    // el prefijo "public."
+    std::optional<std::size_t> find(std::string_view name) const {
+        if (name.substr(0, 7) == "public.") name.remove_prefix(7);
+        std::string key(name);
+        auto it = by_name.find(key);
+        if (it != by_name.end()) return it->second;
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+        it = by_lower_name.find(key);
+        if (it != by_lower_name.end()) return it->second;
+        return std::nullopt;
+    }
+};
+
+// Construir la instantánea a partir de las tablas leídas del catálogo (la firma la pone SchemaCache)
+inline std::shared_ptr<SchemaSnapshot> make_schema_snapshot(std::vector<SchemaTable> tables) {
+    auto snapshot = std::make_shared<SchemaSnapshot>();
+    snapshot->table_json.reserve(tables.size());
+    snapshot->table_compact.reserve(tables.size());
+    snapshot->table_columns.reserve(tables.size());
+    snapshot->json = "[";
+    snapshot->columns = "[";
+    for (std::size_t i = 0; i < tables.size(); ++i) {
+        std::string object;
+        JsonWriter writer(object);
+        write_table_json(writer, tables[i]);
+        std::string line;
+        append_table_compact(line, tables[i]);
+        std::string column_objects;
+        JsonWriter columns_writer(column_objects);
+        write_table_columns(columns_writer, tables[i]);
+
+        if (i > 0) snapshot->json += ',';
+        snapshot->json += object;
+        snapshot->compact += line;
+        if (!column_objects.empty()) {
+            if (snapshot->columns.size() > 1) snapshot->columns += ',';
+            snapshot->columns += column_objects;
+        }
+        snapshot->table_json.push_back(std::move(object));
+        snapshot->table_compact.push_back(std::move(line));
+        snapshot->table_columns.push_back(std::move(column_objects));
+
+        std::string lower = tables[i].name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+        snapshot->by_name.emplace(tables[i].name, i);
+        snapshot->by_lower_name.emplace(std::move(lower), i);
+    }
+    snapshot->json += ']';
+    snapshot->columns += ']';
+    snapshot->tables = std::move(tables);
+    return snapshot;
+}
+
+// Página [offset, offset + limit) de list_tables: nombre, tipo y filas estimadas, sin columnas.
+// En compact, una línea por tabla y un pie con el total y el siguiente offset; en las demás, un
+// objeto {total, tables, next_offset}
+inline std::string list_snapshot_tables(const SchemaSnapshot& snapshot, std::size_t offset, std::size_t limit,
+                                        SchemaFormat format) {
+    const auto& tables = snapshot.tables;
+    const std::size_t begin = std::min(offset, tables.size());
+    const std::size_t end = begin + std::min(limit, tables.size() - begin);
+    std::string out;
+    if (format == SchemaFormat::compact) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (tables[i].kind != "table" && tables[i].kind != "partitioned table") {
+                out.append(tables[i].kind);
+                out += ' ';
+            }
+            out.append(tables[i].name);
+            if (tables[i].rows_estimate >= 0) out += " ~" + std::to_string(tables[i].rows_estimate) + " rows";
+            out += '\n';
+        }
+        out += "# " + std::to_string(end - begin) + " de " + std::to_string(tables.size()) + " tablas";
+        if (end < tables.size()) out += "; siguiente offset=" + std::to_string(end);
+        out += '\n';
+        return out;
+    }
+    JsonWriter writer(out);
+    writer.begin_object();
+    writer.key("total");
+    writer.number(static_cast<long long>(tables.size()));
+    writer.key("tables");
+    writer.begin_array();
+    for (std::size_t i = begin; i < end; ++i) {
+        writer.begin_object();
+        writer.key("table_name");
+        writer.string(tables[i].name);
+        writer.key("kind");
+        writer.string(tables[i].kind);
+        if (tables[i].rows_estimate >= 0) {
+            writer.key("rows_estimate");
+            writer.number(tables[i].rows_estimate);
+        }
+        writer.end_object();
+    }
+    writer.end_array();
+    writer.key("next_offset");
+    if (end < tables.size()) {
+        writer.number(static_cast<long long>(end));
+    } else {
+        writer.null();
+    }
+    writer.end_object();
+    return out;
+}
+
+// Detalle de describe_tables, tomado de las serializaciones por tabla de la instantánea; las
+// tablas que no existen se señalan en su lugar sin fallar la llamada
+inline std::string describe_snapshot_tables(const SchemaSnapshot& snapshot, const std::vector<std::string>& names,
+                                            SchemaFormat format) {
+    const bool compact = format == SchemaFormat::compact;
+    std::string out;
+    JsonWriter writer(out);
+    if (!compact) writer.begin_array();
+    for (const auto& name : names) {
+        auto index = snapshot.find(name);
+        if (compact) {
+            out += index ? snapshot.table_compact[*index] : name + ": tabla no encontrada\n";
+        } else if (index && format == SchemaFormat::columns) {
+            if (!snapshot.table_columns[*index].empty()) writer.raw(snapshot.table_columns[*index]);
+        } else if (index) {
+            writer.raw(snapshot.table_json[*index]);
+        } else {
+            writer.begin_object();
+            writer.key("table_name");
+            writer.string(name);
+            writer.key("error");
+            writer.string("Tabla no encontrada");
+            writer.end_object();
+        }
+    }
+    if (!compact) writer.end_array();
+    return out;
+}
+
+// Firma barata del catálogo del esquema public: cambia con CREATE/DROP/ALTER de tablas, columnas,
+// índices, particiones, restricciones y comentarios, ya que esas operaciones insertan, borran o
+// reescriben filas de pg_class, pg_attribute y pg_constraint (y COMMENT ON, de pg_description), lo
+// que cambia su xmin. ANALYZE y VACUUM, en cambio, actualizan reltuples en el mismo lugar sin
+// cambiar el xmin, así que la suma de reltuples va aparte para que las filas estimadas se refresquen
+inline const char* const kSchemaSignatureQuery =
+    "SELECT (SELECT count(*)::text || ':' || coalesce(sum(c.xmin::text::bigint), 0)::text"
+    "               || ':' || coalesce(sum(c.reltuples::bigint), 0)::text"
+    "          FROM pg_catalog.pg_class c JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace"
+    "         WHERE n.nspname = 'public')"
+    "    || '/' ||"
+    "       (SELECT count(*)::text || ':' || coalesce(sum(a.xmin::text::bigint), 0)::text"
+    "          FROM pg_catalog.pg_attribute a JOIN pg_catalog.pg_class c ON c.oid = a.attrelid"
+    "          JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace"
+    "         WHERE n.nspname = 'public' AND a.attnum > 0)"
+    "    || '/' ||"
+    "       (SELECT count(*)::text || ':' || coalesce(sum(k.xmin::text::bigint), 0)::text"
+    "          FROM pg_catalog.pg_constraint k JOIN pg_catalog.pg_namespace n ON n.oid = k.connamespace"
+    "         WHERE n.nspname = 'public')"
+    "    || '/' ||"
+    "       (SELECT count(*)::text || ':' || coalesce(sum(d.xmin::text::bigint), 0)::text"
+    "          FROM pg_catalog.pg_description d JOIN pg_catalog.pg_class c ON c.oid = d.objoid"
+    "          JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace"
+    "         WHERE d.classoid = 'pg_catalog.pg_class'::regclass AND n.nspname = 'public')";
+
+// Esquema public completo en una sola consulta al catálogo: una fila por tabla, vista o tabla
+// particionada (las particiones se listan dentro de su tabla padre) con columnas, claves primaria
+// y foráneas, índices y particiones como arreglos JSON, y el comentario de la tabla. Las filas
+// estimadas de una tabla particionada son la suma de sus particiones hoja. Requiere PostgreSQL 12
+// o posterior (pg_partition_tree), ver kSchemaMinServerVersion
+inline constexpr int kSchemaMinServerVersion = 120000;
+inline const char* const kSchemaQuery =
+    "SELECT c.relname,"
+    "       CASE c.relkind WHEN 'r' THEN 'table' WHEN 'p' THEN 'partitioned table' WHEN 'v' THEN 'view'"
+    "                      WHEN 'm' THEN 'materialized view' ELSE 'foreign table' END,"
+    "       CASE c.relkind WHEN 'v' THEN -1"
+    "                      WHEN 'p' THEN coalesce((SELECT sum(p.reltuples) FILTER (WHERE p.reltuples >= 0)"
+    "                                                FROM pg_catalog.pg_partition_tree(c.oid) t"
+    "                                                JOIN pg_catalog.pg_class p ON p.oid = t.relid"
+    "                                               WHERE t.isleaf), -1)"
+    "                      ELSE c.reltuples END::bigint,"
+    "       CASE WHEN c.relkind = 'p' THEN pg_catalog.pg_get_partkeydef(c.oid) END,"
+    "       (SELECT json_agg(json_build_object('name', a.attname,"
+    "                                          'type', pg_catalog.format_type(a.atttypid, a.atttypmod),"
+    "                                          'short_type', t.typname, 'not_null', a.attnotnull,"
+    "                                          'comment', pg_catalog.col_description(a.attrelid, a.attnum))"
+    "                        ORDER BY a.attnum)"
+    "          FROM pg_catalog.pg_attribute a JOIN pg_catalog.pg_type t ON t.oid = a.atttypid"
+    "         WHERE a.attrelid = c.oid AND a.attnum > 0 AND NOT a.attisdropped),"
+    "       (SELECT json_agg(json_build_object("
+    "                   'type', k.contype,"
+    "                   'columns', (SELECT json_agg(a.attname ORDER BY u.ord)"
+    "                                 FROM unnest(k.conkey) WITH ORDINALITY u(attnum, ord)"
+    "                                 JOIN pg_catalog.pg_attribute a ON a.attrelid = k.conrelid AND a.attnum = u.attnum),"
+    "                   'ref_table', f.relname,"
+    "                   'ref_columns', (SELECT json_agg(a.attname ORDER BY u.ord)"
+    "                                     FROM unnest(k.confkey) WITH ORDINALITY u(attnum, ord)"
+    "                                     JOIN pg_catalog.pg_attribute a ON a.attrelid = k.confrelid AND a.attnum = u.attnum))"
+    "                        ORDER BY k.contype DESC, k.conname)"
+    "          FROM pg_catalog.pg_constraint k LEFT JOIN pg_catalog.pg_class f ON f.oid = k.confrelid"
+    "         WHERE k.conrelid = c.oid AND k.contype IN ('p', 'f')),"
+    "       (SELECT json_agg(json_build_object("
+    "                   'name', ic.relname, 'method', am.amname, 'unique', i.indisunique, 'primary', i.indisprimary,"
+    "                   'columns', (SELECT json_agg(pg_catalog.pg_get_indexdef(i.indexrelid, g, true) ORDER BY g)"
+    "                                 FROM generate_series(1, i.indnkeyatts) g),"
+    "                   'predicate', pg_catalog.pg_get_expr(i.indpred, i.indrelid, true))"
+    "                        ORDER BY ic.relname)"
+    "          FROM pg_catalog.pg_index i"
+    "          JOIN pg_catalog.pg_class ic ON ic.oid = i.indexrelid"
+    "          JOIN pg_catalog.pg_am am ON am.oid = ic.relam"
+    "         WHERE i.indrelid = c.oid),"
+    "       (SELECT json_agg(json_build_object('name', p.relname,"
+    "                                          'bound', pg_catalog.pg_get_expr(p.relpartbound, p.oid, true))"
+    "                        ORDER BY p.relname)"
+    "          FROM pg_catalog.pg_inherits h JOIN pg_catalog.pg_class p ON p.oid = h.inhrelid"
+    "         WHERE h.inhparent = c.oid AND c.relkind = 'p'),"
+    "       pg_catalog.obj_description(c.oid, 'pg_class')"
+    "  FROM pg_catalog.pg_class c JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace"
+    " WHERE n.nspname = 'public' AND c.relkind IN ('r', 'p', 'v', 'm', 'f') AND NOT c.relispartition"
+    " ORDER BY c.relname";
+
+// Caché del esquema serializado. Mientras no pase check_interval se devuelve la instantánea en
+// memoria; después se compara la firma del catálogo y solo se recarga si cambió
+class SchemaCache {
+public:
+    using clock = std::chrono::steady_clock;
+    using Loader = std::function<std::shared_ptr<SchemaSnapshot>(pqxx::transaction_base&)>;
+
+    SchemaCache(ConnectionPool& pool, std::chrono::milliseconds check_interval, Loader loader)
+        : pool_(pool), check_interval_(check_interval), loader_(std::move(loader)) {}
+
+    std::shared_ptr<const SchemaSnapshot> get() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (snapshot_ && clock::now() - checked_at_ < check_interval_) return snapshot_;
+        }
+        std::unique_lock<std::mutex> refresh(refresh_mutex_, std::try_to_lock);
+        if (!refresh.owns_lock()) {
+            // Otro hilo ya está verificando: mejor una instantánea algo vieja que esperar
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (snapshot_) return snapshot_;
+            }
+            refresh.lock();
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (snapshot_ && clock::now() - checked_at_ < check_interval_) return snapshot_;
+        }
+
+        std::shared_ptr<const SchemaSnapshot> current;
+        unsigned long long generation;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            current = snapshot_;
+            generation = generation_;
+        }
+        auto conn = pool_.acquire();
+        pqxx::read_transaction txn(*conn);
+        std::string signature = txn.query_value<std::string>(kSchemaSignatureQuery);
+        if (!current || current->signature != signature) {
+            std::shared_ptr<SchemaSnapshot> fresh = loader_(txn);
+            fresh->signature = std::move(signature);
+            current = std::move(fresh);
+        }
+
+        // Si invalidate() llegó durante la verificación, lo leído puede ser anterior a ella: se
+        // devuelve a quien la pidió pero no se publica, y la próxima llamada vuelve a cargar
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation_ == generation) {
+            snapshot_ = current;
+            checked_at_ = clock::now();
+        }
+        return current;
+    }
+
+    // Descartar la instantánea; la próxima llamada recarga el esquema
+    void invalidate() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot_.reset();
+        ++generation_;
+    }
+
+private:
+    ConnectionPool& pool_;
+    const std::chrono::milliseconds check_interval_;
+    const Loader loader_;
+    std::mutex mutex_;
+    std::mutex refresh_mutex_;
+    std::shared_ptr<const SchemaSnapshot> snapshot_;
+    clock::time_point checked_at_;
+    unsigned long long generation_ = 0;  // cuántas veces se llamó a invalidate()
+};
+
+}  // namespace mcp
@@ -0,0 +1,288 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json_writer.hpp"
+
+namespace mcp {
+
+// Codificación del esquema que devuelve get_schema:
+//  - json: un objeto por tabla con columnas, claves, índices, filas estimadas y particiones
+//  - compact: una línea por tabla, p.ej.
+//    `sales(id int4 PK, region text, product_id int4 FK→products.id) ~120000 rows; idx btree(region)`
+//  - columns: la forma que tenía json antes, un objeto {table_name, column_name, data_type} por
+//    columna, para quien ya la consume
+enum class SchemaFormat { json, compact, columns };
+
+inline SchemaFormat parse_schema_format(std::string_view name) {
+    if (name == "json") return SchemaFormat::json;
+    if (name == "compact") return SchemaFormat::compact;
+    if (name == "columns") return SchemaFormat::columns;
+    throw std::runtime_error("Formato de esquema no válido: " + std::string(name));
+}
+
+struct SchemaColumn {
+    std::string name;
+    std::string type;        // tipo completo (format_type): character varying(50), integer[]...
+    std::string short_type;  // nombre corto del tipo (typname): varchar, _int4...
+    bool not_null = false;
+    std::string comment;     // COMMENT ON COLUMN, vacío si no tiene
+};
+
+struct SchemaForeignKey {
+    std::vector<std::string> columns;
+    std::string ref_table;
+    std::vector<std::string> ref_columns;
+};
+
+struct SchemaIndex {
+    std::string name;
+    std::string method;                // btree, hash, gin, gist, brin...
+    std::vector<std::string> columns;  // columnas o expresiones clave
+    bool unique = false;
+    bool primary = false;
+    std::string predicate;             // condición de un índice parcial, vacía si no lo es
+};
+
+struct SchemaPartition {
+    std::string name;
+    std::string bound;  // FOR VALUES ...
+};
+
+struct SchemaTable {
+    std::string name;
+    std::string kind;                  // table, partitioned table, view, materialized view, foreign table
+    long long rows_estimate = -1;      // reltuples; -1 si la tabla nunca se analizó
+    std::vector<SchemaColumn> columns;
+    std::vector<std::string> primary_key;
+    std::vector<SchemaForeignKey> foreign_keys;
+    std::vector<SchemaIndex> indexes;
+    std::string partition_key;         // PARTITION BY ..., vacía si la tabla no está particionada
+    std::vector<SchemaPartition> partitions;
+    std::string comment;               // COMMENT ON TABLE, vacío si no tiene
+};
+
+namespace detail {
+
+// Tipo corto legible: los arreglos llegan como "_int4" y se escriben "int4[]"
+inline void append_short_type(std::string& out, std::string_view type) {
+    if (type.size() > 1 && type.front() == '_') {
+        out.append(type.substr(1));
+        out += "[]";
+    } else {
+        out.append(type);
+    }
+}
+
+inline void append_list(std::string& out, const std::vector<std::string>& items) {
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (i > 0) out += ", ";
+        out.append(items[i]);
+    }
+}
+
+inline void write_string_array(JsonWriter& writer, const std::vector<std::string>& items) {
+    writer.begin_array();
+    for (const auto& item : items) writer.string(item);
+    writer.end_array();
+}
+
+// Particiones listadas en la codificación compacta; del resto solo se indica cuántas hay
+constexpr std::size_t kCompactMaxPartitions = 8;
+
+}  // namespace detail
+
+// Codificación compacta de una tabla: una línea con sus columnas y tipos cortos, las claves de
+// una sola columna junto a la columna y, tras el paréntesis, filas estimadas, claves compuestas,
+// índices (salvo el de la clave primaria) y particiones
+inline void append_table_compact(std::string& out, const SchemaTable& table) {
+    if (table.kind != "table" && table.kind != "partitioned table") {
+        out.append(table.kind);
+        out += ' ';
+    }
+    out.append(table.name);
+    out += '(';
+    for (std::size_t i = 0; i < table.columns.size(); ++i) {
+        const SchemaColumn& column = table.columns[i];
+        if (i > 0) out += ", ";
+        out.append(column.name);
+        out += ' ';
+        detail::append_short_type(out, column.short_type);
+        if (table.primary_key.size() == 1 && table.primary_key[0] == column.name) out += " PK";
+        for (const auto& fk : table.foreign_keys) {
+            if (fk.columns.size() == 1 && fk.columns[0] == column.name) {
+                out += " FK→";
+                out.append(fk.ref_table);
+                out += '.';
+                out.append(fk.ref_columns.empty() ? std::string() : fk.ref_columns[0]);
+            }
+        }
+    }
+    out += ')';
+    if (table.rows_estimate >= 0) {
+        out += " ~";
+        out += std::to_string(table.rows_estimate);
+        out += " rows";
+    }
+    if (table.primary_key.size() > 1) {
+        out += "; PK(";
+        detail::append_list(out, table.primary_key);
+        out += ')';
+    }
+    for (const auto& fk : table.foreign_keys) {
+        if (fk.columns.size() == 1) continue;
+        out += "; FK(";
+        detail::append_list(out, fk.columns);
+        out += ")→";
+        out.append(fk.ref_table);
+        out += '(';
+        detail::append_list(out, fk.ref_columns);
+        out += ')';
+    }
+    bool first_index = true;
+    for (const auto& index : table.indexes) {
+        if (index.primary) continue;
+        out += first_index ? "; idx " : ", ";
+        first_index = false;
+        if (index.unique) out += "unique ";
+        out.append(index.method);
+        out += '(';
+        detail::append_list(out, index.columns);
+        out += ')';
+        if (!index.predicate.empty()) {
+            out += " WHERE ";
+            out.append(index.predicate);
+        }
+    }
+    if (!table.partition_key.empty()) {
+        out += "; PARTITION BY ";
+        out.append(table.partition_key);
+        const std::size_t shown = std::min(table.partitions.size(), detail::kCompactMaxPartitions);
+        for (std::size_t i = 0; i < shown; ++i) {
+            out += i == 0 ? ": " : ", ";
+            out.append(table.partitions[i].name);
+            out += ' ';
+            out.append(table.partitions[i].bound);
+        }
+        if (table.partitions.size() > shown) {
+            out += ", ... (+";
+            out += std::to_string(table.partitions.size() - shown);
+            out += ')';
+        }
+    }
+    out += '\n';
+}
+
+// Codificación columns de una tabla: un objeto por columna, sin el arreglo que los contiene
+inline void write_table_columns(JsonWriter& writer, const SchemaTable& table) {
+    for (const auto& column : table.columns) {
+        writer.begin_object();
+        writer.key("table_name");
+        writer.string(table.name);
+        writer.key("column_name");
+        writer.string(column.name);
+        writer.key("data_type");
+        writer.string(column.type);
+        writer.end_object();
+    }
+}
+
+// Codificación JSON de una tabla: un objeto con sus columnas; los campos vacíos se omiten
+inline void write_table_json(JsonWriter& writer, const SchemaTable& table) {
+    writer.begin_object();
+    writer.key("table_name");
+    writer.string(table.name);
+    writer.key("kind");
+    writer.string(table.kind);
+    if (!table.comment.empty()) {
+        writer.key("comment");
+        writer.string(table.comment);
+    }
+    if (table.rows_estimate >= 0) {
+        writer.key("rows_estimate");
+        writer.number(table.rows_estimate);
+    }
+    writer.key("columns");
+    writer.begin_array();
+    for (const auto& column : table.columns) {
+        writer.begin_object();
+        writer.key("column_name");
+        writer.string(column.name);
+        writer.key("data_type");
+        writer.string(column.type);
+        writer.key("not_null");
+        writer.boolean(column.not_null);
+        if (!column.comment.empty()) {
+            writer.key("comment");
+            writer.string(column.comment);
+        }
+        writer.end_object();
+    }
+    writer.end_array();
+    if (!table.primary_key.empty()) {
+        writer.key("primary_key");
+        detail::write_string_array(writer, table.primary_key);
+    }
+    if (!table.foreign_keys.empty()) {
+        writer.key("foreign_keys");
+        writer.begin_array();
+        for (const auto& fk : table.foreign_keys) {
+            writer.begin_object();
+            writer.key("columns");
+            detail::write_string_array(writer, fk.columns);
+            writer.key("references_table");
+            writer.string(fk.ref_table);
+            writer.key("references_columns");
+            detail::write_string_array(writer, fk.ref_columns);
+            writer.end_object();
+        }
+        writer.end_array();
+    }
+    if (!table.indexes.empty()) {
+        writer.key("indexes");
+        writer.begin_array();
+        for (const auto& index : table.indexes) {
+            writer.begin_object();
+            writer.key("name");
+            writer.string(index.name);
+            writer.key("method");
+            writer.string(index.method);
+            writer.key("columns");
+            detail::write_string_array(writer, index.columns);
+            writer.key("unique");
+            writer.boolean(index.unique);
+            if (index.primary) {
+                writer.key("primary");
+                writer.boolean(true);
+            }
+            if (!index.predicate.empty()) {
+                writer.key("predicate");
+                writer.string(index.predicate);
+            }
+            writer.end_object();
+        }
+        writer.end_array();
+    }
+    if (!table.partition_key.empty()) {
+        writer.key("partition_key");
+        writer.string(table.partition_key);
+        writer.key("partitions");
+        writer.begin_array();
+        for (const auto& partition : table.partitions) {
+            writer.begin_object();
+            writer.key("name");
+            writer.string(partition.name);
+            writer.key("bound");
+            writer.string(partition.bound);
+            writer.end_object();
+        }
+        writer.end_array();
+    }
+    writer.end_object();
+}
+
+}  // namespace mcp
@@ -0,0 +1,381 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "schema_cache.hpp"
+#include "schema_format.hpp"
+
+namespace mcp {
+
+namespace detail {
+
+// Letra ASCII en minúscula o dígito; 0 si el carácter separa palabras
+inline char fold_ascii(unsigned char c) {
+    if (c >= 'a' && c <= 'z') return static_cast<char>(c);
+    if (c >= 'A' && c <= 'Z') return static_cast<char>(c - 'A' + 'a');
+    if (c >= '0' && c <= '9') return static_cast<char>(c);
+    return 0;
+}
+
+// Segundo byte UTF-8 de las letras latinas acentuadas (prefijo 0xC3) a su letra sin acento
+inline char fold_latin1(unsigned char c) {
+    switch (c) {
+        case 0x81: case 0xA1: case 0x80: case 0xA0: case 0x84: case 0xA4: return 'a';
+        case 0x89: case 0xA9: case 0x88: case 0xA8: case 0x8B: case 0xAB: return 'e';
+        case 0x8D: case 0xAD: case 0x8C: case 0xAC: case 0x8F: case 0xAF: return 'i';
+        case 0x93: case 0xB3: case 0x92: case 0xB2: case 0x96: case 0xB6: return 'o';
+        case 0x9A: case 0xBA: case 0x99: case 0xB9: case 0x9C: case 0xBC: return 'u';
+        case 0x91: case 0xB1: return 'n';
+        case 0x87: case 0xA7: return 'c';
+        default: return 0;
+    }
+}
+
+inline bool is_stopword(std::string_view word) {
+    static const std::unordered_map<std::string_view, bool>* words = [] {
+        auto* set = new std::unordered_map<std::string_view, bool>;
+        for (std::string_view w : {
+                 // español
+                 "de", "la", "el", "los", "las", "en", "por", "para", "con", "del", "al", "un", "una", "unos",
+                 "unas", "que", "cual", "cuales", "cuanto", "cuanta", "cuantos", "cuantas", "como", "mas",
+                 "muestra", "muestrame", "dame", "lista", "listar", "ver", "quiero", "mi", "mis", "es", "son",
+                 "cada", "todo", "todos", "todas", "sobre", "desde", "hasta", "entre", "sin", "se", "su", "sus",
+                 "lo", "le", "les", "este", "esta", "estos", "estas", "hay", "tiene", "tienen",
+                 // inglés
+                 "the", "of", "in", "for", "by", "and", "or", "to", "an", "what", "which", "how", "many", "much",
+                 "show", "me", "give", "list", "my", "is", "are", "each", "per", "all", "about", "from", "between",
+                 "with", "without", "this", "that", "these", "those", "there", "has", "have", "do", "does"}) {
+            set->emplace(w, true);
+        }
+        return set;
+    }();
+    return words->count(word) > 0;
+}
+
+// Raíz ligera común al español y al inglés: quita plurales y la vocal final, de modo que
+// venta/ventas/sale/sales -> vent/sal y producto/products -> product
+inline std::string stem(std::string word) {
+    if (word.size() <= 3) return word;
+    auto ends_with = [&word](std::string_view suffix) {
+        return word.size() > suffix.size() && word.compare(word.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    if (word.size() > 4 && ends_with("ies")) {
+        word.replace(word.size() - 3, 3, "y");
+    } else if (ends_with("s") && !ends_with("ss")) {
+        word.pop_back();
+    }
+    if (word.size() > 5 && ends_with("ing")) {
+        word.resize(word.size() - 3);
+    } else if (word.size() > 4 && ends_with("ed")) {
+        word.resize(word.size() - 2);
+    }
+    if (word.size() >= 4) {
+        const char last = word.back();
+        if (last == 'a' || last == 'e' || last == 'o') word.pop_back();
+    }
+    return word;
+}
+
+// Palabras del texto ya normalizadas: minúsculas sin acentos, identificadores separados por
+// '_' y camelCase, sin números sueltos ni palabras vacías, y reducidas a su raíz
+template <typename Fn>
+void for_each_term(std::string_view text, Fn&& fn) {
+    std::string word;
+    bool digits_only = true;
+    auto flush = [&] {
+        if (word.size() >= 2 && !digits_only && !is_stopword(word)) fn(stem(word));
+        word.clear();
+        digits_only = true;
+    };
+    char prev = 0;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        char folded = 0;
+        if (c == 0xC3 && i + 1 < text.size()) {
+            folded = fold_latin1(static_cast<unsigned char>(text[++i]));
+        } else if (c < 0x80) {
+            folded = fold_ascii(c);
+            // camelCase: una mayúscula tras una minúscula empieza palabra nueva
+            if (c >= 'A' && c <= 'Z' && prev >= 'a' && prev <= 'z') flush();
+        }
+        if (!folded) {
+            flush();
+            prev = 0;
+            continue;
+        }
+        const bool digit = folded >= '0' && folded <= '9';
+        if (!word.empty() && digit != (word.back() >= '0' && word.back() <= '9')) flush();
+        if (!digit) digits_only = false;
+        word += folded;
+        prev = c < 0x80 ? static_cast<char>(c) : folded;
+    }
+    flush();
+}
+
+// Sinónimos bilingües frecuentes en esquemas de negocio; cada grupo se indexa por raíz
+inline const std::unordered_map<std::string, std::vector<std::string>>& synonym_stems() {
+    static const auto* table = [] {
+        static const std::vector<std::vector<std::string_view>> groups = {
+            {"venta", "sale", "revenue", "ingreso", "facturacion", "sold", "vendido"},
+            {"cliente", "customer", "client", "comprador", "buyer", "consumidor"},
+            {"producto", "product", "articulo", "item", "sku", "mercancia"},
+            {"precio", "price", "costo", "cost", "importe", "amount", "monto", "valor"},
+            {"fecha", "date", "dia", "day", "time", "timestamp", "momento"},
+            {"region", "zona", "area", "territory", "territorio"},
+            {"categoria", "category", "tipo", "type", "clase", "familia"},
+            {"pedido", "order", "orden", "compra", "purchase"},
+            {"correo", "email", "mail"},
+            {"nombre", "name", "titulo", "title"},
+            {"cantidad", "quantity", "qty", "unidad", "unit"},
+            {"usuario", "user", "cuenta", "account"},
+            {"empleado", "employee", "staff", "trabajador", "vendedor", "seller"},
+            {"proveedor", "supplier", "vendor"},
+            {"pago", "payment", "cobro"},
+            {"factura", "invoice", "recibo", "receipt"},
+            {"direccion", "address", "domicilio"},
+            {"ciudad", "city", "municipio"},
+            {"pais", "country", "nacion"},
+            {"inventario", "inventory", "stock", "existencia", "almacen", "warehouse"},
+            {"descuento", "discount", "promocion", "promotion"},
+            {"mes", "month", "mensual", "monthly"},
+            {"ano", "year", "anual", "yearly"},
+            {"total", "sum", "suma"},
+            {"envio", "shipment", "shipping", "entrega", "delivery"},
+            {"tienda", "store", "shop", "sucursal", "branch"},
+            {"departamento", "department", "area"},
+            {"salario", "salary", "sueldo", "wage"},
+        };
+        auto* out = new std::unordered_map<std::string, std::vector<std::string>>;
+        for (const auto& group : groups) {
+            std::vector<std::string> stems;
+            for (std::string_view word : group) {
+                for_each_term(word, [&stems](std::string term) {
+                    if (std::find(stems.begin(), stems.end(), term) == stems.end()) stems.push_back(std::move(term));
+                });
+            }
+            for (const auto& s : stems) {
+                auto& related = (*out)[s];
+                for (const auto& other : stems) {
+                    if (other != s && std::find(related.begin(), related.end(), other) == related.end()) {
+                        related.push_back(other);
+                    }
+                }
+            }
+        }
+        return out;
+    }();
+    return *table;
+}
+
+}  // namespace detail
+
+// Índice invertido BM25 sobre las tablas del esquema. Cada tabla es un documento con los
+// términos de su nombre (peso 3), su comentario (2), los nombres y comentarios de sus columnas
+// (1) y los nombres de las tablas enlazadas por claves foráneas en cualquier sentido (0.5). Las
+// consultas se amplían con sinónimos en español e inglés (peso 0.6).
+class SchemaSearchIndex {
+public:
+    struct Hit {
+        std::size_t table;  // posición en el vector de tablas con que se construyó
+        double score;
+    };
+
+    // Con `previous`, las tablas cuyo texto indexable no cambió reutilizan sus términos
+    explicit SchemaSearchIndex(const std::vector<SchemaTable>& tables, const SchemaSearchIndex* previous = nullptr) {
+        std::unordered_map<std::string, std::vector<const std::string*>> neighbours;
+        for (const auto& table : tables) {
+            for (const auto& fk : table.foreign_keys) {
+                neighbours[table.name].push_back(&fk.ref_table);
+                neighbours[fk.ref_table].push_back(&table.name);
+            }
+        }
+
+        docs_.reserve(tables.size());
+        double total_length = 0;
+        for (const auto& table : tables) {
+            Document doc;
+            doc.source = source_text(table, neighbours[table.name]);
+            const Document* old = previous ? previous->find(table.name) : nullptr;
+            if (old && old->source == doc.source) {
+                doc.terms = old->terms;
+                doc.length = old->length;
+                ++reused_;
+            } else {
+                build_terms(table, neighbours[table.name], doc);
+            }
+            total_length += doc.length;
+            doc.name = table.name;
+            docs_.push_back(std::move(doc));
+        }
+        avg_length_ = docs_.empty() ? 1.0 : std::max(1.0, total_length / static_cast<double>(docs_.size()));
+
+        for (std::size_t d = 0; d < docs_.size(); ++d) {
+            by_name_.emplace(docs_[d].name, d);
+            for (const auto& [term, tf] : docs_[d].terms) {
+                auto [it, inserted] = vocabulary_.emplace(term, static_cast<std::uint32_t>(postings_.size()));
+                if (inserted) postings_.emplace_back();
+                postings_[it->second].push_back({static_cast<std::uint32_t>(d), tf});
+            }
+        }
+    }
+
+    // Las `k` tablas con mayor puntuación para el texto; vacío si ningún término coincide
+    std::vector<Hit> search(std::string_view query, std::size_t k) const {
+        std::vector<std::pair<std::uint32_t, double>> terms;  // término del vocabulario y peso
+        auto add = [&](const std::string& term, double weight) {
+            auto it = vocabulary_.find(term);
+            if (it == vocabulary_.end()) return;
+            for (auto& existing : terms) {
+                if (existing.first == it->second) {
+                    existing.second = std::max(existing.second, weight);
+                    return;
+                }
+            }
+            terms.push_back({it->second, weight});
+        };
+        const auto& synonyms = detail::synonym_stems();
+        detail::for_each_term(query, [&](const std::string& term) {
+            add(term, 1.0);
+            auto related = synonyms.find(term);
+            if (related == synonyms.end()) return;
+            for (const auto& other : related->second) add(other, kSynonymWeight);
+        });
+
+        std::vector<Hit> hits;
+        if (terms.empty() || k == 0) return hits;
+        std::vector<double> scores(docs_.size(), 0.0);
+        const double n = static_cast<double>(docs_.size());
+        for (const auto& [term, weight] : terms) {
+            const auto& postings = postings_[term];
+            const double df = static_cast<double>(postings.size());
+            const double idf = std::log(1.0 + (n - df + 0.5) / (df + 0.5));
+            for (const auto& posting : postings) {
+                const double tf = posting.tf;
+                const double norm = kK1 * (1.0 - kB + kB * docs_[posting.doc].length / avg_length_);
+                scores[posting.doc] += weight * idf * tf * (kK1 + 1.0) / (tf + norm);
+            }
+        }
+        for (std::size_t d = 0; d < scores.size(); ++d) {
+            if (scores[d] > 0) hits.push_back({d, scores[d]});
+        }
+        const std::size_t top = std::min(k, hits.size());
+        std::partial_sort(hits.begin(), hits.begin() + static_cast<std::ptrdiff_t>(top), hits.end(),
+                          [](const Hit& a, const Hit& b) { return a.score > b.score || (a.score == b.score && a.table < b.table); });
+        hits.resize(top);
+        return hits;
+    }
+
+    std::size_t tables() const { return docs_.size(); }
+    std::size_t terms() const { return vocabulary_.size(); }
+    std::size_t reused() const { return reused_; }
+
+private:
+    static constexpr double kK1 = 1.2;
+    static constexpr double kB = 0.75;
+    static constexpr double kSynonymWeight = 0.6;
+
+    struct Document {
+        std::string name;
+        std::string source;  // texto indexable; si no cambia, los términos se reutilizan
+        std::vector<std::pair<std::string, float>> terms;  // término y frecuencia ponderada
+        double length = 0;
+    };
+
+    struct Posting {
+        std::uint32_t doc;
+        float tf;
+    };
+
+    const Document* find(const std::string& name) const {
+        auto it = by_name_.find(name);
+        return it == by_name_.end() ? nullptr : &docs_[it->second];
+    }
+
+    static std::string source_text(const SchemaTable& table, const std::vector<const std::string*>& neighbours) {
+        std::string source = table.name;
+        source += '\n';
+        source += table.comment;
+        for (const auto& column : table.columns) {
+            source += '\n';
+            source += column.name;
+            source += ' ';
+            source += column.comment;
+        }
+        for (const auto* neighbour : neighbours) {
+            source += "\n>";
+            source += *neighbour;
+        }
+        return source;
+    }
+
+    static void build_terms(const SchemaTable& table, const std::vector<const std::string*>& neighbours, Document& doc) {
+        std::unordered_map<std::string, float> tf;
+        auto add = [&tf, &doc](std::string_view text, float weight) {
+            detail::for_each_term(text, [&](std::string term) {
+                tf[std::move(term)] += weight;
+                doc.length += weight;
+            });
+        };
+        add(table.name, 3.0f);
+        add(table.comment, 2.0f);
+        for (const auto& column : table.columns) {
+            add(column.name, 1.0f);
+            add(column.comment, 1.0f);
+        }
+        for (const auto* neighbour : neighbours) add(*neighbour, 0.5f);
+        doc.terms.assign(tf.begin(), tf.end());
+        std::sort(doc.terms.begin(), doc.terms.end());
+    }
+
+    std::vector<Document> docs_;
+    std::unordered_map<std::string, std::size_t> by_name_;
+    std::unordered_map<std::string, std::uint32_t> vocabulary_;
+    std::vector<std::vector<Posting>> postings_;
+    double avg_length_ = 1.0;
+    std::size_t reused_ = 0;
+};
+
+// Índice de la última instantánea del esquema. Cuando la instantánea cambia se construye uno
+// nuevo a partir del anterior, reutilizando las tablas que no cambiaron
+class SchemaSearchCache {
+public:
+    std::shared_ptr<const SchemaSearchIndex> get(const std::shared_ptr<const SchemaSnapshot>& snapshot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (snapshot != snapshot_ || !index_) {
+            index_ = std::make_shared<const SchemaSearchIndex>(snapshot->tables, index_.get());
+            snapshot_ = snapshot;
+            ++builds_;
+        }
+        return index_;
+    }
+
+    struct Stats {
+        std::size_t builds;  // índices construidos (uno por cada cambio del esquema)
+        std::size_t tables;
+        std::size_t terms;
+        std::size_t reused;  // tablas del último índice tomadas del anterior sin volver a analizarlas
+    };
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!index_) return {builds_, 0, 0, 0};
+        return {builds_, index_->tables(), index_->terms(), index_->reused()};
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::shared_ptr<const SchemaSnapshot> snapshot_;
+    std::shared_ptr<const SchemaSearchIndex> index_;
+    std::size_t builds_ = 0;
+};
+
+}  // namespace mcp
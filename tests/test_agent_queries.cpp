@@ -0,0 +1,358 @@
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "agent_core.hpp"
+#include "test_db.hpp"
+
+using json = nlohmann::json;
+using namespace mcp::agent;
+
+namespace {
+
+// Los límites se leen una sola vez, al primer uso: fijarlos antes de cualquier prueba
+const bool limits_configured = [] {
+    setenv("DB_MAX_ROWS", "10", 1);
+    setenv("DB_MAX_BYTES", "4096", 1);
+    setenv("DB_FETCH_SIZE", "3", 1);
+    setenv("QUERY_CACHE_MAX_BYTES", "0", 1);
+    // Dos conexiones que se agotan pronto: las herramientas de más deben esperar un hilo, no una conexión
+    setenv("DB_POOL_MAX", "2", 1);
+    setenv("DB_POOL_ACQUIRE_TIMEOUT_MS", "400", 1);
+    return true;
+}();
+
+json read_query_call(const std::string& id, const std::string& query) {
+    return {{"id", id}, {"type", "function"},
+            {"function", {{"name", "read_query"}, {"arguments", json({{"query", query}}).dump()}}}};
+}
+
+}  // namespace
+
+TEST(QueryText, StripStatementRemovesTrailingSemicolonsAndSpace) {
+    EXPECT_EQ(strip_statement("SELECT 1 ;\n; "), "SELECT 1");
+    EXPECT_EQ(strip_statement(" ;\n"), "");
+    EXPECT_EQ(strip_statement("SELECT 1; -- fin"), "SELECT 1");
+    EXPECT_EQ(strip_statement("SELECT 1 /* a /* anidado */ b */ ;"), "SELECT 1");
+    EXPECT_EQ(strip_statement("SELECT 1 -- comentario\nFROM t ORDER BY 1 -- fin"), "SELECT 1 -- comentario\nFROM t ORDER BY 1");
+}
+
+TEST(QueryText, ScanStatementSkipsStringsIdentifiersAndDollarQuotes) {
+    EXPECT_EQ(strip_statement("SELECT '--;' AS \"a;--\" -- fin"), "SELECT '--;' AS \"a;--\"");
+    EXPECT_EQ(strip_statement("SELECT E'\\'--' AS x;"), "SELECT E'\\'--' AS x");
+    EXPECT_EQ(strip_statement("SELECT $q$ ; -- $q$, $$;$$, $1;"), "SELECT $q$ ; -- $q$, $$;$$, $1");
+    EXPECT_EQ(strip_statement("SELECT 'sin cerrar; -- x"), "SELECT 'sin cerrar; -- x");
+    EXPECT_EQ(scan_statement("SELECT 1; -- fin").statements, 1u);
+    EXPECT_EQ(scan_statement(";SELECT 1;;\n").statements, 1u);
+    EXPECT_EQ(scan_statement("SELECT 1; SELECT 2").statements, 2u);
+    EXPECT_EQ(scan_statement("SELECT ';'; /* ; */").statements, 1u);
+    EXPECT_EQ(scan_statement("-- nada").statements, 0u);
+}
+
+TEST(ReadQueries, CacheKeysAreSeparateFromReadQuery) {
+    EXPECT_NE(batch_cache_key("SELECT 1"), mcp::normalize_sql("SELECT 1"));
+    EXPECT_EQ(batch_cache_key("SELECT 1"), batch_cache_key("select  1"));
+}
+
+TEST(ReadQueries, RejectsSeveralStatementsWithoutTheDatabase) {
+    json batch = json::parse(read_db_queries({"SELECT 1; SELECT 2", "DELETE FROM sales"}));
+    ASSERT_EQ(batch.size(), 2u);
+    EXPECT_NE(batch[0]["result"]["error"].get<std::string>().find("una sentencia"), std::string::npos);
+    EXPECT_NE(batch[1]["result"]["error"].get<std::string>().find("Solo se permiten consultas SELECT"), std::string::npos);
+}
+
+TEST(SchemaFormat, JsonUnlessTheCallerAsksForCompact) {
+    ASSERT_EQ(std::getenv("SCHEMA_FORMAT"), nullptr);
+    EXPECT_EQ(default_schema_format(), mcp::SchemaFormat::json);
+    EXPECT_EQ(mcp::parse_schema_format("compact"), mcp::SchemaFormat::compact);
+    EXPECT_THROW(mcp::parse_schema_format("yaml"), std::runtime_error);
+    const json format = get_tools(true, false)[0]["function"]["parameters"]["properties"]["format"];
+    EXPECT_EQ(format["enum"][0], "json");
+    EXPECT_EQ(format["enum"][2], "columns");
+}
+
+TEST(SchemaTools, ArgumentsAreCheckedBeforeTouchingTheDatabase) {
+    // Los argumentos llegan como texto JSON, igual que en parse_tool_call
+    auto check = [](const std::string& name, const std::string& args) {
+        check_tool_args({"c1", name, json::parse(args)});
+    };
+    EXPECT_NO_THROW(check("list_tables", "{}"));
+    EXPECT_NO_THROW(check("list_tables", R"({"offset": 200, "limit": 50, "format": "compact"})"));
+    EXPECT_THROW(check("list_tables", "[]"), std::runtime_error);
+    EXPECT_THROW(check("list_tables", R"({"offset": -1})"), std::runtime_error);
+    EXPECT_THROW(check("list_tables", R"({"limit": "10"})"), std::runtime_error);
+    EXPECT_THROW(check("list_tables", R"({"format": "yaml"})"), std::runtime_error);
+    EXPECT_NO_THROW(check("describe_tables", R"({"names": ["sales", "public.customers"]})"));
+    EXPECT_THROW(check("describe_tables", "{}"), std::runtime_error);
+    EXPECT_THROW(check("describe_tables", R"({"names": "sales"})"), std::runtime_error);
+    EXPECT_THROW(check("describe_tables", R"({"names": ["sales", 1]})"), std::runtime_error);
+
+    std::vector<std::string> names;
+    for (const auto& tool : get_tools(true, false)) names.push_back(tool["function"]["name"]);
+    EXPECT_NE(std::find(names.begin(), names.end(), "list_tables"), names.end());
+    EXPECT_NE(std::find(names.begin(), names.end(), "describe_tables"), names.end());
+}
+
+TEST(ReadQuery, RejectsNonSelect) {
+    json error = json::parse(read_db_query("DELETE FROM sales"));
+    ASSERT_TRUE(error.contains("error"));
+    EXPECT_NE(error["error"].get<std::string>().find("Solo se permiten consultas SELECT"), std::string::npos);
+}
+
+TEST(ReadQuery, ReturnsAllRowsUnderTheLimit) {
+    REQUIRE_TEST_DB();
+    ASSERT_TRUE(limits_configured);
+    json rows = json::parse(read_db_query("SELECT n, 'v' || n AS label FROM generate_series(1, 7) AS n ORDER BY n;"));
+    ASSERT_TRUE(rows.is_array()) << rows;
+    ASSERT_EQ(rows.size(), 7u);
+    EXPECT_EQ(rows[6], (json{{"n", 7}, {"label", "v7"}}));
+}
+
+TEST(ReadQuery, TruncatesAtMaxRows) {
+    REQUIRE_TEST_DB();
+    json result = json::parse(read_db_query("SELECT n FROM generate_series(1, 50) AS n"));
+    ASSERT_TRUE(result.is_object()) << result;
+    EXPECT_EQ(result["truncated"], true);
+    EXPECT_EQ(result["row_count"], 10);
+    ASSERT_EQ(result["rows"].size(), 10u);
+    EXPECT_EQ(result["rows"][9]["n"], 10);
+}
+
+TEST(ReadQuery, ExactlyMaxRowsIsNotTruncated) {
+    REQUIRE_TEST_DB();
+    json result = json::parse(read_db_query("SELECT n FROM generate_series(1, 10) AS n"));
+    ASSERT_TRUE(result.is_array()) << result;
+    EXPECT_EQ(result.size(), 10u);
+}
+
+TEST(ReadQuery, TruncatesAtMaxBytes) {
+    REQUIRE_TEST_DB();
+    json result = json::parse(read_db_query("SELECT repeat('x', 1000) AS payload FROM generate_series(1, 10)"));
+    ASSERT_TRUE(result.is_object()) << result;
+    EXPECT_EQ(result["truncated"], true);
+    EXPECT_LT(result["row_count"].get<int>(), 10);
+}
+
+TEST(ReadQuery, WideRowPastMaxBytesIsLeftOut) {
+    REQUIRE_TEST_DB();
+    const std::string raw = read_db_query(
+        "SELECT payload FROM (VALUES (1, 'corta'), (2, repeat('x', 20000))) AS t(n, payload) ORDER BY n");
+    EXPECT_LE(raw.size(), 4096u + 64u);
+    json result = json::parse(raw);
+    ASSERT_TRUE(result.is_object()) << raw;
+    EXPECT_EQ(result["truncated"], true);
+    EXPECT_EQ(result["row_count"], 1);
+    EXPECT_EQ(result["rows"], json::parse(R"([{"payload": "corta"}])"));
+
+    result = json::parse(read_db_query("SELECT repeat('x', 20000) AS payload"));
+    EXPECT_EQ(result["row_count"], 0);
+    EXPECT_EQ(result["rows"], json::array());
+}
+
+TEST(ReadQuery, TrailingCommentDoesNotSwallowTheFetch) {
+    REQUIRE_TEST_DB();
+    json rows = json::parse(read_db_query("SELECT 1 AS one -- comentario final"));
+    ASSERT_TRUE(rows.is_array()) << rows;
+    EXPECT_EQ(rows, json::parse(R"([{"one":1}])"));
+}
+
+TEST(ReadQuery, ReportsSqlErrors) {
+    REQUIRE_TEST_DB();
+    json error = json::parse(read_db_query("SELECT * FROM tabla_que_no_existe"));
+    ASSERT_TRUE(error.contains("error"));
+    EXPECT_NE(error["error"].get<std::string>().find("tabla_que_no_existe"), std::string::npos);
+}
+
+TEST(ToolWorkers, SizedFromThePoolAndBounded) {
+    ASSERT_TRUE(limits_configured);
+    EXPECT_EQ(tool_workers().size(), 2u);
+
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    std::vector<std::future<std::string>> results;
+    for (int i = 0; i < 8; ++i) {
+        results.push_back(run_on_tool_workers([&running, &peak, i] {
+            int now = ++running;
+            int seen = peak.load();
+            while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            --running;
+            return std::to_string(i);
+        }));
+    }
+    for (int i = 0; i < 8; ++i) EXPECT_EQ(results[i].get(), std::to_string(i));
+    EXPECT_LE(peak.load(), 2);
+}
+
+TEST(ToolWorkers, PropagatesExceptions) {
+    auto result = run_on_tool_workers([]() -> std::string { throw std::runtime_error("fallo"); });
+    EXPECT_THROW(result.get(), std::runtime_error);
+}
+
+TEST(RunToolCalls, MoreCallsThanConnectionsDoNotTimeOut) {
+    REQUIRE_TEST_DB();
+    ASSERT_TRUE(limits_configured);
+    // Seis llamadas de 0,3 s con dos conexiones: lanzadas todas a la vez, las dos últimas
+    // esperarían una conexión más de DB_POOL_ACQUIRE_TIMEOUT_MS
+    json tool_calls = json::array();
+    for (int i = 0; i < 6; ++i) {
+        tool_calls.push_back(read_query_call("c" + std::to_string(i), "SELECT pg_sleep(0.3)::text AS s, " + std::to_string(i) + " AS i"));
+    }
+    json messages = json::array();
+    ToolPrefetch prefetch;
+    run_tool_calls(tool_calls, messages, prefetch);
+
+    ASSERT_EQ(messages.size(), 6u);
+    for (int i = 0; i < 6; ++i) {
+        EXPECT_EQ(messages[i]["tool_call_id"], "c" + std::to_string(i));
+        json rows = json::parse(messages[i]["content"].get<std::string>());
+        ASSERT_TRUE(rows.is_array()) << rows.dump();
+        EXPECT_EQ(rows[0]["i"], i);
+    }
+}
+
+namespace {
+
+std::string completion(const json& message) {
+    return json({{"choices", {{{"index", 0}, {"message", message}, {"finish_reason", "stop"}}}}}).dump();
+}
+
+}  // namespace
+
+TEST(DashboardHtml, RendersMetricsNativelyWithoutTheLlm) {
+    LlmFn llm = [](const json&, const json&, const mcp::ToolCallFn&) -> std::string {
+        throw std::runtime_error("no debe llamarse al LLM");
+    };
+    std::string html = generate_html_dashboard(
+        R"({"metrics": [{"metric": "Ventas", "visualization_type": "bar_chart", "data": [[1], {"region": "Norte", "total": 3}]}]})", llm);
+    EXPECT_NE(html.find("<canvas id=\"chart-0\">"), std::string::npos) << html;
+    EXPECT_NE(html.find("Norte"), std::string::npos);
+}
+
+TEST(DashboardHtml, OtherShapesFallBackToTheLlm) {
+    // Datos que escribió el LLM sin la forma {"metrics": [...]}: se le pide el HTML como antes
+    int calls = 0;
+    LlmFn llm = [&calls](const json& messages, const json&, const mcp::ToolCallFn&) -> std::string {
+        ++calls;
+        EXPECT_EQ(messages[1]["content"], R"({"ventas": [1, 2]})");
+        return completion({{"role", "assistant"}, {"content", "```html\n<p>del LLM</p>\n```"}});
+    };
+    EXPECT_EQ(generate_html_dashboard(R"({"ventas": [1, 2]})", llm), "<p>del LLM</p>");
+    EXPECT_EQ(calls, 1);
+
+    LlmFn no_html = [](const json&, const json&, const mcp::ToolCallFn&) -> std::string {
+        return completion({{"role", "assistant"}, {"content", "sin HTML"}});
+    };
+    EXPECT_NE(generate_html_dashboard("[]", no_html).find("No se encontraron datos válidos"), std::string::npos);
+}
+
+TEST(DashboardHtml, MalformedCompletionIsNotAnError) {
+    EXPECT_TRUE(dashboard_data(R"({"choices": ["texto"]})").is_object());
+    EXPECT_TRUE(dashboard_data(R"({"choices": [{"message": "texto"}]})").is_object());
+}
+
+TEST(ToolLoop, RunsToolCallsBeforeParsingTheAnswer) {
+    // Antes run_with_retries devolvía la respuesta con tool_calls y content nulo sin ejecutarlas
+    std::vector<json> seen;
+    LlmFn llm = [&seen](const json& messages, const json&, const mcp::ToolCallFn&) {
+        seen.push_back(messages);
+        if (seen.size() == 1) {
+            json call = read_query_call("c1", "DELETE FROM sales");
+            return completion({{"role", "assistant"}, {"content", nullptr}, {"tool_calls", {call}}});
+        }
+        return completion({{"role", "assistant"}, {"content", "```json\n{\"metrics\": []}\n```"}});
+    };
+    json messages = {{{"role", "user"}, {"content", "hola"}}};
+    std::string result = run_with_retries(with_tool_loop(llm), messages, get_tools(false, true));
+
+    EXPECT_EQ(json::parse(result), json::parse(R"({"metrics": []})"));
+    ASSERT_EQ(seen.size(), 2u);
+    const json& tool_message = seen[1].back();
+    EXPECT_EQ(tool_message["role"], "tool");
+    EXPECT_EQ(tool_message["tool_call_id"], "c1");
+    EXPECT_NE(tool_message["content"].get<std::string>().find("Solo se permiten consultas SELECT"), std::string::npos);
+}
+
+TEST(DashboardData, TheLlmRunsTheMetricQueriesWithReadQueries) {
+    std::vector<json> seen;
+    LlmFn llm = [&seen](const json& messages, const json& tools, const mcp::ToolCallFn&) {
+        seen.push_back(messages);
+        bool offers_read_queries = false;
+        for (const auto& tool : tools) offers_read_queries |= tool["function"]["name"] == "read_queries";
+        EXPECT_TRUE(offers_read_queries) << tools.dump();
+        if (seen.size() == 1) {
+            json call = {{"id", "q1"}, {"type", "function"},
+                         {"function", {{"name", "read_queries"}, {"arguments", R"({"queries": ["DELETE FROM sales"]})"}}}};
+            return completion({{"role", "assistant"}, {"content", nullptr}, {"tool_calls", {call}}});
+        }
+        return completion({{"role", "assistant"}, {"content", "{\"metrics\": []}"}});
+    };
+    std::string data = get_data_from_database(R"({"domain": "sales", "key_metrics": []})", llm);
+
+    EXPECT_EQ(json::parse(data), json::parse(R"({"metrics": []})"));
+    ASSERT_EQ(seen.size(), 2u);
+    EXPECT_EQ(seen[0][1]["content"], R"({"domain": "sales", "key_metrics": []})");
+    const json& tool_message = seen[1].back();
+    EXPECT_EQ(tool_message["role"], "tool");
+    EXPECT_EQ(tool_message["tool_call_id"], "q1");
+    EXPECT_NE(tool_message["content"].get<std::string>().find("Solo se permiten consultas SELECT"), std::string::npos);
+}
+
+TEST(ReadQueries, FailingQueryReportsItsOwnError) {
+    REQUIRE_TEST_DB();
+    json batch = json::parse(read_db_queries({"SELECT 1 AS a", "SELECT 1/0 AS b", "SELECT 2 AS c", "DELETE FROM sales"}));
+    ASSERT_EQ(batch.size(), 4u);
+    EXPECT_EQ(batch[0]["result"], json::parse(R"([{"a": 1}])"));
+    ASSERT_TRUE(batch[1]["result"].contains("error"));
+    EXPECT_NE(batch[1]["result"]["error"].get<std::string>().find("division by zero"), std::string::npos);
+    EXPECT_EQ(batch[2]["result"], json::parse(R"([{"c": 2}])"));
+    EXPECT_NE(batch[3]["result"]["error"].get<std::string>().find("Solo se permiten consultas SELECT"), std::string::npos);
+}
+
+TEST(ReadQueries, KeepsTheOrderAndAcceptsTrailingComments) {
+    REQUIRE_TEST_DB();
+    json batch = json::parse(read_db_queries({
+        "SELECT 1 AS a; -- fin",
+        "SELECT n FROM generate_series(1, 3) AS n ORDER BY n DESC",
+        "SELECT n FROM generate_series(1, 20) AS n",
+    }));
+    ASSERT_EQ(batch.size(), 3u);
+    EXPECT_EQ(batch[0]["result"], json::parse(R"([{"a": 1}])"));
+    EXPECT_EQ(batch[1]["result"], json::parse(R"([{"n": 3}, {"n": 2}, {"n": 1}])"));
+    EXPECT_EQ(batch[2]["result"]["truncated"], true);
+    EXPECT_EQ(batch[2]["result"]["row_count"], 10);
+}
+
+TEST(ToolPrefetch, RunsOnTheToolWorkersAndIsTakenOnce) {
+    ToolPrefetch prefetch;
+    prefetch.start(read_query_call("p1", "DELETE FROM sales"));
+    prefetch.start(read_query_call("p1", "DELETE FROM sales"));  // repetida: se ignora
+    prefetch.start(json::parse(R"({"id": "p2", "function": {"name": "desconocida", "arguments": "{}"}})"));
+
+    EXPECT_FALSE(prefetch.take("p2").valid());
+    std::future<std::string> first = prefetch.take("p1");
+    ASSERT_TRUE(first.valid());
+    EXPECT_NE(first.get().find("Solo se permiten consultas SELECT"), std::string::npos);
+    EXPECT_FALSE(prefetch.take("p1").valid());
+}
+
+TEST(ToolPrefetch, RunToolCallsWaitsForPrefetchedCalls) {
+    ToolPrefetch prefetch;
+    json tool_calls = {read_query_call("a", "DELETE FROM uno"), read_query_call("b", "UPDATE dos SET x = 1")};
+    prefetch.start(tool_calls[1]);
+    json messages = json::array();
+    run_tool_calls(tool_calls, messages, prefetch);
+    ASSERT_EQ(messages.size(), 2u);
+    EXPECT_EQ(messages[0]["tool_call_id"], "a");
+    EXPECT_EQ(messages[1]["tool_call_id"], "b");
+    EXPECT_EQ(messages[1]["name"], "read_query");
+    EXPECT_FALSE(prefetch.take("b").valid());
+}
@@ -0,0 +1,216 @@
+"""Pruebas del servidor HTTP nativo (agent_server) de extremo a extremo.
+
+Se arranca el ejecutable de AGENT_SERVER_BIN (ver tests/CMakeLists.txt) contra un servidor de chat
+completions simulado. Las respuestas del LLM no piden herramientas, así que no hace falta
+PostgreSQL. Se ejecuta desde la raíz del repositorio (config.json).
+"""
+import gzip
+import http.client
+import http.server
+import json
+import os
+import socket
+import subprocess
+import threading
+import time
+import unittest
+
+
+class FakeLlm:
+    """Servidor de chat completions que responde siempre con `reply` tras `delay` segundos."""
+
+    def __init__(self):
+        self.requests = []
+        self.reply = "respuesta simulada"
+        self.delay = 0.0
+        self.lock = threading.Lock()
+        owner = self
+
+        class Handler(http.server.BaseHTTPRequestHandler):
+            def do_POST(self):
+                body = json.loads(self.rfile.read(int(self.headers["Content-Length"])))
+                with owner.lock:
+                    owner.requests.append(body)
+                    reply, delay = owner.reply, owner.delay
+                time.sleep(delay)
+                data = json.dumps({"choices": [{"index": 0, "finish_reason": "stop",
+                                                "message": {"role": "assistant", "content": reply}}]}).encode()
+                self.send_response(200)
+                self.send_header("Content-Type", "application/json")
+                self.send_header("Content-Length", str(len(data)))
+                self.end_headers()
+                self.wfile.write(data)
+
+            def log_message(self, *args):
+                pass
+
+        self.server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+        threading.Thread(target=self.server.serve_forever, daemon=True).start()
+
+    @property
+    def base_url(self):
+        return "http://127.0.0.1:%d/v1" % self.server.server_address[1]
+
+    def count(self):
+        with self.lock:
+            return len(self.requests)
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+class AgentServerTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.llm = FakeLlm()
+        cls.port = free_port()
+        env = dict(os.environ, OPENAI_BASE_URL=cls.llm.base_url, OPENAI_API_KEY="test", OPENAI_MODEL="test-model",
+                   LLM_STREAM="0", LLM_TIMEOUT_S="5", LLM_CACHE_TTL_MS="600000", LLM_CACHE_FILE="",
+                   AGENT_SERVER_HOST="127.0.0.1", AGENT_SERVER_PORT=str(cls.port), AGENT_SERVER_THREADS="4",
+                   AGENT_SERVER_MAX_BODY_BYTES="4096", DB_POOL_MIN="0")
+        # /stats crea el pool de conexiones, que sin conexiones precalentadas solo exige que estén
+        # definidas las variables de la base de datos
+        for name in ("DB_HOST", "DB_USER", "DB_PASSWORD", "DB_NAME"):
+            env.setdefault(name, "prueba")
+        cls.process = subprocess.Popen([os.environ["AGENT_SERVER_BIN"]], env=env, stderr=subprocess.DEVNULL)
+        deadline = time.monotonic() + 10
+        while True:
+            try:
+                if cls.request("GET", "/health")[0] == 200:
+                    break
+            except OSError:
+                pass
+            if time.monotonic() > deadline or cls.process.poll() is not None:
+                cls.process.kill()
+                raise RuntimeError("agent_server no arrancó")
+            time.sleep(0.05)
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.process.terminate()
+        cls.process.wait(10)
+        cls.llm.server.shutdown()
+
+    @classmethod
+    def request(cls, method, path, body=None, headers=None, connection=None):
+        conn = connection or http.client.HTTPConnection("127.0.0.1", cls.port, timeout=10)
+        try:
+            conn.request(method, path, body=body, headers=headers or {})
+            response = conn.getresponse()
+            return response.status, dict(response.getheaders()), response.read()
+        finally:
+            if connection is None:
+                conn.close()
+
+    def post_json(self, path, payload, **kwargs):
+        return self.request("POST", path, json.dumps(payload), {"Content-Type": "application/json"}, **kwargs)
+
+    def test_health(self):
+        status, _, body = self.request("GET", "/health")
+        self.assertEqual(status, 200)
+        self.assertEqual(json.loads(body), {"status": "ok"})
+
+    def test_run_agent_with_json_body(self):
+        status, headers, body = self.post_json("/run_agent", {"message": "hola json", "use_cache": False})
+        self.assertEqual(status, 200)
+        self.assertTrue(headers["Content-Type"].startswith("application/json"))
+        self.assertEqual(json.loads(body), {"result": "respuesta simulada"})
+        with self.llm.lock:
+            self.assertEqual(self.llm.requests[-1]["messages"][-1]["content"], "hola json")
+
+    def test_run_agent_with_plain_text_body(self):
+        status, _, body = self.request("POST", "/run_agent", "hola texto".encode(), {"Content-Type": "text/plain"})
+        self.assertEqual(status, 200)
+        self.assertEqual(json.loads(body)["result"], "respuesta simulada")
+        with self.llm.lock:
+            self.assertEqual(self.llm.requests[-1]["messages"][-1]["content"], "hola texto")
+
+    def test_malformed_requests_are_rejected(self):
+        for body in ["no es json", "[]", "{}", '{"message": 1}', '{"message": ""}',
+                     '{"message": "hola", "use_cache": "si"}']:
+            with self.subTest(body=body):
+                before = self.llm.count()
+                status, _, reply = self.request("POST", "/run_agent", body, {"Content-Type": "application/json"})
+                self.assertEqual(status, 400)
+                self.assertIn("error", json.loads(reply))
+                self.assertEqual(self.llm.count(), before)
+
+    def test_prompt_in_the_url_is_not_accepted(self):
+        status, _, _ = self.request("GET", "/run_agent/hola")
+        self.assertEqual(status, 404)
+
+    def test_body_limit(self):
+        status, _, _ = self.post_json("/run_agent", {"message": "x" * 8192})
+        self.assertEqual(status, 413)
+
+    def test_gzip_when_accepted(self):
+        self.llm.reply = "respuesta larga " * 200
+        try:
+            payload = json.dumps({"message": "hola gzip", "use_cache": False})
+            status, headers, body = self.request("POST", "/run_agent", payload,
+                                                 {"Content-Type": "application/json", "Accept-Encoding": "gzip"})
+            self.assertEqual(status, 200)
+            self.assertEqual(headers.get("Content-Encoding"), "gzip")
+            self.assertEqual(json.loads(gzip.decompress(body))["result"], self.llm.reply)
+
+            status, headers, body = self.post_json("/run_agent", {"message": "hola", "use_cache": False})
+            self.assertNotIn("Content-Encoding", headers)
+            self.assertEqual(json.loads(body)["result"], self.llm.reply)
+        finally:
+            self.llm.reply = "respuesta simulada"
+
+    def test_keep_alive_reuses_the_connection(self):
+        conn = http.client.HTTPConnection("127.0.0.1", self.port, timeout=10)
+        try:
+            self.request("GET", "/health", connection=conn)
+            sock = conn.sock
+            self.assertIsNotNone(sock)
+            for i in range(3):
+                status, _, _ = self.post_json("/run_agent", {"message": "keep %d" % i, "use_cache": False},
+                                              connection=conn)
+                self.assertEqual(status, 200)
+                self.assertIs(conn.sock, sock)
+        finally:
+            conn.close()
+
+    def test_use_cache(self):
+        before = self.llm.count()
+        for _ in range(2):
+            self.assertEqual(self.post_json("/run_agent", {"message": "cacheable"})[0], 200)
+        self.assertEqual(self.llm.count(), before + 1)
+        self.assertEqual(self.post_json("/run_agent", {"message": "cacheable", "use_cache": False})[0], 200)
+        self.assertEqual(self.llm.count(), before + 2)
+
+    def test_requests_run_in_parallel_on_the_worker_threads(self):
+        # Cuatro hilos de trabajo: cuatro peticiones que esperan 0.5 s al LLM terminan juntas
+        self.llm.delay = 0.5
+        results = [None] * 4
+        try:
+            def worker(i):
+                results[i] = self.post_json("/run_agent", {"message": "paralelo %d" % i, "use_cache": False})[0]
+
+            start = time.monotonic()
+            threads = [threading.Thread(target=worker, args=(i,)) for i in range(4)]
+            for t in threads:
+                t.start()
+            for t in threads:
+                t.join(10)
+            elapsed = time.monotonic() - start
+        finally:
+            self.llm.delay = 0.0
+        self.assertEqual(results, [200] * 4)
+        self.assertLess(elapsed, 1.5)
+
+    def test_stats(self):
+        status, _, body = self.request("GET", "/stats")
+        self.assertEqual(status, 200)
+        stats = json.loads(body)
+        self.assertIn("llm_cache", stats)
+        self.assertIn("query_cache", stats)
+
+
+if __name__ == "__main__":
+    unittest.main()
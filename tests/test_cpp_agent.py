@@ -0,0 +1,220 @@
+"""Pruebas del módulo cpp_agent desde Python.
+
+Las variables de entorno del agente se leen una sola vez, al primer uso, así que se fijan aquí
+antes de importar el módulo. El LLM es un servidor de chat completions simulado que corre en un
+hilo de este mismo proceso: si el agente no soltara el GIL durante la petición nativa, el
+servidor no podría responder. Se ejecuta desde la raíz del repositorio (config.json) con el
+directorio del módulo compilado en PYTHONPATH (ver tests/CMakeLists.txt).
+"""
+import asyncio
+import http.server
+import json
+import os
+import subprocess
+import sys
+import threading
+import unittest
+
+
+class FakeLlm:
+    """Servidor de chat completions que responde con las respuestas de `script` en orden."""
+
+    def __init__(self):
+        self.requests = []
+        self.script = []
+        self.lock = threading.Lock()
+        owner = self
+
+        class Handler(http.server.BaseHTTPRequestHandler):
+            def do_POST(self):
+                body = json.loads(self.rfile.read(int(self.headers["Content-Length"])))
+                with owner.lock:
+                    owner.requests.append(body)
+                    reply = owner.script.pop(0) if owner.script else content_reply("respuesta simulada")
+                data = json.dumps(reply).encode()
+                self.send_response(200)
+                self.send_header("Content-Type", "application/json")
+                self.send_header("Content-Length", str(len(data)))
+                self.end_headers()
+                self.wfile.write(data)
+
+            def log_message(self, *args):
+                pass
+
+        self.server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+        self.thread = threading.Thread(target=self.server.serve_forever, daemon=True)
+        self.thread.start()
+
+    @property
+    def base_url(self):
+        return "http://127.0.0.1:%d/v1" % self.server.server_address[1]
+
+
+def content_reply(text):
+    return {"choices": [{"index": 0, "message": {"role": "assistant", "content": text}, "finish_reason": "stop"}]}
+
+
+FAKE_LLM = FakeLlm()
+os.environ.update({
+    "OPENAI_BASE_URL": FAKE_LLM.base_url,
+    "OPENAI_API_KEY": "test",
+    "OPENAI_MODEL": "test-model",
+    "LLM_STREAM": "0",
+    "LLM_TIMEOUT_S": "5",
+})
+
+import cpp_agent  # noqa: E402
+
+
+class GilTest(unittest.TestCase):
+    def test_native_llm_releases_gil(self):
+        # El servidor simulado necesita el GIL para responder mientras run_agent espera
+        result = cpp_agent.run_agent("hola", None, use_cache=False)
+        self.assertEqual(result, "respuesta simulada")
+
+    def test_python_callbacks_from_several_threads(self):
+        calls = []
+
+        def llm(messages, tools):
+            calls.append(threading.get_ident())
+            return json.dumps(content_reply("desde python"))
+
+        results = [None] * 4
+
+        def worker(i):
+            results[i] = cpp_agent.run_agent("hola %d" % i, llm, use_cache=False)
+
+        threads = [threading.Thread(target=worker, args=(i,)) for i in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join(10)
+        self.assertEqual(results, ["desde python"] * 4)
+        self.assertEqual(len(calls), 4)
+
+
+def tool_call_reply(call_id, query):
+    call = {"id": call_id, "type": "function",
+            "function": {"name": "read_query", "arguments": json.dumps({"query": query})}}
+    return {"choices": [{"index": 0, "message": {"role": "assistant", "content": None, "tool_calls": [call]},
+                         "finish_reason": "tool_calls"}]}
+
+
+class HistoryTest(unittest.TestCase):
+    """LLM_HISTORY_MODE se lee cada vez que se adapta el callback, así que basta con os.environ."""
+
+    def run_with_mode(self, mode):
+        # Dos rondas de herramientas antes de responder; las consultas que no son SELECT fallan
+        # sin llegar a la base de datos
+        replies = [tool_call_reply("c1", "DELETE FROM a"), tool_call_reply("c2", "DELETE FROM b"),
+                   content_reply("fin")]
+        seen = []
+
+        def llm(messages, tools):
+            seen.append((messages, list(messages) if isinstance(messages, list) else messages, tools))
+            return json.dumps(replies[len(seen) - 1])
+
+        os.environ["LLM_HISTORY_MODE"] = mode
+        try:
+            result = cpp_agent.run_agent("hola", llm, use_cache=False)
+        finally:
+            del os.environ["LLM_HISTORY_MODE"]
+        self.assertEqual(result, "fin")
+        self.assertEqual(len(seen), 3)
+        return seen
+
+    def test_full_mode_builds_a_new_list_each_call(self):
+        seen = self.run_with_mode("full")
+        self.assertIsNot(seen[0][0], seen[1][0])
+        self.assertEqual([m["role"] for m in seen[2][0][-4:]], ["assistant", "tool", "assistant", "tool"])
+
+    def test_incremental_mode_appends_to_one_list(self):
+        seen = self.run_with_mode("incremental")
+        lists = [entry[0] for entry in seen]
+        self.assertIs(lists[0], lists[1])
+        self.assertIs(lists[1], lists[2])
+        self.assertIs(seen[0][2], seen[2][2])  # las herramientas se convierten una sola vez
+        # Cada llamada vio un prefijo de la conversación final, con los mensajes nuevos al final
+        snapshots = [entry[1] for entry in seen]
+        self.assertEqual(len(snapshots[1]), len(snapshots[0]) + 2)
+        self.assertEqual(snapshots[2][:len(snapshots[1])], snapshots[1])
+        self.assertEqual(snapshots[2][-1]["tool_call_id"], "c2")
+        self.assertIn("Solo se permiten consultas SELECT", snapshots[2][-1]["content"])
+
+    def test_incremental_matches_full(self):
+        full = self.run_with_mode("full")
+        incremental = self.run_with_mode("incremental")
+        self.assertEqual([entry[1] for entry in full], [entry[1] for entry in incremental])
+
+    def test_bytes_mode(self):
+        seen = self.run_with_mode("bytes")
+        full = self.run_with_mode("full")
+        for (messages, _, tools), (expected, _, expected_tools) in zip(seen, full):
+            self.assertIsInstance(messages, bytes)
+            self.assertEqual(json.loads(messages), expected)
+            self.assertEqual(json.loads(tools), expected_tools)
+
+    def test_invalid_mode_raises(self):
+        os.environ["LLM_HISTORY_MODE"] = "otro"
+        try:
+            with self.assertRaises(RuntimeError):
+                cpp_agent.run_agent("hola", lambda messages, tools: "", use_cache=False)
+        finally:
+            del os.environ["LLM_HISTORY_MODE"]
+
+
+class AsyncTest(unittest.TestCase):
+    def test_sync_callback(self):
+        def llm(messages, tools):
+            return json.dumps(content_reply("async con callback"))
+
+        async def main():
+            return await asyncio.wait_for(cpp_agent.run_agent_async("hola", llm, use_cache=False), 10)
+
+        self.assertEqual(asyncio.run(main()), "async con callback")
+
+    def test_coroutine_callback(self):
+        async def llm(messages, tools):
+            await asyncio.sleep(0.01)
+            return json.dumps(content_reply("desde una corrutina"))
+
+        async def main():
+            return await asyncio.wait_for(cpp_agent.run_agent_async("hola", llm, use_cache=False), 10)
+
+        self.assertEqual(asyncio.run(main()), "desde una corrutina")
+
+    def test_native_llm(self):
+        async def main():
+            return await asyncio.wait_for(cpp_agent.run_agent_async("hola", None, use_cache=False), 10)
+
+        self.assertEqual(asyncio.run(main()), "respuesta simulada")
+
+    def test_setup_failure_raises(self):
+        # La caché del LLM no puede abrir su archivo: llm_cache() lanza en el hilo de trabajo
+        # antes de llegar a run_agent, y el awaitable debe fallar en lugar de quedarse colgado.
+        # Un callback de Python solo usa la caché con cache_namespace.
+        # Se ejecuta en otro proceso porque la caché se configura una sola vez por proceso
+        script = """
+import asyncio, cpp_agent
+
+def llm(messages, tools):
+    raise AssertionError("no debe llamarse")
+
+async def main():
+    for agent in (cpp_agent.run_agent_async, cpp_agent.run_dashboard_agent_async):
+        try:
+            await asyncio.wait_for(agent("hola", llm, cache_namespace="prueba"), 10)
+        except RuntimeError as e:
+            assert "LLM" in str(e), str(e)
+        else:
+            raise AssertionError("se esperaba RuntimeError")
+
+asyncio.run(main())
+"""
+        env = dict(os.environ, LLM_CACHE_TTL_MS="600000", LLM_CACHE_FILE="/nonexistent/cpp_agent/llm_cache")
+        proc = subprocess.run([sys.executable, "-c", script], env=env, capture_output=True, text=True, timeout=60)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+
+
+if __name__ == "__main__":
+    unittest.main()
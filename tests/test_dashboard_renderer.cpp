@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+
+#include "dashboard_renderer.hpp"
+
+using ojson = nlohmann::ordered_json;
+
+namespace {
+
+ojson metric(const std::string& type, ojson rows) {
+    return {{"metric", "Métrica " + type}, {"description", "Descripción"}, {"visualization_type", type},
+            {"data", std::move(rows)}};
+}
+
+std::string render_one(const std::string& type, ojson rows) {
+    std::optional<std::string> html = mcp::render_dashboard({{"metrics", ojson::array({metric(type, std::move(rows))})}});
+    return html ? *html : std::string();
+}
+
+bool contains(const std::string& html, const std::string& text) {
+    return html.find(text) != std::string::npos;
+}
+
+// Configuración de Chart.js del primer gráfico del documento
+ojson chart_config(const std::string& html) {
+    const std::string start = "new Chart(document.getElementById('chart-0'), ";
+    std::size_t begin = html.find(start);
+    if (begin == std::string::npos) return ojson();
+    begin += start.size();
+    std::size_t end = html.find(");</script>", begin);
+    return ojson::parse(html.substr(begin, end - begin));
+}
+
+const ojson kSales = ojson::parse(R"([
+    {"region": "Norte", "total_sales": "1200.50", "orders": 10},
+    {"region": "Sur", "total_sales": "800", "orders": 7}
+])");
+
+}  // namespace
+
+TEST(DashboardRenderer, BarChartUsesTheCategoryAndEveryNumericColumn) {
+    ojson config = chart_config(render_one("bar_chart", kSales));
+    ASSERT_TRUE(config.is_object());
+    EXPECT_EQ(config["type"], "bar");
+    EXPECT_EQ(config["data"]["labels"], ojson({"Norte", "Sur"}));
+    ASSERT_EQ(config["data"]["datasets"].size(), 2u);
+    EXPECT_EQ(config["data"]["datasets"][0]["label"], "Total sales");
+    EXPECT_EQ(config["data"]["datasets"][0]["data"], ojson({1200.5, 800.0}));
+}
+
+TEST(DashboardRenderer, TimeSeriesIsSortedByDate) {
+    ojson rows = ojson::parse(R"([{"month": "2024-03-01", "revenue": 3}, {"month": "2024-01-01", "revenue": 1},
+                                  {"month": "2024-02-01", "revenue": 2}])");
+    ojson config = chart_config(render_one("time_series", rows));
+    EXPECT_EQ(config["type"], "line");
+    EXPECT_EQ(config["data"]["labels"], ojson({"2024-01-01", "2024-02-01", "2024-03-01"}));
+    EXPECT_EQ(config["data"]["datasets"][0]["data"], ojson({1.0, 2.0, 3.0}));
+}
+
+TEST(DashboardRenderer, PieChartColorsEachSlice) {
+    ojson config = chart_config(render_one("pie_chart", kSales));
+    EXPECT_EQ(config["type"], "pie");
+    EXPECT_EQ(config["data"]["labels"], ojson({"Norte", "Sur"}));
+    EXPECT_EQ(config["data"]["datasets"][0]["backgroundColor"].size(), 2u);
+}
+
+TEST(DashboardRenderer, ScatterPlotPairsTheFirstTwoNumericColumns) {
+    ojson config = chart_config(render_one("scatter_plot", kSales));
+    EXPECT_EQ(config["type"], "scatter");
+    EXPECT_EQ(config["data"]["datasets"][0]["data"][0], (ojson{{"x", 1200.5}, {"y", 10.0}, {"label", "Norte"}}));
+}
+
+TEST(DashboardRenderer, HeatmapCrossesTwoDimensions) {
+    ojson rows = ojson::parse(R"([{"region": "Norte", "product": "A", "units": 1},
+                                  {"region": "Norte", "product": "B", "units": 5},
+                                  {"region": "Sur", "product": "A", "units": 3}])");
+    std::string html = render_one("heatmap", rows);
+    EXPECT_TRUE(contains(html, "<th class=\"p-2\">A</th><th class=\"p-2\">B</th>"));
+    EXPECT_TRUE(contains(html, "<th class=\"p-2 text-left\">Sur</th>"));
+    EXPECT_TRUE(contains(html, "rgba(33, 150, 243, 1.00)"));  // el máximo
+    EXPECT_FALSE(contains(html, "new Chart"));
+}
+
+TEST(DashboardRenderer, HeatmapScalesColorsOverSummedCells) {
+    // Norte/A se repite: la celda suma 4, que es el mínimo aunque una fila valga 2
+    ojson rows = ojson::parse(R"([{"region": "Norte", "product": "A", "units": 2},
+                                  {"region": "Norte", "product": "A", "units": 2},
+                                  {"region": "Norte", "product": "B", "units": 6},
+                                  {"region": "Sur", "product": "A", "units": 8}])");
+    std::string html = render_one("heatmap", rows);
+    EXPECT_TRUE(contains(html, "rgba(33, 150, 243, 0.10);\">4")) << html;
+    EXPECT_TRUE(contains(html, "rgba(33, 150, 243, 0.55);\">6")) << html;
+    EXPECT_TRUE(contains(html, "rgba(33, 150, 243, 1.00); color: white;\">8")) << html;
+}
+
+TEST(DashboardRenderer, TableEscapesCells) {
+    ojson rows = ojson::parse(R"([{"name": "<b>x</b>", "amount": 2.5}])");
+    std::string html = render_one("table", rows);
+    EXPECT_TRUE(contains(html, "<th class=\"p-2\">Name</th>"));
+    EXPECT_TRUE(contains(html, "&lt;b&gt;x&lt;/b&gt;"));
+    EXPECT_TRUE(contains(html, "<td class=\"p-2 text-right\">2.50</td>"));
+}
+
+TEST(DashboardRenderer, GaugeShowsProgressAgainstTheTarget) {
+    ojson rows = ojson::parse(R"([{"revenue": 750, "target": 1000}])");
+    std::string html = render_one("gauge", rows);
+    EXPECT_TRUE(contains(html, "<div class=\"text-4xl font-bold\">750</div>"));
+    EXPECT_TRUE(contains(html, "75.0% de 1000"));
+    EXPECT_EQ(chart_config(html)["type"], "doughnut");
+}
+
+TEST(DashboardRenderer, FunnelReportsConversionFromTheFirstStage) {
+    ojson rows = ojson::parse(R"([{"stage": "Visitas", "users": 200}, {"stage": "Compras", "users": 50}])");
+    ojson config = chart_config(render_one("funnel", rows));
+    EXPECT_EQ(config["options"]["indexAxis"], "y");
+    EXPECT_EQ(config["data"]["labels"], ojson({"Visitas", "Compras (25.0%)"}));
+}
+
+TEST(DashboardRenderer, UnknownTypeFallsBackToATable) {
+    std::string html = render_one("sankey", kSales);
+    EXPECT_TRUE(contains(html, "<table"));
+    EXPECT_FALSE(contains(html, "new Chart"));
+}
+
+TEST(DashboardRenderer, NonObjectRowsAreSkippedForEveryType) {
+    for (const char* type : {"bar_chart", "time_series", "pie_chart", "scatter_plot", "heatmap", "table", "gauge",
+                             "funnel"}) {
+        ojson rows = ojson::array({ojson::array({"Norte", 1}), 42, nullptr, "texto"});
+        for (const auto& row : kSales) rows.push_back(row);
+        std::string html;
+        ASSERT_NO_THROW(html = render_one(type, rows)) << type;
+        EXPECT_TRUE(contains(html, std::string(type) == "gauge" ? "1200.50" : "Norte")) << type;
+        EXPECT_FALSE(contains(html, "texto")) << type;
+    }
+}
+
+TEST(DashboardRenderer, MetricsWithoutObjectRowsAreDropped) {
+    ojson doc = {{"metrics", ojson::array({metric("bar_chart", ojson::array({1, 2})), metric("table", ojson::array()),
+                                           metric("table", "no es un arreglo"), "no es un objeto"})}};
+    EXPECT_FALSE(mcp::render_dashboard(doc));
+    doc["metrics"].push_back(metric("table", kSales));
+    std::optional<std::string> html = mcp::render_dashboard(doc);
+    ASSERT_TRUE(html);
+    EXPECT_EQ(html->find("Métrica bar_chart"), std::string::npos);
+    EXPECT_NE(html->find("Métrica table"), std::string::npos);
+}
+
+TEST(DashboardRenderer, DocumentsWithoutMetricsAreNotRendered) {
+    EXPECT_FALSE(mcp::render_dashboard(ojson::array()));
+    EXPECT_FALSE(mcp::render_dashboard({{"html", "<p>"}}));
+    EXPECT_FALSE(mcp::render_dashboard({{"metrics", 1}}));
+}
+
+TEST(DashboardRenderer, ScriptJsonCannotCloseTheScriptTag) {
+    ojson rows = ojson::parse(R"j([{"label": "</script><script>alert(1)", "value": 1}])j");
+    std::string html = render_one("bar_chart", rows);
+    EXPECT_FALSE(contains(html, "</script><script>alert"));
+    EXPECT_TRUE(contains(html, R"j(<\/script><script>alert(1))j"));
+}
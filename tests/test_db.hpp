@@ -0,0 +1,21 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <string>
+
+// Conexión a la base de datos de pruebas con las mismas variables que el agente; vacía si falta
+// alguna (por ejemplo, con el docker-compose.yml: DB_HOST=localhost DB_USER=develop1
+// DB_PASSWORD=develop1 DB_NAME=pgmcp)
+inline std::string test_conninfo() {
+    for (const char* var : {"DB_HOST", "DB_USER", "DB_PASSWORD", "DB_NAME"}) {
+        const char* value = std::getenv(var);
+        if (!value || !*value) return "";
+    }
+    return std::string("host=") + std::getenv("DB_HOST") + " user=" + std::getenv("DB_USER") +
+           " password=" + std::getenv("DB_PASSWORD") + " dbname=" + std::getenv("DB_NAME");
+}
+
+#define REQUIRE_TEST_DB()                                                         \
+    do {                                                                          \
+        if (test_conninfo().empty()) GTEST_SKIP() << "DB_* no definidas";        \
+    } while (0)
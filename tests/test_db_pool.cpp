@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <pqxx/pqxx>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db_pool.hpp"
+#include "test_db.hpp"
+
+namespace {
+
+mcp::PoolConfig small_pool(std::size_t min_size, std::size_t max_size) {
+    mcp::PoolConfig config;
+    config.min_size = min_size;
+    config.max_size = max_size;
+    config.acquire_timeout = std::chrono::milliseconds(200);
+    return config;
+}
+
+}  // namespace
+
+TEST(PoolConfig, FromEnvClampsMinToMax) {
+    setenv("DB_POOL_MIN", "5", 1);
+    setenv("DB_POOL_MAX", "2", 1);
+    setenv("DB_POOL_ACQUIRE_TIMEOUT_MS", "750", 1);
+    mcp::PoolConfig config = mcp::PoolConfig::from_env();
+    unsetenv("DB_POOL_MIN");
+    unsetenv("DB_POOL_MAX");
+    unsetenv("DB_POOL_ACQUIRE_TIMEOUT_MS");
+    EXPECT_EQ(config.max_size, 2u);
+    EXPECT_EQ(config.min_size, 2u);
+    EXPECT_EQ(config.acquire_timeout, std::chrono::milliseconds(750));
+}
+
+TEST(PoolConfig, FromEnvDefaults) {
+    mcp::PoolConfig config = mcp::PoolConfig::from_env();
+    EXPECT_EQ(config.min_size, 1u);
+    EXPECT_EQ(config.max_size, 8u);
+}
+
+TEST(ConnectionPool, PrewarmsAndReusesConnections) {
+    REQUIRE_TEST_DB();
+    mcp::ConnectionPool pool(test_conninfo(), small_pool(1, 2));
+    EXPECT_EQ(pool.stats().created, 1u);
+    int first_pid = 0;
+    {
+        auto conn = pool.acquire();
+        first_pid = conn->backendpid();
+        pqxx::nontransaction txn(*conn);
+        EXPECT_EQ(txn.query_value<int>("SELECT 1"), 1);
+    }
+    {
+        auto conn = pool.acquire();
+        EXPECT_EQ(conn->backendpid(), first_pid);
+    }
+    mcp::ConnectionPool::Stats stats = pool.stats();
+    EXPECT_EQ(stats.created, 1u);
+    EXPECT_EQ(stats.reused, 2u);
+    EXPECT_EQ(stats.total, 1u);
+    EXPECT_EQ(stats.idle, 1u);
+}
+
+TEST(ConnectionPool, TimesOutWhenExhausted) {
+    REQUIRE_TEST_DB();
+    mcp::ConnectionPool pool(test_conninfo(), small_pool(0, 1));
+    auto held = pool.acquire();
+    EXPECT_THROW(pool.acquire(), std::runtime_error);
+    EXPECT_EQ(pool.stats().timeouts, 1u);
+}
+
+TEST(ConnectionPool, WaiterGetsReleasedConnection) {
+    REQUIRE_TEST_DB();
+    mcp::PoolConfig config = small_pool(0, 1);
+    config.acquire_timeout = std::chrono::milliseconds(5000);
+    mcp::ConnectionPool pool(test_conninfo(), config);
+    std::thread holder;
+    {
+        auto held = std::make_unique<mcp::PooledConnection>(pool.acquire());
+        holder = std::thread([held = std::move(held)]() mutable {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            held.reset();
+        });
+    }
+    auto conn = pool.acquire();
+    holder.join();
+    EXPECT_EQ(pool.stats().created, 1u);
+    EXPECT_EQ(pool.stats().timeouts, 0u);
+}
+
+TEST(ConnectionPool, DiscardsClosedConnections) {
+    REQUIRE_TEST_DB();
+    mcp::ConnectionPool pool(test_conninfo(), small_pool(0, 2));
+    {
+        auto conn = pool.acquire();
+        conn->close();
+    }
+    mcp::ConnectionPool::Stats stats = pool.stats();
+    EXPECT_EQ(stats.discarded, 1u);
+    EXPECT_EQ(stats.total, 0u);
+    auto conn = pool.acquire();
+    EXPECT_TRUE(conn->is_open());
+    EXPECT_EQ(pool.stats().created, 2u);
+}
+
+TEST(ConnectionPool, ShrinksToMinWithoutFurtherTraffic) {
+    REQUIRE_TEST_DB();
+    mcp::PoolConfig config = small_pool(1, 3);
+    config.idle_timeout = std::chrono::milliseconds(50);
+    mcp::ConnectionPool pool(test_conninfo(), config);
+    {
+        auto a = pool.acquire();
+        auto b = pool.acquire();
+        auto c = pool.acquire();
+    }
+    EXPECT_EQ(pool.stats().created, 3u);
+    // Nadie vuelve a usar el pool: el hilo de limpieza cierra las dos conexiones sobrantes
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (pool.stats().total > 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    const auto stats = pool.stats();
+    EXPECT_EQ(stats.total, 1u);
+    EXPECT_EQ(stats.idle, 1u);
+    EXPECT_EQ(stats.discarded, 2u);
+}
+
+TEST(ConnectionPool, ConcurrentAcquireNeverExceedsMax) {
+    REQUIRE_TEST_DB();
+    mcp::PoolConfig config = small_pool(0, 3);
+    config.acquire_timeout = std::chrono::milliseconds(10000);
+    mcp::ConnectionPool pool(test_conninfo(), config);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 12; ++i) {
+        threads.emplace_back([&pool] {
+            auto conn = pool.acquire();
+            pqxx::nontransaction txn(*conn);
+            txn.exec("SELECT pg_sleep(0.02)");
+        });
+    }
+    for (auto& t : threads) t.join();
+    mcp::ConnectionPool::Stats stats = pool.stats();
+    EXPECT_LE(stats.created, 3u);
+    EXPECT_EQ(stats.timeouts, 0u);
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json_extract.hpp"
+
+namespace {
+
+// Resultado de la expresión regular que find_fenced_block sustituye
+std::optional<std::string> regex_block(const std::string& text, const std::string& lang) {
+    std::smatch match;
+    if (!std::regex_search(text, match, std::regex("```" + lang + "\\s*([\\s\\S]*?)\\s*```"))) return std::nullopt;
+    return match[1].str();
+}
+
+std::optional<std::string> block(const std::string& text, const std::string& lang) {
+    auto found = mcp::find_fenced_block(text, lang);
+    if (!found) return std::nullopt;
+    return std::string(*found);
+}
+
+}  // namespace
+
+TEST(FindFencedBlock, MatchesTheRegex) {
+    const std::vector<std::string> texts = {
+        "```json\n{\"a\": 1}\n```",
+        "Aquí está:\n```json   \n\n  [1, 2]  \n\t```\nFin",
+        "``json no es un bloque`` ```json{\"b\":2}```",
+        "```html\n<p>x</p>\n``` y luego ```json\n{}\n```",
+        "```json\n{\"c\": \"`comillas` invertidas\"}\n```",
+        "```json\n{\"sin\": \"cierre\"}",
+        "```json``` vacío",
+        "sin bloques",
+        "`",
+        "",
+    };
+    for (const std::string& text : texts) {
+        EXPECT_EQ(block(text, "json"), regex_block(text, "json")) << text;
+        EXPECT_EQ(block(text, "html"), regex_block(text, "html")) << text;
+    }
+}
+
+TEST(FindJsonValue, FirstBalancedValue) {
+    auto value = [](std::string_view text) {
+        auto found = mcp::find_json_value(text);
+        return found ? std::optional<std::string>(std::string(*found)) : std::nullopt;
+    };
+    EXPECT_EQ(value("Resultado: {\"a\": [1, {\"b\": 2}]} y {\"c\": 3}"), "{\"a\": [1, {\"b\": 2}]}");
+    EXPECT_EQ(value("[1, 2] {}"), "[1, 2]");
+    // Las llaves dentro de cadenas no cuentan, tampoco con comillas escapadas
+    EXPECT_EQ(value(R"({"s": "} ] \" {", "t": "\\"} fin)"), R"({"s": "} ] \" {", "t": "\\"})");
+    // Las comillas de la prosa anterior no abren una cadena
+    EXPECT_EQ(value("El \"resultado\" es {\"x\": 1}"), "{\"x\": 1}");
+    // Cortado: el fragmento hasta el final
+    EXPECT_EQ(value("{\"a\": [1, 2"), "{\"a\": [1, 2");
+    EXPECT_EQ(value("sin json"), std::nullopt);
+}
+
+TEST(FindJsonValue, StructuralCharactersAtEveryOffset) {
+    // Recorre las posiciones alrededor de los bloques de 16 bytes del camino SSE2
+    for (std::size_t pad = 0; pad < 40; ++pad) {
+        const std::string inner = "{\"k\": \"" + std::string(pad, 'x') + "\\\"}\"}";
+        const std::string text = std::string(pad, ' ') + inner + std::string(pad % 7, 'z') + "}";
+        auto found = mcp::find_json_value(text);
+        ASSERT_TRUE(found) << pad;
+        EXPECT_EQ(std::string(*found), inner) << pad;
+    }
+}
+
+TEST(ExtractJson, PrefersTheFencedBlock) {
+    EXPECT_EQ(mcp::extract_json("{\"antes\": 1}\n```json\n{\"bloque\": 2}\n```"), "{\"bloque\": 2}");
+    EXPECT_EQ(mcp::extract_json("Texto {\"a\": 1} más texto"), "{\"a\": 1}");
+    EXPECT_EQ(mcp::extract_json("Solo prosa"), "{}");
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+
+#include "json_repair.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+// Documento reparado, o null si repair_json no pudo repararlo
+json repaired(const std::string& text) {
+    std::optional<std::string> out = mcp::repair_json(text);
+    if (!out) return nullptr;
+    EXPECT_TRUE(json::accept(*out)) << *out;
+    return json::parse(*out);
+}
+
+}  // namespace
+
+TEST(RepairJson, ValidJsonIsUnchanged) {
+    const std::string doc = R"({"a": [1, -2.5e3, "x\"y\\n", true, null], "b": {"c": "ñ"}})";
+    EXPECT_EQ(repaired(doc), json::parse(doc));
+}
+
+TEST(RepairJson, CommasAndQuotes) {
+    EXPECT_EQ(repaired("{\"a\": 1, \"b\": [1, 2,],}"), json::parse(R"({"a": 1, "b": [1, 2]})"));
+    EXPECT_EQ(repaired("{\"a\": 1 \"b\": 2}"), json::parse(R"({"a": 1, "b": 2})"));
+    EXPECT_EQ(repaired("[1 2 3]"), json::parse("[1, 2, 3]"));
+    EXPECT_EQ(repaired("{\"a\" {\"b\": 1}}"), json::parse(R"({"a": {"b": 1}})"));
+    EXPECT_EQ(repaired("{metric: 'Ventas', visualization_type: 'bar_chart'}"),
+              json::parse(R"({"metric": "Ventas", "visualization_type": "bar_chart"})"));
+    EXPECT_EQ(repaired(R"({'text': 'it\'s "quoted"'})"), json::parse(R"({"text": "it's \"quoted\""})"));
+    EXPECT_EQ(repaired("{\"a\": \"línea\nnueva\ttab\"}"), json::parse(R"({"a": "línea\nnueva\ttab"})"));
+    EXPECT_EQ(repaired(R"({"ruta": "C:\temp\x"})"), json::parse(R"({"ruta": "C:\temp\\x"})"));
+}
+
+TEST(RepairJson, CommentsAndLiterals) {
+    EXPECT_EQ(repaired("{\n  // comentario\n  \"a\": True, # otro\n  \"b\": None, /* bloque */ \"c\": False\n}"),
+              json::parse(R"({"a": true, "b": null, "c": false})"));
+    EXPECT_EQ(repaired("[NaN, Infinity, undefined, texto]"), json::parse(R"([null, null, null, "texto"])"));
+    EXPECT_EQ(repaired("[+1, .5, -.25, 3., 1e]"), json::parse("[1, 0.5, -0.25, 3, 1]"));
+}
+
+TEST(RepairJson, TruncatedInput) {
+    EXPECT_EQ(repaired(R"({"metrics": [{"metric": "Ventas", "data": [{"x": 1}, {"x": 2)"),
+              json::parse(R"({"metrics": [{"metric": "Ventas", "data": [{"x": 1}, {"x": 2}]}]})"));
+    EXPECT_EQ(repaired(R"({"a": "cadena cort)"), json::parse(R"({"a": "cadena cort"})"));
+    EXPECT_EQ(repaired(R"({"a": 1, "b")"), json::parse(R"({"a": 1, "b": null})"));
+    EXPECT_EQ(repaired(R"({"a": 1, "b":)"), json::parse(R"({"a": 1, "b": null})"));
+    EXPECT_EQ(repaired(R"([true, fal)"), json::parse("[true, false]"));
+    EXPECT_EQ(repaired(R"([1.)"), json::parse("[1]"));
+}
+
+TEST(RepairJson, IgnoresTextAfterTheFirstValue) {
+    EXPECT_EQ(repaired("{\"a\": 1}\nEspero que esto ayude. {\"b\": 2}"), json::parse(R"({"a": 1})"));
+}
+
+TEST(RepairJson, RejectsProseAndHopelessInput) {
+    EXPECT_EQ(repaired("No hay datos disponibles."), nullptr);
+    EXPECT_EQ(repaired(""), nullptr);
+    EXPECT_EQ(repaired("   "), nullptr);
+    EXPECT_EQ(repaired("{[1, 2]}"), nullptr);  // un arreglo no puede ser clave
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "json_writer.hpp"
+
+using json = nlohmann::json;
+
+TEST(JsonWriter, NestedDocumentMatchesNlohmann) {
+    std::string out;
+    mcp::JsonWriter writer(out);
+    writer.begin_object();
+    writer.key("rows");
+    writer.begin_array();
+    for (int i = 0; i < 3; ++i) {
+        writer.begin_object();
+        writer.key("id");
+        writer.number(static_cast<long long>(i));
+        writer.key("name");
+        writer.string("fila " + std::to_string(i));
+        writer.key("active");
+        writer.boolean(i % 2 == 0);
+        writer.key("note");
+        writer.null();
+        writer.end_object();
+    }
+    writer.end_array();
+    writer.key("empty");
+    writer.begin_array();
+    writer.end_array();
+    writer.key("nested");
+    writer.begin_object();
+    writer.end_object();
+    writer.end_object();
+
+    json expected = {
+        {"rows", {
+            {{"id", 0}, {"name", "fila 0"}, {"active", true}, {"note", nullptr}},
+            {{"id", 1}, {"name", "fila 1"}, {"active", false}, {"note", nullptr}},
+            {{"id", 2}, {"name", "fila 2"}, {"active", true}, {"note", nullptr}},
+        }},
+        {"empty", json::array()},
+        {"nested", json::object()},
+    };
+    EXPECT_EQ(json::parse(out), expected);
+}
+
+TEST(JsonWriter, EscapesControlCharactersQuotesAndBackslashes) {
+    const std::string tricky = std::string("a\"b\\c\nd\re\tf\bg\fh") + '\x01' + '\x1f' + "ñ€";
+    std::string out;
+    mcp::JsonWriter writer(out);
+    writer.begin_object();
+    writer.key(tricky);
+    writer.string(tricky);
+    writer.end_object();
+    EXPECT_EQ(out, (json{{tricky, tricky}}.dump()));
+    EXPECT_EQ(json::parse(out)[tricky], tricky);
+}
+
+TEST(JsonWriter, NumbersRoundTrip) {
+    std::string out;
+    mcp::JsonWriter writer(out);
+    writer.begin_array();
+    writer.number(std::numeric_limits<long long>::min());
+    writer.number(std::numeric_limits<long long>::max());
+    writer.number(0.1);
+    writer.number(2.0);
+    writer.number(1e300);
+    writer.number(-3.5e-12);
+    writer.number(std::nan(""));
+    writer.number(std::numeric_limits<double>::infinity());
+    writer.end_array();
+    EXPECT_EQ(out, "[-9223372036854775808,9223372036854775807,0.1,2.0,1e+300,-3.5e-12,null,null]");
+    json parsed = json::parse(out);
+    EXPECT_EQ(parsed[2].get<double>(), 0.1);
+    EXPECT_TRUE(parsed[3].is_number_float());
+}
+
+TEST(JsonWriter, RawValuesAndPrecomputedKeys) {
+    const std::string key = mcp::quoted_key("to\"tal");
+    EXPECT_EQ(key, "\"to\\\"tal\":");
+    std::string out;
+    mcp::JsonWriter writer(out);
+    writer.begin_array();
+    writer.begin_object();
+    writer.raw_key(key);
+    writer.raw("{\"a\":[1,2]}");
+    writer.raw_key(mcp::quoted_key("n"));
+    writer.raw("12345678901234567890.5");
+    writer.end_object();
+    writer.raw("true");
+    writer.end_array();
+    EXPECT_EQ(out, "[{\"to\\\"tal\":{\"a\":[1,2]},\"n\":12345678901234567890.5},true]");
+}
+
+TEST(JsonWriter, AppendsToExistingBuffer) {
+    std::string out = "prefijo:";
+    mcp::JsonWriter writer(out);
+    writer.begin_array();
+    writer.string("x");
+    writer.end_array();
+    EXPECT_EQ(out, "prefijo:[\"x\"]");
+    EXPECT_EQ(&writer.buffer(), &out);
+}
@@ -0,0 +1,299 @@
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llm_cache.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Archivo de caché nuevo en un directorio temporal propio de cada prueba
+class LlmDiskStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char dir[] = "/tmp/llm_cache_testXXXXXX";
+        ASSERT_NE(::mkdtemp(dir), nullptr);
+        dir_ = dir;
+        path_ = dir_ + "/cache";
+    }
+
+    void TearDown() override {
+        std::string command = "rm -rf '" + dir_ + "'";
+        ASSERT_EQ(std::system(command.c_str()), 0);
+    }
+
+    std::size_t file_size() const {
+        struct stat st {};
+        return ::stat(path_.c_str(), &st) == 0 ? static_cast<std::size_t>(st.st_size) : 0;
+    }
+
+    // Añadir bytes al archivo como lo haría otro proceso
+    void append_raw(const std::string& bytes) const {
+        int fd = ::open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(::write(fd, bytes.data(), bytes.size()), static_cast<ssize_t>(bytes.size()));
+        ::close(fd);
+    }
+
+    std::string dir_;
+    std::string path_;
+};
+
+std::string key(const std::string& text) {
+    return mcp::ContentHash().update(text).hex();
+}
+
+std::string value_for(const std::string& text) {
+    return "respuesta de " + text + std::string(text.size() % 50, '.');
+}
+
+std::string get_value(mcp::LlmDiskStore& store, const std::string& text) {
+    auto found = store.get(key(text));
+    return found ? found->first : std::string("<nada>");
+}
+
+}  // namespace
+
+TEST(ContentHash, IsStableAndSensitiveToEveryByte) {
+    EXPECT_EQ(key("abc"), key("abc"));
+    EXPECT_EQ(key("abc").size(), 32u);
+    EXPECT_NE(key("abc"), key("abd"));
+    EXPECT_EQ(mcp::ContentHash().update("a").update("bc").hex(), key("abc"));
+}
+
+TEST_F(LlmDiskStoreTest, PersistsAcrossInstances) {
+    {
+        mcp::LlmDiskStore store(path_, 1 << 20);
+        store.put(key("a"), "uno", 60s);
+        store.put(key("b"), "dos", 60s);
+        store.put(key("a"), "uno bis", 60s);
+        EXPECT_EQ(get_value(store, "a"), "uno bis");
+    }
+    mcp::LlmDiskStore reopened(path_, 1 << 20);
+    EXPECT_EQ(get_value(reopened, "a"), "uno bis");
+    EXPECT_EQ(get_value(reopened, "b"), "dos");
+    auto found = reopened.get(key("b"));
+    ASSERT_TRUE(found);
+    EXPECT_GT(found->second, 50s);
+    EXPECT_EQ(reopened.stats().entries, 2u);
+}
+
+TEST_F(LlmDiskStoreTest, ExpiredEntriesAreNotReturned) {
+    mcp::LlmDiskStore store(path_, 1 << 20);
+    store.put(key("a"), "uno", 30ms);
+    std::this_thread::sleep_for(60ms);
+    EXPECT_FALSE(store.get(key("a")));
+}
+
+TEST_F(LlmDiskStoreTest, SharedBetweenInstancesOfTheSameFile) {
+    mcp::LlmDiskStore first(path_, 1 << 20);
+    mcp::LlmDiskStore second(path_, 1 << 20);
+    first.put(key("a"), "uno", 60s);
+    EXPECT_EQ(get_value(second, "a"), "uno");
+}
+
+TEST_F(LlmDiskStoreTest, OversizeValuesAreRejectedUpFront) {
+    mcp::LlmDiskStore store(path_, 4096);
+    const std::size_t before = file_size();
+    store.put(key("grande"), std::string(3000, 'x'), 60s);
+    EXPECT_FALSE(store.get(key("grande")));
+    EXPECT_EQ(file_size(), before);
+}
+
+TEST_F(LlmDiskStoreTest, CompactionKeepsTheNewestEntriesWithinHalfTheLimit) {
+    mcp::LlmDiskStore store(path_, 8192);
+    for (int i = 0; i < 100; ++i) {
+        store.put(key(std::to_string(i)), std::string(200, 'a' + i % 26), 60s);
+        EXPECT_LE(file_size(), 8192u + 300u);
+    }
+    EXPECT_EQ(get_value(store, "99"), std::string(200, 'a' + 99 % 26));
+    EXPECT_FALSE(store.get(key("0")));
+}
+
+TEST_F(LlmDiskStoreTest, RepeatedCompactionsKeepTheNewestEntries) {
+    // Tras una compactación con entradas pequeñas, una grande y otras ya caducadas fuerzan otra
+    // que solo deja sitio a parte de las pequeñas: deben ser las más recientes
+    mcp::LlmDiskStore store(path_, 8192);
+    int last_small = 0;
+    for (; last_small < 200; ++last_small) {
+        store.put(key(std::to_string(last_small)), value_for(std::to_string(last_small)), 60s);
+        if (store.stats().entries < static_cast<std::size_t>(last_small) + 1) break;  // compactó
+    }
+    ASSERT_LT(last_small, 200);
+    const std::size_t kept = store.stats().entries;
+    store.put(key("grande"), std::string(2000, 'g'), 60s);
+    for (int i = 0; i < 200 && store.stats().entries > kept; ++i) {
+        std::this_thread::sleep_for(2ms);
+        store.put(key("caduca " + std::to_string(i)), "x", 1ms);
+    }
+
+    mcp::LlmDiskStore reopened(path_, 8192);
+    ASSERT_LT(reopened.stats().entries, kept);
+    EXPECT_EQ(get_value(reopened, "grande"), std::string(2000, 'g'));
+    const std::string newest = std::to_string(last_small);
+    EXPECT_EQ(get_value(reopened, newest), value_for(newest));
+}
+
+TEST_F(LlmDiskStoreTest, WritesAfterAnotherInstanceReplacedTheFileAreVisible) {
+    // `second` reemplaza el archivo (clear usa rename): `first` debe detectarlo al bloquear y
+    // escribir en el archivo nuevo, no en el que quedó desenlazado
+    mcp::LlmDiskStore first(path_, 1 << 20);
+    mcp::LlmDiskStore second(path_, 1 << 20);
+    first.put(key("a"), "uno", 60s);
+    second.clear();
+    first.put(key("b"), "dos", 60s);
+    mcp::LlmDiskStore third(path_, 1 << 20);
+    EXPECT_EQ(get_value(third, "b"), "dos");
+    EXPECT_EQ(get_value(second, "b"), "dos");
+}
+
+TEST_F(LlmDiskStoreTest, TornTailIsTruncatedWhenOpening) {
+    {
+        mcp::LlmDiskStore store(path_, 1 << 20);
+        store.put(key("a"), "uno", 60s);
+    }
+    const std::size_t valid = file_size();
+    append_raw(std::string("MLPR\x10\0\0\0", 8));  // cabecera cortada de un proceso que murió
+    mcp::LlmDiskStore store(path_, 1 << 20);
+    EXPECT_EQ(file_size(), valid);
+    store.put(key("b"), "dos", 60s);
+    mcp::LlmDiskStore other(path_, 1 << 20);
+    EXPECT_EQ(get_value(other, "a"), "uno");
+    EXPECT_EQ(get_value(other, "b"), "dos");
+}
+
+TEST_F(LlmDiskStoreTest, ForeignFileIsStartedFromScratch) {
+    append_raw("esto no es una caché");
+    mcp::LlmDiskStore store(path_, 1 << 20);
+    store.put(key("a"), "uno", 60s);
+    mcp::LlmDiskStore other(path_, 1 << 20);
+    EXPECT_EQ(get_value(other, "a"), "uno");
+}
+
+TEST_F(LlmDiskStoreTest, InFlightAppendIsNotMistakenForATornTail) {
+    {
+        mcp::LlmDiskStore store(path_, 1 << 20);
+        store.put(key("a"), "uno", 60s);
+    }
+    // Otro "proceso" escribe un registro en dos partes con el bloqueo exclusivo tomado
+    mcp::LlmDiskStore writer_source(path_, 1 << 20);
+    std::string partial_dir = dir_ + "/registro";
+    {
+        mcp::LlmDiskStore scratch(partial_dir, 1 << 20);
+        scratch.put(key("b"), "dos", 60s);
+    }
+    std::string record;
+    {
+        int fd = ::open(partial_dir.c_str(), O_RDONLY);
+        ASSERT_GE(fd, 0);
+        struct stat st {};
+        ::fstat(fd, &st);
+        record.resize(static_cast<std::size_t>(st.st_size) - 8);
+        ASSERT_EQ(::pread(fd, &record[0], record.size(), 8), static_cast<ssize_t>(record.size()));
+        ::close(fd);
+    }
+    int fd = ::open(path_.c_str(), O_WRONLY | O_APPEND);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::flock(fd, LOCK_EX), 0);
+    ASSERT_EQ(::write(fd, record.data(), 10), 10);
+
+    std::atomic<bool> opened{false};
+    std::thread opener([&] {
+        mcp::LlmDiskStore store(path_, 1 << 20);
+        opened = true;
+        EXPECT_EQ(get_value(store, "a"), "uno");
+        EXPECT_EQ(get_value(store, "b"), "dos");
+    });
+    std::this_thread::sleep_for(100ms);
+    EXPECT_FALSE(opened);  // espera al escritor en lugar de recortar su registro
+    ASSERT_EQ(::write(fd, record.data() + 10, record.size() - 10), static_cast<ssize_t>(record.size() - 10));
+    ::flock(fd, LOCK_UN);
+    ::close(fd);
+    opener.join();
+    EXPECT_EQ(get_value(writer_source, "b"), "dos");
+}
+
+TEST_F(LlmDiskStoreTest, ConcurrentProcessesWithCompaction) {
+    // Varios procesos escriben a la vez con un límite que obliga a compactar a menudo. Una
+    // entrada puede desalojarse antes de leerla si los demás escriben mucho entretanto, así que
+    // solo se exige que todo lo leído sea el valor de su clave y que el archivo siga acotado
+    { mcp::LlmDiskStore init(path_, 16384); }
+    std::vector<pid_t> children;
+    for (int p = 0; p < 4; ++p) {
+        pid_t pid = ::fork();
+        ASSERT_GE(pid, 0);
+        if (pid == 0) {
+            int failures = 0;
+            {
+                mcp::LlmDiskStore store(path_, 16384);
+                for (int i = 0; i < 150; ++i) {
+                    const std::string text = std::to_string(p) + "-" + std::to_string(i);
+                    store.put(key(text), value_for(text), 60s);
+                    for (const std::string& other : {text, std::to_string((p + 1) % 4) + "-" + std::to_string(i)}) {
+                        auto found = store.get(key(other));
+                        if (found && found->first != value_for(other)) ++failures;
+                    }
+                }
+            }
+            ::_exit(failures == 0 ? 0 : 1);
+        }
+        children.push_back(pid);
+    }
+    for (pid_t pid : children) {
+        int status = 0;
+        ASSERT_EQ(::waitpid(pid, &status, 0), pid);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << "proceso " << pid;
+    }
+    EXPECT_LE(file_size(), 16384u + 1024u);
+    mcp::LlmDiskStore store(path_, 16384);
+    std::size_t found = 0;
+    for (int p = 0; p < 4; ++p) {
+        for (int i = 0; i < 150; ++i) {
+            const std::string text = std::to_string(p) + "-" + std::to_string(i);
+            if (auto hit = store.get(key(text))) {
+                EXPECT_EQ(hit->first, value_for(text));
+                ++found;
+            }
+        }
+    }
+    EXPECT_GT(found, 0u);
+    EXPECT_EQ(found, store.stats().entries);
+}
+
+TEST(LlmCache, DisabledWithoutTtl) {
+    mcp::LlmCache cache(1 << 20, 0ms, "", 0);
+    EXPECT_FALSE(cache.enabled());
+    cache.put(key("a"), "uno");
+    EXPECT_EQ(cache.get(key("a")), nullptr);
+}
+
+TEST_F(LlmDiskStoreTest, CacheFallsBackToDisk) {
+    {
+        mcp::LlmCache cache(1 << 20, 60s, path_, 1 << 20);
+        ASSERT_TRUE(cache.enabled());
+        cache.put(key("a"), "uno");
+    }
+    mcp::LlmCache cache(1 << 20, 60s, path_, 1 << 20);
+    auto hit = cache.get(key("a"));
+    ASSERT_NE(hit, nullptr);
+    EXPECT_EQ(*hit, "uno");
+    EXPECT_EQ(cache.stats().disk.hits, 1u);
+    EXPECT_EQ(cache.stats().memory.entries, 1u);
+}
+
+TEST(LlmCache, UnopenableFileThrows) {
+    EXPECT_THROW(mcp::LlmCache(1 << 20, 60s, "/nonexistent/dir/cache", 1 << 20), std::runtime_error);
+}
@@ -0,0 +1,288 @@
+#include <gtest/gtest.h>
+#include <httplib/httplib.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llm_client.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+// Servidor de chat completions local; handler decide la respuesta de cada petición
+class StubServer {
+public:
+    explicit StubServer(httplib::Server::Handler handler) {
+        server_.Post("/v1/chat/completions", [this, handler](const httplib::Request& req, httplib::Response& res) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                requests_.push_back(req);
+            }
+            handler(req, res);
+        });
+        port_ = server_.bind_to_any_port("127.0.0.1");
+        thread_ = std::thread([this] { server_.listen_after_bind(); });
+        server_.wait_until_ready();
+    }
+
+    ~StubServer() {
+        server_.stop();
+        thread_.join();
+    }
+
+    mcp::LlmConfig config(bool stream = false) const {
+        mcp::LlmConfig config;
+        config.host = "http://127.0.0.1:" + std::to_string(port_);
+        config.path = "/v1/chat/completions";
+        config.api_key = "clave";
+        config.model = "modelo";
+        config.timeout_s = 5;
+        config.stream = stream;
+        return config;
+    }
+
+    std::vector<httplib::Request> requests() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return requests_;
+    }
+
+private:
+    httplib::Server server_;
+    std::thread thread_;
+    int port_ = 0;
+    std::mutex mutex_;
+    std::vector<httplib::Request> requests_;
+};
+
+const json kMessages = {{{"role", "user"}, {"content", "hola"}}};
+
+void clear_llm_env() {
+    for (const char* name : {"AZURE_OPENAI_ENDPOINT", "AZURE_OPENAI_API_KEY", "AZURE_OPENAI_DEPLOYMENT",
+                             "AZURE_OPENAI_API_VERSION", "OPENAI_BASE_URL", "OPENAI_API_KEY", "OPENAI_MODEL",
+                             "LLM_TIMEOUT_S", "LLM_STREAM"}) {
+        unsetenv(name);
+    }
+}
+
+}  // namespace
+
+TEST(LlmConfig, OpenAiFromEnv) {
+    clear_llm_env();
+    setenv("OPENAI_BASE_URL", "http://localhost:8080/v1/", 1);
+    setenv("OPENAI_API_KEY", "k", 1);
+    setenv("LLM_STREAM", "0", 1);
+    mcp::LlmConfig config = mcp::LlmConfig::from_env();
+    EXPECT_FALSE(config.azure);
+    EXPECT_EQ(config.host, "http://localhost:8080");
+    EXPECT_EQ(config.path, "/v1/chat/completions");
+    EXPECT_EQ(config.model, "gpt-4o");
+    EXPECT_FALSE(config.stream);
+    EXPECT_EQ(config.timeout_s, 120);
+}
+
+TEST(LlmConfig, AzureFromEnv) {
+    clear_llm_env();
+    setenv("AZURE_OPENAI_ENDPOINT", "https://recurso.openai.azure.com", 1);
+    setenv("AZURE_OPENAI_API_KEY", "k", 1);
+    setenv("AZURE_OPENAI_DEPLOYMENT", "despliegue", 1);
+    mcp::LlmConfig config = mcp::LlmConfig::from_env();
+    EXPECT_TRUE(config.azure);
+    EXPECT_EQ(config.host, "https://recurso.openai.azure.com");
+    EXPECT_EQ(config.path, "/openai/deployments/despliegue/chat/completions?api-version=2024-02-15-preview");
+    EXPECT_TRUE(config.stream);
+    clear_llm_env();
+}
+
+TEST(LlmClient, RequiresAnApiKey) {
+    mcp::LlmConfig config;
+    EXPECT_THROW(mcp::LlmClient client(config), std::runtime_error);
+}
+
+TEST(LlmClient, RequestBodyDropsUnknownFieldsAndEmptyToolCalls) {
+    mcp::LlmConfig config;
+    config.api_key = "k";
+    config.model = "modelo";
+    mcp::LlmClient client(config);
+    json messages = json::parse(R"([
+        {"role": "assistant", "content": "a", "tool_calls": [], "refusal": null, "annotations": []},
+        {"role": "tool", "tool_call_id": "c1", "name": "read_query", "content": "[]"},
+        {"role": "assistant", "tool_calls": [{"id": "c2"}]}])");
+    json body = json::parse(client.request_body(messages, json::array()));
+    EXPECT_EQ(body["model"], "modelo");
+    EXPECT_FALSE(body.contains("tools"));
+    EXPECT_FALSE(body.contains("stream"));
+    EXPECT_EQ(body["messages"][0], json::parse(R"({"role": "assistant", "content": "a"})"));
+    EXPECT_EQ(body["messages"][1].size(), 4u);
+    EXPECT_EQ(body["messages"][2], json::parse(R"({"role": "assistant", "content": null, "tool_calls": [{"id": "c2"}]})"));
+
+    json with_tools = json::parse(client.request_body(kMessages, json::parse(R"([{"type": "function"}])"), true));
+    EXPECT_EQ(with_tools["tool_choice"], "auto");
+    EXPECT_EQ(with_tools["stream"], true);
+}
+
+TEST(LlmClient, ChatReturnsTheResponseBody) {
+    StubServer server([](const httplib::Request&, httplib::Response& res) {
+        res.set_content(R"({"choices": [{"message": {"role": "assistant", "content": "hola"}}]})", "application/json");
+    });
+    mcp::LlmClient client(server.config());
+    for (int i = 0; i < 3; ++i) {
+        json response = json::parse(client.chat(kMessages, json::array()));
+        EXPECT_EQ(response["choices"][0]["message"]["content"], "hola");
+    }
+    auto requests = server.requests();
+    ASSERT_EQ(requests.size(), 3u);
+    EXPECT_EQ(requests[0].get_header_value("Authorization"), "Bearer clave");
+    EXPECT_EQ(json::parse(requests[0].body)["messages"], kMessages);
+}
+
+TEST(LlmClient, AzureSendsTheApiKeyHeader) {
+    StubServer server([](const httplib::Request&, httplib::Response& res) { res.set_content("{}", "application/json"); });
+    mcp::LlmConfig config = server.config();
+    config.azure = true;
+    mcp::LlmClient client(config);
+    client.chat(kMessages, json::array());
+    auto requests = server.requests();
+    ASSERT_EQ(requests.size(), 1u);
+    EXPECT_EQ(requests[0].get_header_value("api-key"), "clave");
+    EXPECT_FALSE(requests[0].has_header("Authorization"));
+    EXPECT_FALSE(json::parse(requests[0].body).contains("model"));
+}
+
+TEST(LlmClient, HttpErrorsBecomeErrorJson) {
+    StubServer server([](const httplib::Request&, httplib::Response& res) {
+        res.status = 429;
+        res.set_content("demasiadas peticiones", "text/plain");
+    });
+    mcp::LlmClient client(server.config());
+    json response = json::parse(client.chat(kMessages, json::array()));
+    EXPECT_EQ(response["error"]["message"], "El LLM respondió con estado 429: demasiadas peticiones");
+}
+
+TEST(LlmClient, ConnectionErrorsBecomeErrorJson) {
+    mcp::LlmConfig config;
+    {
+        StubServer server([](const httplib::Request&, httplib::Response&) {});
+        config = server.config();
+    }
+    mcp::LlmClient client(config);
+    json response = json::parse(client.chat(kMessages, json::array()));
+    EXPECT_EQ(response["error"]["message"].get<std::string>().rfind("Error de conexión con el LLM", 0), 0u);
+}
+
+namespace {
+
+std::string sse(const json& chunk) {
+    return "data: " + chunk.dump() + "\n\n";
+}
+
+json tool_delta(std::size_t index, const json& fields) {
+    json call = fields;
+    call["index"] = index;
+    return {{"choices", {{{"index", 0}, {"delta", {{"tool_calls", {call}}}}}}}};
+}
+
+}  // namespace
+
+TEST(StreamAccumulator, RebuildsContentFromSplitLines) {
+    mcp::StreamAccumulator stream(nullptr);
+    std::string events = ": comentario\n" +
+                         sse({{"choices", json::array()}}) +  // Azure: resultados del filtro, sin choices
+                         sse({{"choices", {{{"delta", {{"role", "assistant"}, {"content", "Ho"}}}}}}}) +
+                         sse({{"choices", {{{"delta", {{"content", "la"}}}, {"finish_reason", "stop"}}}}}) +
+                         "data: [DONE]\r\n\r\n";
+    // Entregar de tres en tres bytes para partir líneas y secuencias UTF-8
+    for (std::size_t i = 0; i < events.size(); i += 3) stream.feed(events.data() + i, std::min<std::size_t>(3, events.size() - i));
+    json response = json::parse(stream.response());
+    EXPECT_EQ(response["choices"][0]["message"], json::parse(R"({"role": "assistant", "content": "Hola"})"));
+    EXPECT_EQ(response["choices"][0]["finish_reason"], "stop");
+    EXPECT_TRUE(stream.error().empty());
+}
+
+TEST(StreamAccumulator, AnnouncesEachToolCallOnceItsArgumentsAreComplete) {
+    std::vector<json> announced;
+    mcp::StreamAccumulator stream([&announced](const json& call) { announced.push_back(call); });
+    auto feed = [&stream](const json& chunk) {
+        std::string line = sse(chunk);
+        stream.feed(line.data(), line.size());
+    };
+    feed(tool_delta(0, {{"id", "c1"}, {"type", "function"}, {"function", {{"name", "read_query"}, {"arguments", ""}}}}));
+    feed(tool_delta(0, {{"function", {{"arguments", "{\"query\": \"SELECT {"}}}}));
+    EXPECT_TRUE(announced.empty());  // la llave dentro de la cadena no cierra el objeto
+    feed(tool_delta(0, {{"function", {{"arguments", "}\"}"}}}}));
+    ASSERT_EQ(announced.size(), 1u);
+    EXPECT_EQ(announced[0]["id"], "c1");
+    EXPECT_EQ(json::parse(announced[0]["function"]["arguments"].get<std::string>())["query"], "SELECT {}");
+
+    // Argumentos sin llave final: se anuncia al empezar la siguiente llamada
+    feed(tool_delta(1, {{"id", "c2"}, {"function", {{"name", "get_schema"}, {"arguments", "{\"format\": \"json\""}}}}));
+    feed(tool_delta(2, {{"id", "c3"}, {"function", {{"name", "list_tables"}, {"arguments", "{}"}}}}));
+    ASSERT_EQ(announced.size(), 3u);
+    EXPECT_EQ(announced[1]["id"], "c2");
+    EXPECT_EQ(announced[2]["id"], "c3");
+
+    feed({{"choices", {{{"delta", json::object()}, {"finish_reason", "tool_calls"}}}}});
+    json message = json::parse(stream.response())["choices"][0]["message"];
+    EXPECT_TRUE(message["content"].is_null());
+    ASSERT_EQ(message["tool_calls"].size(), 3u);
+    EXPECT_EQ(message["tool_calls"][1]["function"]["arguments"], "{\"format\": \"json\"");
+    EXPECT_EQ(announced.size(), 3u);
+}
+
+TEST(StreamAccumulator, ReportsErrorEvents) {
+    mcp::StreamAccumulator stream(nullptr);
+    std::string line = sse({{"error", {{"message", "sin cuota"}}}});
+    stream.feed(line.data(), line.size());
+    EXPECT_EQ(stream.error(), "sin cuota");
+}
+
+TEST(LlmClient, ChatStreamDispatchesToolCallsBeforeTheEnd) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool announced = false;
+    StubServer server([&](const httplib::Request&, httplib::Response& res) {
+        res.set_chunked_content_provider("text/event-stream", [&](std::size_t, httplib::DataSink& sink) {
+            std::string first = sse(tool_delta(0, {{"id", "c1"}, {"function", {{"name", "read_query"}, {"arguments", "{\"query\": \"SELECT 1\"}"}}}}));
+            sink.write(first.data(), first.size());
+            {
+                // El resto de la respuesta solo se envía cuando el cliente ya anunció la llamada
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait_for(lock, std::chrono::seconds(5), [&] { return announced; });
+            }
+            std::string rest = sse({{"choices", {{{"delta", json::object()}, {"finish_reason", "tool_calls"}}}}}) + "data: [DONE]\n\n";
+            sink.write(rest.data(), rest.size());
+            sink.done();
+            return true;
+        });
+    });
+    mcp::LlmClient client(server.config(true));
+    std::string result = client.chat_stream(kMessages, json::array(), [&](const json& call) {
+        EXPECT_EQ(call["id"], "c1");
+        std::lock_guard<std::mutex> lock(mutex);
+        announced = true;
+        cv.notify_all();
+    });
+    EXPECT_TRUE(announced);
+    json response = json::parse(result);
+    EXPECT_EQ(response["choices"][0]["finish_reason"], "tool_calls");
+    auto requests = server.requests();
+    ASSERT_EQ(requests.size(), 1u);
+    EXPECT_EQ(json::parse(requests[0].body)["stream"], true);
+    EXPECT_EQ(requests[0].get_header_value("Accept"), "text/event-stream");
+}
+
+TEST(LlmClient, ChatStreamReportsErrorStatusWithTheBody) {
+    StubServer server([](const httplib::Request&, httplib::Response& res) {
+        res.status = 400;
+        res.set_content(R"({"error": {"message": "modelo desconocido"}})", "application/json");
+    });
+    mcp::LlmClient client(server.config(true));
+    json response = json::parse(client.chat_stream(kMessages, json::array(), nullptr));
+    EXPECT_NE(response["error"]["message"].get<std::string>().find("modelo desconocido"), std::string::npos);
+}
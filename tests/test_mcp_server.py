@@ -0,0 +1,202 @@
+"""Pruebas de conformidad JSON-RPC 2.0 del servidor MCP nativo (mcp_server).
+
+Se arranca el ejecutable de MCP_SERVER_BIN (ver tests/CMakeLists.txt) por HTTP y por stdio. Solo
+se usan métodos que no tocan la base de datos. Se ejecuta desde la raíz del repositorio
+(config.json).
+"""
+import http.client
+import json
+import os
+import socket
+import subprocess
+import time
+import unittest
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def server_env(**extra):
+    env = dict(os.environ, DB_POOL_MIN="0", LLM_CACHE_TTL_MS="0", **extra)
+    for name in ("DB_HOST", "DB_USER", "DB_PASSWORD", "DB_NAME"):
+        env.setdefault(name, "prueba")
+    return env
+
+
+class HttpConformanceTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.port = free_port()
+        env = server_env(MCP_TRANSPORT="http", MCP_HTTP_HOST="127.0.0.1", MCP_HTTP_PORT=str(cls.port))
+        cls.process = subprocess.Popen([os.environ["MCP_SERVER_BIN"]], env=env, stderr=subprocess.DEVNULL)
+        deadline = time.monotonic() + 10
+        while True:
+            try:
+                if cls.post('{"jsonrpc": "2.0", "id": 0, "method": "ping"}')[0] == 200:
+                    break
+            except OSError:
+                pass
+            if time.monotonic() > deadline or cls.process.poll() is not None:
+                cls.process.kill()
+                raise RuntimeError("mcp_server no arrancó")
+            time.sleep(0.05)
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.process.terminate()
+        cls.process.wait(10)
+
+    @classmethod
+    def post(cls, body, headers=None, method="POST"):
+        conn = http.client.HTTPConnection("127.0.0.1", cls.port, timeout=10)
+        try:
+            conn.request(method, "/mcp", body=body if isinstance(body, (bytes, str)) else json.dumps(body),
+                         headers=dict({"Content-Type": "application/json"}, **(headers or {})))
+            response = conn.getresponse()
+            return response.status, response.read()
+        finally:
+            conn.close()
+
+    def call(self, body):
+        status, reply = self.post(body)
+        self.assertEqual(status, 200, reply)
+        return json.loads(reply)
+
+    def assert_error(self, reply, code, id=None):
+        self.assertEqual(reply["jsonrpc"], "2.0")
+        self.assertEqual(reply["id"], id)
+        self.assertEqual(reply["error"]["code"], code, reply)
+        self.assertIsInstance(reply["error"]["message"], str)
+        self.assertNotIn("result", reply)
+
+    def test_parse_error(self):
+        self.assert_error(self.call('{"jsonrpc": "2.0", "method": "ping", "id": 1'), -32700)
+
+    def test_invalid_requests(self):
+        cases = [
+            ({"jsonrpc": 1, "method": "ping", "id": 1}, 1),
+            ({"jsonrpc": None, "method": "ping", "id": 2}, 2),
+            ({"jsonrpc": "1.0", "method": "ping", "id": 3}, 3),
+            ({"method": "ping", "id": 4}, 4),
+            ({"jsonrpc": "2.0", "method": 1, "id": 5}, 5),
+            ({"jsonrpc": "2.0", "id": 6}, 6),
+            ({"jsonrpc": "2.0", "method": "ping", "params": "x", "id": 7}, 7),
+            ({"jsonrpc": "2.0", "method": "ping", "id": {"a": 1}}, None),
+            ({"jsonrpc": "2.0", "method": "ping", "id": [1]}, None),
+            (1, None),
+            ('"ping"', None),
+        ]
+        for body, id in cases:
+            with self.subTest(body=body):
+                self.assert_error(self.call(body), -32600, id)
+
+    def test_invalid_notifications_are_answered_with_a_null_id(self):
+        self.assert_error(self.call({"jsonrpc": 1, "method": "notifications/initialized"}), -32600)
+        self.assert_error(self.call({"jsonrpc": "2.0", "method": 1}), -32600)
+
+    def test_notifications_and_client_responses_get_no_reply(self):
+        for body in [{"jsonrpc": "2.0", "method": "notifications/initialized"},
+                     {"jsonrpc": "2.0", "method": "metodo/desconocido", "params": {}},
+                     {"jsonrpc": "2.0", "id": 9, "result": {}},
+                     {"jsonrpc": "2.0", "id": 9, "error": {"code": -1, "message": "x"}}]:
+            with self.subTest(body=body):
+                status, reply = self.post(body)
+                self.assertEqual(status, 202)
+                self.assertEqual(reply, b"")
+
+    def test_methods(self):
+        self.assertEqual(self.call({"jsonrpc": "2.0", "id": "a", "method": "ping"}),
+                         {"jsonrpc": "2.0", "id": "a", "result": {}})
+        init = self.call({"jsonrpc": "2.0", "id": 1, "method": "initialize",
+                          "params": {"protocolVersion": "2025-03-26", "capabilities": {}}})
+        self.assertEqual(init["result"]["protocolVersion"], "2025-03-26")
+        init = self.call({"jsonrpc": "2.0", "id": 1, "method": "initialize", "params": {"protocolVersion": "1999-01-01"}})
+        self.assertEqual(init["result"]["protocolVersion"], "2025-06-18")
+        tools = self.call({"jsonrpc": "2.0", "id": 2, "method": "tools/list"})["result"]["tools"]
+        self.assertIn("read_query", [tool["name"] for tool in tools])
+        self.assertIn("run_dashboard_agent", [tool["name"] for tool in tools])
+        resources = self.call({"jsonrpc": "2.0", "id": 3, "method": "resources/list"})["result"]["resources"]
+        self.assertEqual([r["uri"] for r in resources], ["postgres://schema", "postgres://schema/compact"])
+
+    def test_method_and_params_errors(self):
+        self.assert_error(self.call({"jsonrpc": "2.0", "id": 1, "method": "no/existe"}), -32601, 1)
+        self.assert_error(self.call({"jsonrpc": "2.0", "id": 2, "method": "tools/call", "params": {}}), -32602, 2)
+        self.assert_error(self.call({"jsonrpc": "2.0", "id": 3, "method": "tools/call",
+                                     "params": {"name": "read_query", "arguments": [1]}}), -32602, 3)
+        self.assert_error(self.call({"jsonrpc": "2.0", "id": 4, "method": "tools/call", "params": ["read_query"]}),
+                          -32602, 4)
+        self.assert_error(self.call({"jsonrpc": "2.0", "id": 5, "method": "resources/read",
+                                     "params": {"uri": "postgres://otro"}}), -32602, 5)
+
+    def test_tool_errors_are_results(self):
+        reply = self.call({"jsonrpc": "2.0", "id": 1, "method": "tools/call",
+                           "params": {"name": "read_query", "arguments": {"query": "DELETE FROM sales"}}})
+        self.assertTrue(reply["result"]["isError"])
+        self.assertIn("Solo se permiten consultas SELECT", reply["result"]["content"][0]["text"])
+
+    def test_batches(self):
+        reply = self.call([{"jsonrpc": "2.0", "id": 1, "method": "ping"},
+                           {"jsonrpc": "2.0", "method": "notifications/initialized"},
+                           {"jsonrpc": 1, "id": 2, "method": "ping"},
+                           {"jsonrpc": "2.0", "id": 3, "method": "no/existe"}])
+        self.assertEqual(len(reply), 3)
+        by_id = {r["id"]: r for r in reply}
+        self.assertEqual(by_id[1]["result"], {})
+        self.assert_error(by_id[2], -32600, 2)
+        self.assert_error(by_id[3], -32601, 3)
+
+        self.assert_error(self.call([]), -32600)
+        reply = self.call([1, 2, 3])
+        self.assertEqual(len(reply), 3)
+        for item in reply:
+            self.assert_error(item, -32600)
+
+        status, body = self.post([{"jsonrpc": "2.0", "method": "notifications/initialized"}])
+        self.assertEqual((status, body), (202, b""))
+
+    def test_http_transport(self):
+        status, _ = self.post(b"", method="GET")
+        self.assertEqual(status, 405)
+        status, body = self.post({"jsonrpc": "2.0", "id": 1, "method": "ping"}, {"Origin": "http://evil.example"})
+        self.assertEqual(status, 403)
+        status, _ = self.post({"jsonrpc": "2.0", "id": 1, "method": "ping"}, {"Origin": "http://localhost:3000"})
+        self.assertEqual(status, 200)
+
+
+class StdioTest(unittest.TestCase):
+    def test_one_response_per_request_line(self):
+        # Con un solo hilo de trabajo las respuestas salen en orden
+        lines = [
+            '{"jsonrpc": "2.0", "id": 1, "method": "ping"}',
+            "no es json",
+            '{"jsonrpc": 1, "id": 2, "method": "ping"}',
+            '{"jsonrpc": "2.0", "method": "notifications/initialized"}',
+            "",
+            '[{"jsonrpc": "2.0", "id": 3, "method": "ping"}, {"jsonrpc": "2.0", "method": "x"}]',
+            '{"jsonrpc": "2.0", "id": 4, "method": "ping"}',
+        ]
+        proc = subprocess.run([os.environ["MCP_SERVER_BIN"]], input="\n".join(lines) + "\n", capture_output=True,
+                              text=True, timeout=30, env=server_env(MCP_TRANSPORT="stdio", MCP_STDIO_WORKERS="1"))
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        replies = [json.loads(line) for line in proc.stdout.splitlines()]
+        self.assertEqual(len(replies), 5, proc.stdout)
+        self.assertEqual(replies[0], {"jsonrpc": "2.0", "id": 1, "result": {}})
+        self.assertEqual((replies[1]["id"], replies[1]["error"]["code"]), (None, -32700))
+        self.assertEqual((replies[2]["id"], replies[2]["error"]["code"]), (2, -32600))
+        self.assertEqual(replies[3], [{"jsonrpc": "2.0", "id": 3, "result": {}}])
+        self.assertEqual(replies[4]["id"], 4)
+
+    def test_concurrent_workers_answer_each_request_once(self):
+        lines = ['{"jsonrpc": "2.0", "id": %d, "method": "ping"}' % i for i in range(300)]
+        proc = subprocess.run([os.environ["MCP_SERVER_BIN"]], input="\n".join(lines) + "\n", capture_output=True,
+                              text=True, timeout=30, env=server_env(MCP_TRANSPORT="stdio", MCP_STDIO_WORKERS="4"))
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        ids = sorted(json.loads(line)["id"] for line in proc.stdout.splitlines())
+        self.assertEqual(ids, list(range(300)))
+
+
+if __name__ == "__main__":
+    unittest.main()
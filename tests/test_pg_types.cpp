@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <pqxx/pqxx>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "pg_types.hpp"
+#include "test_db.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+// Salida JSON de un convertidor para un valor
+std::string convert(mcp::pg::Converter converter, std::string_view value) {
+    std::string out;
+    mcp::JsonWriter writer(out);
+    converter(writer, value);
+    return out;
+}
+
+std::string convert_text(pqxx::oid oid, std::string_view value) {
+    const mcp::pg::TypeInfo* type = mcp::pg::lookup_type(oid);
+    return convert(type ? type->text : mcp::pg::text_as_string, value);
+}
+
+std::string convert_binary(pqxx::oid oid, std::string_view value) {
+    return convert(mcp::pg::lookup_type(oid)->binary, value);
+}
+
+// Codificación binaria (big-endian) de un entero de tamaño fijo
+template <typename T>
+std::string be(T value) {
+    std::string out(sizeof(T), '\0');
+    auto bits = static_cast<std::make_unsigned_t<T>>(value);
+    for (std::size_t i = sizeof(T); i-- > 0;) {
+        out[i] = static_cast<char>(bits & 0xFF);
+        bits = static_cast<std::make_unsigned_t<T>>(bits >> 8);
+    }
+    return out;
+}
+
+std::string float4_binary(float f) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return be(bits);
+}
+
+std::string float8_binary(double d) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return be(bits);
+}
+
+// numeric_send: ndigits, weight, sign, dscale y dígitos en base 10000
+std::string numeric_binary(std::int16_t weight, std::uint16_t sign, std::uint16_t dscale,
+                           std::initializer_list<std::int16_t> digits) {
+    std::string out = be(static_cast<std::int16_t>(digits.size())) + be(weight) + be(sign) + be(dscale);
+    for (std::int16_t d : digits) out += be(d);
+    return out;
+}
+
+// Microsegundos desde 2000-01-01 00:00:00 UTC
+
+}  // namespace
+
+TEST(TypeRegistry, KnownAndUnknownOids) {
+    const mcp::pg::TypeInfo* int4 = mcp::pg::lookup_type(23);
+    ASSERT_NE(int4, nullptr);
+    EXPECT_STREQ(int4->name, "int4");
+    EXPECT_NE(int4->binary, nullptr);
+    const mcp::pg::TypeInfo* interval = mcp::pg::lookup_type(1186);
+    ASSERT_NE(interval, nullptr);
+    EXPECT_EQ(interval->binary, nullptr);
+    EXPECT_EQ(mcp::pg::lookup_type(999999), nullptr);
+}
+
+TEST(TextConverters, Scalars) {
+    EXPECT_EQ(convert_text(23, "-42"), "-42");
+    EXPECT_EQ(convert_text(20, "9223372036854775807"), "9223372036854775807");
+    EXPECT_EQ(convert_text(701, "1.5e+20"), "1.5e+20");
+    EXPECT_EQ(convert_text(701, "NaN"), "null");
+    EXPECT_EQ(convert_text(700, "-Infinity"), "null");
+    EXPECT_EQ(convert_text(1700, "12345678901234567890.000001"), "12345678901234567890.000001");
+    EXPECT_EQ(convert_text(1700, "NaN"), "\"NaN\"");
+    EXPECT_EQ(convert_text(16, "t"), "true");
+    EXPECT_EQ(convert_text(16, "f"), "false");
+    EXPECT_EQ(convert_text(25, "di \"hola\""), "\"di \\\"hola\\\"\"");
+    EXPECT_EQ(convert_text(3802, "{\"a\": [1, 2]}"), "{\"a\": [1, 2]}");
+    EXPECT_EQ(convert_text(1186, "1 day 02:00:00"), "\"1 day 02:00:00\"");
+}
+
+TEST(TextConverters, ScalarArrays) {
+    EXPECT_EQ(convert_text(1007, "{1,NULL,{2,3}}"), "[1,null,[2,3]]");
+    EXPECT_EQ(convert_text(1000, "{t,f,NULL}"), "[true,false,null]");
+    EXPECT_EQ(convert_text(1022, "{1.5,NaN,-Infinity}"), "[1.5,null,null]");
+    EXPECT_EQ(convert_text(1007, "{}"), "[]");
+    EXPECT_EQ(convert_text(1007, "[0:1]={1,2}"), "\"[0:1]={1,2}\"");
+    // Los arreglos de texto se dejan como la cadena de PostgreSQL
+    EXPECT_EQ(convert_text(1009, "{a,\"b c\"}"), "\"{a,\\\"b c\\\"}\"");
+    EXPECT_NO_THROW(json::parse(convert_text(1231, "{{1.5,2},{NULL,3}}")));
+}
+
+// Cada caso es el valor binario y el texto que devuelve PostgreSQL (12+, TimeZone=UTC) para el
+// mismo valor: ambos formatos deben producir exactamente el mismo JSON
+TEST(BinaryMatchesText, Float4) {
+    const std::pair<float, const char*> cases[] = {
+        {0.1f, "0.1"}, {1.5f, "1.5"}, {-2.0f, "-2"}, {0.0f, "0"}, {-0.0f, "-0"},
+        {123456.0f, "123456"}, {1e6f, "1e+06"}, {1234567.0f, "1.234567e+06"},
+        {0.0001f, "0.0001"}, {1e-5f, "1e-05"}, {3.4028235e38f, "3.4028235e+38"},
+        {1.17549435e-38f, "1.1754944e-38"}, {0.3f, "0.3"}, {16777217.0f, "1.6777216e+07"},
+    };
+    for (const auto& [value, text] : cases) {
+        EXPECT_EQ(convert_binary(700, float4_binary(value)), text) << text;
+        EXPECT_EQ(convert_binary(700, float4_binary(value)), convert_text(700, text)) << text;
+    }
+    EXPECT_EQ(convert_binary(700, float4_binary(std::numeric_limits<float>::quiet_NaN())), convert_text(700, "NaN"));
+    EXPECT_EQ(convert_binary(700, float4_binary(-std::numeric_limits<float>::infinity())), convert_text(700, "-Infinity"));
+}
+
+TEST(BinaryMatchesText, Float8) {
+    const std::pair<double, const char*> cases[] = {
+        {0.1, "0.1"}, {2.0, "2"}, {1.0 / 3.0, "0.3333333333333333"}, {1e15, "1e+15"},
+        {123456789012345.0, "123456789012345"}, {1e-300, "1e-300"}, {-1.5e-5, "-1.5e-05"},
+        {0.1f, "0.10000000149011612"}, {1.7976931348623157e308, "1.7976931348623157e+308"}, {1e100, "1e+100"},
+    };
+    for (const auto& [value, text] : cases) {
+        EXPECT_EQ(convert_binary(701, float8_binary(value)), text) << text;
+        EXPECT_EQ(convert_binary(701, float8_binary(value)), convert_text(701, text)) << text;
+    }
+    EXPECT_EQ(convert_binary(701, float8_binary(std::numeric_limits<double>::infinity())), convert_text(701, "Infinity"));
+}
+
+TEST(BinaryMatchesText, Numeric) {
+    const std::pair<std::string, const char*> cases[] = {
+        {numeric_binary(0, 0x0000, 0, {}), "0"},
+        {numeric_binary(0, 0x0000, 2, {}), "0.00"},
+        {numeric_binary(1, 0x0000, 3, {1, 2345, 6780}), "12345.678"},
+        {numeric_binary(-1, 0x4000, 2, {500}), "-0.05"},
+        {numeric_binary(5, 0x0000, 0, {1}), "100000000000000000000"},
+        {numeric_binary(-2, 0x0000, 6, {100}), "0.000001"},
+        {numeric_binary(0, 0x0000, 1, {42, 1000}), "42.1"},
+        {numeric_binary(0, 0xC000, 0, {}), "NaN"},
+        {numeric_binary(0, 0xD000, 0, {}), "Infinity"},
+    };
+    for (const auto& [binary, text] : cases) {
+        EXPECT_EQ(convert_binary(1700, binary), convert_text(1700, text)) << text;
+    }
+}
+
+TEST(BinaryMatchesText, DateStyleAndTimeZoneDependentTypesAreReadAsText) {
+    // Su texto depende de la sesión: sin decodificador binario, read_query vuelve a declarar el
+    // cursor en formato texto
+    for (pqxx::oid oid : {1082u, 1114u, 1184u}) {
+        const mcp::pg::TypeInfo* type = mcp::pg::lookup_type(oid);
+        ASSERT_NE(type, nullptr) << oid;
+        EXPECT_EQ(type->binary, nullptr) << type->name;
+    }
+    EXPECT_NE(mcp::pg::lookup_type(1083)->binary, nullptr);
+}
+
+// Con una base de datos: los mismos valores leídos con un cursor de texto y uno BINARY, con la
+// misma vuelta a texto que read_query cuando alguna columna no tiene decodificador binario. La
+// zona horaria de la sesión no es UTC y DateStyle no es ISO
+TEST(BinaryMatchesText, LiveCursors) {
+    REQUIRE_TEST_DB();
+    pqxx::connection conn(test_conninfo());
+    pqxx::work txn(conn);
+    txn.exec("SET LOCAL TimeZone = 'America/Mexico_City'");
+    auto decode = [&txn](const std::string& sql, bool binary) {
+        auto declare = [&txn, &sql](bool as_binary) {
+            pqxx::result res = txn.exec(std::string("DECLARE mcp_test ") + (as_binary ? "BINARY " : "") +
+                                        "CURSOR FOR " + sql + "; FETCH ALL FROM mcp_test");
+            txn.exec("CLOSE mcp_test");
+            return res;
+        };
+        pqxx::result res = declare(binary);
+        if (binary && !mcp::pg::has_binary_decoders(res)) {
+            binary = false;
+            res = declare(false);
+        }
+        std::vector<mcp::pg::Column> columns = mcp::pg::describe_columns(res, binary);
+        std::vector<std::string> out;
+        for (auto field : res[0]) out.push_back(convert(columns[out.size()].convert, field.view()));
+        return out;
+    };
+    auto expect_same = [&decode](const std::string& sql) -> std::vector<std::string> {
+        const std::vector<std::string> text = decode(sql, false);
+        const std::vector<std::string> binary = decode(sql, true);
+        EXPECT_EQ(binary, text) << sql;
+        return text;
+    };
+    expect_same("SELECT 0.1::float4 AS f4, 1e6::float4 AS f4_big, 1.0/3 AS num, 0.1::float8 AS f8, "
+                "2::float8 AS f8_int, 12345.678::numeric(12,3) AS num_scale, '-0.05'::numeric AS num_neg, "
+                "'NaN'::numeric AS num_nan, '12:34:56.5'::time AS t");
+    const auto times = expect_same(
+        "SELECT '2024-05-01 12:34:56.5+00'::timestamptz AS ts, '0044-03-15 12:00:00+00 BC'::timestamptz AS ts_bc, "
+        "'infinity'::timestamptz AS ts_inf, '2024-05-01'::date AS d, '2024-05-01 12:34:56'::timestamp AS ts_local, "
+        "1 AS n");
+    ASSERT_FALSE(times.empty());
+    EXPECT_EQ(times[0], "\"2024-05-01 06:34:56.5-06\"");
+
+    txn.exec("SET LOCAL DateStyle = 'SQL, DMY'");
+    expect_same("SELECT '2024-05-01 12:34:56.5+00'::timestamptz AS ts, '2024-05-01'::date AS d");
+}
@@ -0,0 +1,184 @@
+#include <Python.h>
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <cmath>
+#include <string>
+
+#include "py_json.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+// Intérprete embebido para todo el ejecutable
+class PythonEnvironment : public ::testing::Environment {
+public:
+    void SetUp() override { Py_InitializeEx(0); }
+    void TearDown() override { Py_FinalizeEx(); }
+};
+
+const auto* const python_environment = ::testing::AddGlobalTestEnvironment(new PythonEnvironment);
+
+// Referencia propia que se libera al salir del ámbito
+struct Ref {
+    PyObject* obj;
+    explicit Ref(PyObject* o) : obj(o) {}
+    ~Ref() { Py_XDECREF(obj); }
+    Ref(const Ref&) = delete;
+    Ref& operator=(const Ref&) = delete;
+    PyObject* get() const { return obj; }
+};
+
+PyObject* globals() {
+    static PyObject* dict = [] {
+        PyObject* d = PyDict_New();
+        PyDict_SetItemString(d, "__builtins__", PyEval_GetBuiltins());
+        return d;
+    }();
+    return dict;
+}
+
+// Ejecutar sentencias en el espacio de nombres de las pruebas
+void exec(const char* code) {
+    Ref result(PyRun_String(code, Py_file_input, globals(), globals()));
+    if (!result.get()) PyErr_Print();
+    ASSERT_NE(result.get(), nullptr);
+}
+
+Ref eval(const char* expr) {
+    Ref result(PyRun_String(expr, Py_eval_input, globals(), globals()));
+    if (!result.get()) PyErr_Print();
+    return Ref(result.obj ? (Py_INCREF(result.obj), result.obj) : nullptr);
+}
+
+json to_json(const char* expr) {
+    Ref obj = eval(expr);
+    json out;
+    EXPECT_NE(obj.get(), nullptr);
+    if (obj.get() && !mcp::py_to_json(obj.get(), out)) {
+        PyErr_Print();
+        ADD_FAILURE() << "py_to_json falló con " << expr;
+    }
+    return out;
+}
+
+// Nombre del tipo de la excepción pendiente (y la limpia)
+std::string take_error() {
+    PyObject* type = PyErr_Occurred();
+    std::string name = type ? reinterpret_cast<PyTypeObject*>(type)->tp_name : "";
+    PyErr_Clear();
+    return name;
+}
+
+}  // namespace
+
+TEST(PyToJson, ScalarsKeepBoolApartFromInt) {
+    EXPECT_EQ(to_json("[True, 1, False, 0, None, 1.5, 'ñ', 2**64 - 1, -2**63]"),
+              json::parse("[true, 1, false, 0, null, 1.5, \"ñ\", 18446744073709551615, -9223372036854775808]"));
+    EXPECT_TRUE(to_json("True").is_boolean());
+    EXPECT_TRUE(to_json("1").is_number_integer());
+    EXPECT_TRUE(to_json("2**70").is_number_float());  // como json.loads con números enormes
+    EXPECT_TRUE(std::isnan(to_json("float('nan')").get<double>()));
+}
+
+TEST(PyToJson, NonStringKeysFollowJsonDumps) {
+    exec("import json\nkeys = {1: 'a', 2.5: 'b', True: 'c', None: 'd', -7: 'e', (1, 2): 'f'}");
+    json converted = to_json("keys");
+    EXPECT_EQ(converted, json::parse(R"j({"1": "c", "2.5": "b", "null": "d", "-7": "e", "(1, 2)": "f"})j"));
+    // Mismo resultado que json.dumps para las claves que este admite
+    EXPECT_EQ(converted.erase("(1, 2)"), 1u);
+    EXPECT_EQ(converted, to_json("json.loads(json.dumps({k: v for k, v in keys.items() if not isinstance(k, tuple)}))"));
+    EXPECT_EQ(to_json("{False: 0}"), json::parse(R"({"false": 0})"));
+}
+
+TEST(PyToJson, ContainerSubclassesAndTuples) {
+    exec("import collections\n"
+         "class MiLista(list): pass\n"
+         "class MiDict(dict): pass\n");
+    EXPECT_EQ(to_json("collections.OrderedDict([('b', 1), ('a', MiLista([1, (2, 3)]))])"),
+              json::parse(R"({"a": [1, [2, 3]], "b": 1})"));
+    EXPECT_EQ(to_json("MiDict(x=collections.defaultdict(list, y=[]))"), json::parse(R"({"x": {"y": []}})"));
+}
+
+TEST(PyToJson, RejectsUnsupportedTypesAndCycles) {
+    json out;
+    Ref set = eval("{'a': {1, 2}}");
+    EXPECT_FALSE(mcp::py_to_json(set.get(), out));
+    EXPECT_EQ(take_error(), "TypeError");
+
+    exec("ciclo = []\nciclo.append(ciclo)");
+    Ref cycle = eval("ciclo");
+    EXPECT_FALSE(mcp::py_to_json(cycle.get(), out));
+    EXPECT_EQ(take_error(), "ValueError");
+    exec("ciclo.clear()");
+}
+
+TEST(PyToJson, KeyStrThatMutatesTheDictDoesNotCrash) {
+    // str() de la clave vacía el diccionario que se está recorriendo: el valor en curso y el
+    // propio diccionario deben seguir vivos hasta terminar con ellos
+    exec("class Clave:\n"
+         "    def __hash__(self): return 1\n"
+         "    def __str__(self):\n"
+         "        datos.clear()\n"
+         "        return 'clave'\n"
+         "datos = {Clave(): ['valor', {'anidado': 1}], 'otra': 2}\n");
+    Ref data = eval("datos");
+    json out;
+    mcp::py_to_json(data.get(), out);
+    PyErr_Clear();
+    SUCCEED();
+}
+
+TEST(JsonToPy, RoundTripsThroughPython) {
+    const json doc = json::parse(R"({"filas": [{"id": 1, "activo": true, "total": 2.5, "nota": null},
+                                              {"id": 2, "activo": false, "total": -1e300, "nota": "ñandú"}],
+                                    "vacío": {}, "lista": [], "grande": 18446744073709551615})");
+    Ref obj(mcp::json_to_py(doc));
+    ASSERT_NE(obj.get(), nullptr);
+    PyDict_SetItemString(globals(), "convertido", obj.get());
+    Ref same = eval("convertido == {'filas': [{'id': 1, 'activo': True, 'total': 2.5, 'nota': None},"
+                    " {'id': 2, 'activo': False, 'total': -1e300, 'nota': 'ñandú'}],"
+                    " 'vacío': {}, 'lista': [], 'grande': 2**64 - 1}"
+                    " and type(convertido['filas'][0]['activo']) is bool and type(convertido['filas'][0]['id']) is int");
+    EXPECT_EQ(same.get(), Py_True);
+
+    json back;
+    ASSERT_TRUE(mcp::py_to_json(obj.get(), back));
+    EXPECT_EQ(back, doc);
+}
+
+TEST(JsonToPy, NaNBecomesAFloat) {
+    Ref obj(mcp::json_to_py(json(std::nan(""))));
+    ASSERT_NE(obj.get(), nullptr);
+    ASSERT_TRUE(PyFloat_Check(obj.get()));
+    EXPECT_TRUE(std::isnan(PyFloat_AS_DOUBLE(obj.get())));
+}
+
+TEST(JsonToPy, DeepNestingWithinTheLimit) {
+    json doc = json::array();
+    json* leaf = &doc;
+    for (int i = 0; i < 5000; ++i) {
+        leaf->push_back(i % 2 ? json::array() : json::object());
+        leaf = &leaf->back();
+        if (leaf->is_object()) leaf = &((*leaf)["k"] = json::array());
+    }
+    leaf->push_back("fondo");
+
+    Ref obj(mcp::json_to_py(doc));
+    ASSERT_NE(obj.get(), nullptr);
+    json back;
+    ASSERT_TRUE(mcp::py_to_json(obj.get(), back));
+    EXPECT_EQ(back, doc);
+}
+
+TEST(JsonToPy, TooDeepIsAValueError) {
+    json doc = json::array();
+    json* leaf = &doc;
+    for (std::size_t i = 0; i <= mcp::kMaxPyJsonDepth; ++i) {
+        leaf->push_back(json::array({0}));
+        leaf = &leaf->back();
+    }
+    Ref obj(mcp::json_to_py(doc));
+    EXPECT_EQ(obj.get(), nullptr);
+    EXPECT_EQ(take_error(), "ValueError");
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "query_cache.hpp"
+
+using namespace std::chrono_literals;
+
+TEST(NormalizeSql, CollapsesWhitespaceCaseAndComments) {
+    EXPECT_EQ(mcp::normalize_sql("SELECT  *\n  FROM Sales -- comentario\n WHERE id = 1 ;"),
+              mcp::normalize_sql("select * from sales where id=1"));
+    EXPECT_EQ(mcp::normalize_sql("SELECT /* a /* anidado */ b */ 1"), "select 1");
+    // "- -" no puede juntarse en "--", que abriría un comentario
+    EXPECT_EQ(mcp::normalize_sql("SELECT a>=b, c - -d FROM t;;"), "select a>=b,c- -d from t");
+}
+
+TEST(NormalizeSql, KeepsLiteralsAndQuotedIdentifiers) {
+    EXPECT_NE(mcp::normalize_sql("SELECT * FROM t WHERE name = 'Ana'"),
+              mcp::normalize_sql("SELECT * FROM t WHERE name = 'ana'"));
+    EXPECT_NE(mcp::normalize_sql("SELECT \"Total\" FROM t"), mcp::normalize_sql("SELECT \"total\" FROM t"));
+    EXPECT_EQ(mcp::normalize_sql("SELECT 'it''s -- no es comentario'"), "select 'it''s -- no es comentario'");
+    EXPECT_EQ(mcp::normalize_sql("SELECT E'a\\'b  C'"), "select E'a\\'b  C'");
+    EXPECT_EQ(mcp::normalize_sql("SELECT $tag$ Texto  $x$ $tag$"), "select $tag$ Texto  $x$ $tag$");
+    EXPECT_NE(mcp::normalize_sql("SELECT * FROM t WHERE id = 1"), mcp::normalize_sql("SELECT * FROM t WHERE id = 2"));
+}
+
+TEST(QueryCache, HitMissAndStats) {
+    mcp::QueryCache cache(1 << 20, 60s);
+    EXPECT_EQ(cache.get("k"), nullptr);
+    cache.put("k", "[1]", 60s);
+    auto hit = cache.get("k");
+    ASSERT_NE(hit, nullptr);
+    EXPECT_EQ(*hit, "[1]");
+    mcp::QueryCache::Stats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_GT(stats.bytes, 3u);
+}
+
+TEST(QueryCache, ExpiresEntries) {
+    mcp::QueryCache cache(1 << 20, 60s);
+    cache.put("k", "v", 20ms);
+    std::this_thread::sleep_for(40ms);
+    EXPECT_EQ(cache.get("k"), nullptr);
+    EXPECT_EQ(cache.stats().expirations, 1u);
+    EXPECT_EQ(cache.stats().entries, 0u);
+}
+
+TEST(QueryCache, ZeroTtlAndOversizeValuesAreNotStored) {
+    mcp::QueryCache cache(1024, 60s);
+    cache.put("volatile", "v", 0ms);
+    cache.put("big", std::string(2048, 'x'), 60s);
+    EXPECT_EQ(cache.stats().entries, 0u);
+}
+
+TEST(QueryCache, EvictsLeastRecentlyUsed) {
+    // Cada entrada ocupa 2*1 + 300 + 128 = 430 bytes: caben dos
+    mcp::QueryCache cache(1000, 60s);
+    cache.put("a", std::string(300, 'a'), 60s);
+    cache.put("b", std::string(300, 'b'), 60s);
+    ASSERT_NE(cache.get("a"), nullptr);  // "b" pasa a ser la menos reciente
+    cache.put("c", std::string(300, 'c'), 60s);
+    EXPECT_NE(cache.get("a"), nullptr);
+    EXPECT_EQ(cache.get("b"), nullptr);
+    EXPECT_NE(cache.get("c"), nullptr);
+    EXPECT_EQ(cache.stats().evictions, 1u);
+    EXPECT_LE(cache.stats().bytes, 1000u);
+}
+
+TEST(QueryCache, ReplaceAndClear) {
+    mcp::QueryCache cache(1 << 20, 60s);
+    cache.put("k", "uno", 60s);
+    cache.put("k", "dos", 60s);
+    EXPECT_EQ(*cache.get("k"), "dos");
+    EXPECT_EQ(cache.stats().entries, 1u);
+    auto held = cache.get("k");
+    cache.clear();
+    EXPECT_EQ(cache.get("k"), nullptr);
+    EXPECT_EQ(cache.stats().bytes, 0u);
+    EXPECT_EQ(*held, "dos");  // los valores ya entregados siguen siendo válidos
+}
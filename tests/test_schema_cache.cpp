@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <pqxx/pqxx>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "schema_cache.hpp"
+#include "test_db.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+mcp::SchemaTable table(const std::string& name) {
+    mcp::SchemaTable t;
+    t.name = name;
+    t.kind = "table";
+    t.columns.push_back({"id", "integer", "int4", true, ""});
+    t.primary_key = {"id"};
+    return t;
+}
+
+// Ejecutar una sentencia en su propia transacción confirmada
+void exec_committed(const std::string& sql) {
+    pqxx::connection conn(test_conninfo());
+    pqxx::work txn(conn);
+    txn.exec(sql);
+    txn.commit();
+}
+
+struct CountingLoader {
+    std::shared_ptr<std::atomic<int>> calls = std::make_shared<std::atomic<int>>(0);
+
+    mcp::SchemaCache::Loader loader() const {
+        auto counter = calls;
+        return [counter](pqxx::transaction_base&) {
+            ++*counter;
+            return mcp::make_schema_snapshot({table("t" + std::to_string(counter->load()))});
+        };
+    }
+};
+
+mcp::PoolConfig one_connection() {
+    mcp::PoolConfig config;
+    config.min_size = 0;
+    config.max_size = 1;
+    return config;
+}
+
+}  // namespace
+
+TEST(SchemaSnapshot, SerializesEachTableOnce) {
+    auto snapshot = mcp::make_schema_snapshot({table("customers"), table("Sales")});
+    ASSERT_EQ(snapshot->table_json.size(), 2u);
+    EXPECT_EQ(snapshot->json, "[" + snapshot->table_json[0] + "," + snapshot->table_json[1] + "]");
+    EXPECT_EQ(snapshot->compact, snapshot->table_compact[0] + snapshot->table_compact[1]);
+    EXPECT_EQ(snapshot->text(mcp::SchemaFormat::compact), snapshot->compact);
+    EXPECT_EQ(json::parse(snapshot->json).size(), 2u);
+}
+
+TEST(SchemaSnapshot, ColumnsKeepsTheFlatPerColumnShape) {
+    auto sales = table("Sales");
+    sales.columns.push_back({"amount", "numeric(10,2)", "numeric", false, ""});
+    auto empty_view = table("v");
+    empty_view.columns.clear();
+    auto snapshot = mcp::make_schema_snapshot({table("customers"), empty_view, sales});
+    EXPECT_EQ(snapshot->text(mcp::SchemaFormat::columns), snapshot->columns);
+    EXPECT_EQ(json::parse(snapshot->columns), json::parse(R"j([
+        {"table_name": "customers", "column_name": "id", "data_type": "integer"},
+        {"table_name": "Sales", "column_name": "id", "data_type": "integer"},
+        {"table_name": "Sales", "column_name": "amount", "data_type": "numeric(10,2)"}
+    ])j"));
+    ASSERT_EQ(snapshot->table_columns.size(), 3u);
+    EXPECT_EQ(snapshot->table_columns[1], "");
+    EXPECT_EQ(json::parse("[" + snapshot->table_columns[2] + "]").size(), 2u);
+    EXPECT_EQ(mcp::parse_schema_format("columns"), mcp::SchemaFormat::columns);
+}
+
+TEST(SchemaSnapshot, EmptySchemaIsAnEmptyArrayInEveryJsonShape) {
+    auto snapshot = mcp::make_schema_snapshot({});
+    EXPECT_EQ(snapshot->json, "[]");
+    EXPECT_EQ(snapshot->columns, "[]");
+    EXPECT_EQ(snapshot->compact, "");
+}
+
+namespace {
+
+std::shared_ptr<mcp::SchemaSnapshot> five_tables() {
+    std::vector<mcp::SchemaTable> tables;
+    for (const char* name : {"a", "b", "c", "d", "e"}) {
+        tables.push_back(table(name));
+        tables.back().rows_estimate = 10;
+    }
+    tables[1].kind = "view";
+    tables[1].rows_estimate = -1;
+    return mcp::make_schema_snapshot(std::move(tables));
+}
+
+}  // namespace
+
+TEST(ListTables, PagesWithTotalAndNextOffset) {
+    auto snapshot = five_tables();
+    EXPECT_EQ(json::parse(mcp::list_snapshot_tables(*snapshot, 0, 2, mcp::SchemaFormat::json)), json::parse(R"({
+        "total": 5,
+        "tables": [{"table_name": "a", "kind": "table", "rows_estimate": 10}, {"table_name": "b", "kind": "view"}],
+        "next_offset": 2
+    })"));
+    auto last = json::parse(mcp::list_snapshot_tables(*snapshot, 4, 2, mcp::SchemaFormat::columns));
+    EXPECT_EQ(last["tables"].size(), 1u);
+    EXPECT_TRUE(last["next_offset"].is_null());
+    auto past_the_end = json::parse(mcp::list_snapshot_tables(*snapshot, 9, 2, mcp::SchemaFormat::json));
+    EXPECT_EQ(past_the_end["tables"], json::array());
+    EXPECT_TRUE(past_the_end["next_offset"].is_null());
+    auto unbounded = json::parse(mcp::list_snapshot_tables(*snapshot, 1, std::size_t(-1), mcp::SchemaFormat::json));
+    EXPECT_EQ(unbounded["tables"].size(), 4u);
+}
+
+TEST(ListTables, CompactIsOneLinePerTableWithAFooter) {
+    auto snapshot = five_tables();
+    EXPECT_EQ(mcp::list_snapshot_tables(*snapshot, 0, 2, mcp::SchemaFormat::compact),
+              "a ~10 rows\nview b\n# 2 de 5 tablas; siguiente offset=2\n");
+    EXPECT_EQ(mcp::list_snapshot_tables(*snapshot, 3, 5, mcp::SchemaFormat::compact),
+              "d ~10 rows\ne ~10 rows\n# 2 de 5 tablas\n");
+}
+
+TEST(DescribeTables, ReusesThePerTableSerializations) {
+    auto snapshot = mcp::make_schema_snapshot({table("customers"), table("Sales")});
+    const std::vector<std::string> names = {"sales", "missing", "public.customers"};
+    EXPECT_EQ(mcp::describe_snapshot_tables(*snapshot, names, mcp::SchemaFormat::json),
+              "[" + snapshot->table_json[1] + R"(,{"table_name":"missing","error":"Tabla no encontrada"})" +
+                  "," + snapshot->table_json[0] + "]");
+    EXPECT_EQ(mcp::describe_snapshot_tables(*snapshot, names, mcp::SchemaFormat::compact),
+              snapshot->table_compact[1] + "missing: tabla no encontrada\n" + snapshot->table_compact[0]);
+    EXPECT_EQ(json::parse(mcp::describe_snapshot_tables(*snapshot, names, mcp::SchemaFormat::columns)), json::parse(R"([
+        {"table_name": "Sales", "column_name": "id", "data_type": "integer"},
+        {"table_name": "missing", "error": "Tabla no encontrada"},
+        {"table_name": "customers", "column_name": "id", "data_type": "integer"}
+    ])"));
+    EXPECT_EQ(mcp::describe_snapshot_tables(*snapshot, {}, mcp::SchemaFormat::json), "[]");
+}
+
+TEST(SchemaQueries, SignatureCoversRowEstimatesAndTheSchemaNeedsPg12) {
+    // ANALYZE cambia reltuples sin cambiar el xmin de pg_class
+    EXPECT_NE(std::string(mcp::kSchemaSignatureQuery).find("reltuples"), std::string::npos);
+    EXPECT_NE(std::string(mcp::kSchemaQuery).find("pg_partition_tree"), std::string::npos);
+    EXPECT_EQ(mcp::kSchemaMinServerVersion, 120000);
+}
+
+TEST(SchemaCache, AnalyzeChangesTheSignature) {
+    REQUIRE_TEST_DB();
+    exec_committed("DROP TABLE IF EXISTS mcp_test_schema_analyze");
+    exec_committed("CREATE TABLE mcp_test_schema_analyze (id int)");
+    auto signature = [] {
+        pqxx::connection conn(test_conninfo());
+        pqxx::work txn(conn);
+        return txn.exec(mcp::kSchemaSignatureQuery)[0][0].as<std::string>();
+    };
+    const std::string before = signature();
+    exec_committed("INSERT INTO mcp_test_schema_analyze SELECT generate_series(1, 1000)");
+    exec_committed("ANALYZE mcp_test_schema_analyze");
+    const std::string after = signature();
+    exec_committed("DROP TABLE mcp_test_schema_analyze");
+    EXPECT_NE(before, after);
+}
+
+TEST(SchemaSnapshot, FindByExactLowercaseOrQualifiedName) {
+    auto snapshot = mcp::make_schema_snapshot({table("customers"), table("Sales")});
+    EXPECT_EQ(snapshot->find("customers"), std::optional<std::size_t>(0));
+    EXPECT_EQ(snapshot->find("Sales"), std::optional<std::size_t>(1));
+    EXPECT_EQ(snapshot->find("sales"), std::optional<std::size_t>(1));
+    EXPECT_EQ(snapshot->find("public.CUSTOMERS"), std::optional<std::size_t>(0));
+    EXPECT_EQ(snapshot->find("products"), std::nullopt);
+    EXPECT_EQ(snapshot->find("other.customers"), std::nullopt);
+}
+
+TEST(SchemaCache, ReloadsOnlyWhenTheSignatureChanges) {
+    REQUIRE_TEST_DB();
+    exec_committed("DROP TABLE IF EXISTS mcp_test_schema_cache");
+    mcp::ConnectionPool pool(test_conninfo(), one_connection());
+    CountingLoader counting;
+    mcp::SchemaCache cache(pool, std::chrono::milliseconds(0), counting.loader());
+
+    auto first = cache.get();
+    auto second = cache.get();
+    EXPECT_EQ(counting.calls->load(), 1);
+    EXPECT_EQ(first, second);
+
+    exec_committed("CREATE TABLE mcp_test_schema_cache (id int PRIMARY KEY)");
+    auto after_create = cache.get();
+    EXPECT_EQ(counting.calls->load(), 2);
+    EXPECT_NE(after_create->signature, first->signature);
+
+    exec_committed("COMMENT ON TABLE mcp_test_schema_cache IS 'prueba'");
+    cache.get();
+    EXPECT_EQ(counting.calls->load(), 3);
+
+    exec_committed("ALTER TABLE mcp_test_schema_cache ADD COLUMN name text");
+    cache.get();
+    EXPECT_EQ(counting.calls->load(), 4);
+
+    exec_committed("DROP TABLE mcp_test_schema_cache");
+    cache.get();
+    EXPECT_EQ(counting.calls->load(), 5);
+}
+
+TEST(SchemaCache, InvalidateDuringARefreshIsNotLost) {
+    REQUIRE_TEST_DB();
+    mcp::ConnectionPool pool(test_conninfo(), one_connection());
+    auto calls = std::make_shared<std::atomic<int>>(0);
+    mcp::SchemaCache* cache_ptr = nullptr;
+    mcp::SchemaCache cache(pool, std::chrono::hours(1), [calls, &cache_ptr](pqxx::transaction_base&) {
+        // La primera carga ve una invalidación concurrente (p.ej. tras un CREATE TABLE)
+        if (++*calls == 1) cache_ptr->invalidate();
+        return mcp::make_schema_snapshot({table("t" + std::to_string(calls->load()))});
+    });
+    cache_ptr = &cache;
+
+    EXPECT_EQ(cache.get()->tables[0].name, "t1");
+    EXPECT_EQ(cache.get()->tables[0].name, "t2");
+    EXPECT_EQ(cache.get()->tables[0].name, "t2");
+    EXPECT_EQ(calls->load(), 2);
+}
+
+TEST(SchemaCache, CheckIntervalSkipsTheSignatureQuery) {
+    REQUIRE_TEST_DB();
+    exec_committed("DROP TABLE IF EXISTS mcp_test_schema_cache_interval");
+    mcp::ConnectionPool pool(test_conninfo(), one_connection());
+    CountingLoader counting;
+    mcp::SchemaCache cache(pool, std::chrono::hours(1), counting.loader());
+    auto first = cache.get();
+    exec_committed("CREATE TABLE mcp_test_schema_cache_interval (id int)");
+    EXPECT_EQ(cache.get(), first);
+    EXPECT_EQ(counting.calls->load(), 1);
+
+    cache.invalidate();
+    cache.get();
+    EXPECT_EQ(counting.calls->load(), 2);
+    exec_committed("DROP TABLE mcp_test_schema_cache_interval");
+}
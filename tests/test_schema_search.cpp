@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "schema_search.hpp"
+
+namespace {
+
+mcp::SchemaTable table(const std::string& name, std::vector<std::string> columns, const std::string& comment = "") {
+    mcp::SchemaTable t;
+    t.name = name;
+    t.kind = "table";
+    t.comment = comment;
+    for (auto& column : columns) t.columns.push_back({std::move(column), "text", "text", false, ""});
+    return t;
+}
+
+// Tienda pequeña: sales enlaza con products y customers por claves foráneas
+std::vector<mcp::SchemaTable> shop() {
+    auto sales = table("sales", {"id", "region", "amount", "sold_at", "product_id", "customer_id"});
+    sales.foreign_keys.push_back({{"product_id"}, "products", {"id"}});
+    sales.foreign_keys.push_back({{"customer_id"}, "customers", {"id"}});
+    return {
+        table("customers", {"id", "email", "city"}),
+        table("employees", {"id", "salary", "department"}, "Personal de la empresa"),
+        table("products", {"id", "name", "price", "categoria"}),
+        sales,
+        table("audit_log", {"id", "event", "created_at"}),
+    };
+}
+
+std::vector<std::string> terms(std::string_view text) {
+    std::vector<std::string> out;
+    mcp::detail::for_each_term(text, [&out](std::string term) { out.push_back(std::move(term)); });
+    return out;
+}
+
+std::vector<std::string> top_names(const mcp::SchemaSearchIndex& index, const std::vector<mcp::SchemaTable>& tables,
+                                   std::string_view query, std::size_t k) {
+    std::vector<std::string> names;
+    for (const auto& hit : index.search(query, k)) names.push_back(tables[hit.table].name);
+    return names;
+}
+
+}  // namespace
+
+TEST(SchemaSearchTerms, SplitsFoldsAndStemsIdentifiersAndText) {
+    EXPECT_EQ(terms("VentasPorRegión total_2024"), (std::vector<std::string>{"vent", "region", "total"}));
+    EXPECT_EQ(terms("customer_orders"), (std::vector<std::string>{"customer", "order"}));
+    EXPECT_EQ(terms("¿Cuántas categorías de productos hay?"), (std::vector<std::string>{"categori", "product"}));
+    EXPECT_EQ(terms("the sales of 2024"), (std::vector<std::string>{"sal"}));
+    EXPECT_EQ(terms(""), std::vector<std::string>{});
+    EXPECT_EQ(mcp::detail::stem("ventas"), mcp::detail::stem("venta"));
+    EXPECT_EQ(mcp::detail::stem("categories"), mcp::detail::stem("category"));
+}
+
+TEST(SchemaSearchIndex, RanksTheTableNamedInTheQueryFirst) {
+    const auto tables = shop();
+    mcp::SchemaSearchIndex index(tables);
+    EXPECT_EQ(top_names(index, tables, "sales by region", 1), std::vector<std::string>{"sales"});
+    EXPECT_EQ(top_names(index, tables, "audit log events", 1), std::vector<std::string>{"audit_log"});
+    // Comentario de tabla y columnas
+    EXPECT_EQ(top_names(index, tables, "personal de la empresa", 1), std::vector<std::string>{"employees"});
+    EXPECT_EQ(top_names(index, tables, "email", 5), std::vector<std::string>{"customers"});
+}
+
+TEST(SchemaSearchIndex, ExpandsSpanishAndEnglishSynonyms) {
+    const auto tables = shop();
+    mcp::SchemaSearchIndex index(tables);
+    EXPECT_EQ(top_names(index, tables, "ventas por región", 1), std::vector<std::string>{"sales"});
+    EXPECT_EQ(top_names(index, tables, "clientes por ciudad", 1), std::vector<std::string>{"customers"});
+    EXPECT_EQ(top_names(index, tables, "sueldo de los trabajadores", 1), std::vector<std::string>{"employees"});
+    EXPECT_EQ(top_names(index, tables, "product categories", 1), std::vector<std::string>{"products"});
+}
+
+TEST(SchemaSearchIndex, ForeignKeyNeighboursScoreBelowTheTableItself) {
+    const auto tables = shop();
+    mcp::SchemaSearchIndex index(tables);
+    const auto hits = index.search("products", 5);
+    ASSERT_GE(hits.size(), 2u);
+    EXPECT_EQ(tables[hits[0].table].name, "products");
+    EXPECT_EQ(tables[hits[1].table].name, "sales");
+    EXPECT_GT(hits[0].score, hits[1].score);
+}
+
+TEST(SchemaSearchIndex, LimitsToKAndReturnsNothingWithoutMatches) {
+    const auto tables = shop();
+    mcp::SchemaSearchIndex index(tables);
+    EXPECT_EQ(index.search("id", 2).size(), 2u);
+    EXPECT_EQ(index.search("id", 100).size(), tables.size());
+    EXPECT_TRUE(index.search("sales", 0).empty());
+    EXPECT_TRUE(index.search("zzz", 5).empty());
+    EXPECT_TRUE(index.search("de la por", 5).empty());
+    EXPECT_TRUE(mcp::SchemaSearchIndex({}).search("sales", 5).empty());
+}
+
+TEST(SchemaSearchIndex, ReusesTheTermsOfUnchangedTables) {
+    auto tables = shop();
+    mcp::SchemaSearchIndex first(tables);
+    EXPECT_EQ(first.reused(), 0u);
+
+    tables[0].columns.push_back({"loyalty_points", "int4", "int4", false, ""});
+    mcp::SchemaSearchIndex second(tables, &first);
+    EXPECT_EQ(second.reused(), tables.size() - 1);
+    EXPECT_EQ(top_names(second, tables, "loyalty points", 1), std::vector<std::string>{"customers"});
+
+    // Renombrar products cambia también el texto de sales, que la enlaza
+    tables[2].name = "items";
+    tables[3].foreign_keys[0].ref_table = "items";
+    mcp::SchemaSearchIndex third(tables, &second);
+    EXPECT_EQ(third.reused(), tables.size() - 2);
+    EXPECT_EQ(top_names(third, tables, "items", 1), std::vector<std::string>{"items"});
+}
+
+TEST(SchemaSearchCache, RebuildsOnlyWhenTheSnapshotChanges) {
+    mcp::SchemaSearchCache cache;
+    EXPECT_EQ(cache.stats().builds, 0u);
+    std::shared_ptr<const mcp::SchemaSnapshot> snapshot = mcp::make_schema_snapshot(shop());
+    auto index = cache.get(snapshot);
+    EXPECT_EQ(cache.get(snapshot), index);
+    EXPECT_EQ(cache.stats().builds, 1u);
+    EXPECT_EQ(cache.stats().tables, 5u);
+
+    auto tables = shop();
+    tables.push_back(table("invoices", {"id", "total"}));
+    std::shared_ptr<const mcp::SchemaSnapshot> changed = mcp::make_schema_snapshot(tables);
+    EXPECT_NE(cache.get(changed), index);
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.builds, 2u);
+    EXPECT_EQ(stats.tables, 6u);
+    EXPECT_EQ(stats.reused, 5u);
+}